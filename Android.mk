@@ -51,6 +51,7 @@ LOCAL_SRC_FILES :=  \
 	generic/tkpCanvas.c \
 	generic/tkpCanvBmap.c \
 	generic/tkpCanvImg.c \
+	generic/tkpCanvIndex.c \
 	generic/tkpCanvLine.c \
 	generic/tkpCanvPoly.c \
 	generic/tkpCanvPs.c \
@@ -38,6 +38,12 @@ void (*agg_custom_free)(void *ptr) = NULL;
 MODULE_SCOPE int PixelAlignObjCmd(ClientData clientData, Tcl_Interp* interp,
                     int objc, Tcl_Obj* const objv[]);
 MODULE_SCOPE int SurfaceInit(Tcl_Interp *interp);
+MODULE_SCOPE int TextMeasureObjCmd(ClientData clientData, Tcl_Interp* interp,
+                    int objc, Tcl_Obj* const objv[]);
+#ifdef TKPATH_TEST
+MODULE_SCOPE int PixelKernelsObjCmd(ClientData clientData, Tcl_Interp* interp,
+                    int objc, Tcl_Obj* const objv[]);
+#endif
 
 
 #if defined(_WIN32) && !defined(PLATFORM_SDL)
@@ -133,6 +139,12 @@ int Tkpath_Init(Tcl_Interp *interp)		/* Tcl interpreter. */
     }
     Tcl_CreateObjCommand(interp, "::tkp::pixelalign",
             PixelAlignObjCmd, (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+    Tcl_CreateObjCommand(interp, "::tkp::textmeasure", TextMeasureObjCmd,
+	    (ClientData) Tk_MainWindow(interp), (Tcl_CmdDeleteProc *) NULL);
+#ifdef TKPATH_TEST
+    Tcl_CreateObjCommand(interp, "::tkp::pixelkernels", PixelKernelsObjCmd,
+	    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+#endif
 
     /*
      * Make separate gradient objects, similar to SVG.
@@ -15,6 +15,13 @@
 #include "tkPathStyle.h"
 #include <math.h>
 
+static void	GetArrowStyle(ArrowDescr *arrowDescr,
+		    Tk_PathStyle *const style, Tk_PathStyle *arrowStylePtr,
+		    TkPathColor *fcPtr);
+static PathAtom *GetArrowAtoms(ArrowDescr *arrowDescr);
+static void	MoveArrowAtoms(ArrowDescr *arrowDescr);
+static void	FreeArrowAtoms(ArrowDescr *arrowDescr);
+
 PathAtom *
 MakePathAtomsFromArrow(ArrowDescr *arrowDescr)
 {
@@ -37,32 +44,100 @@ MakePathAtomsFromArrow(ArrowDescr *arrowDescr)
     return ret;
 }
 
+/*
+ * The atoms of an arrowhead are kept in its arrowAtomPtr so that they are
+ * not made again on every redisplay. TkPathConfigureArrow makes them when
+ * it computes the polygon, and translating or scaling the arrow moves them
+ * along with the points.
+ */
+
+static PathAtom *
+GetArrowAtoms(ArrowDescr *arrowDescr)
+{
+    if (arrowDescr->arrowAtomPtr == NULL) {
+        arrowDescr->arrowAtomPtr = MakePathAtomsFromArrow(arrowDescr);
+    }
+    return arrowDescr->arrowAtomPtr;
+}
+
+static void
+MoveArrowAtoms(ArrowDescr *arrowDescr)
+{
+    PathPoint *coords = arrowDescr->arrowPointsPtr;
+    PathAtom *atomPtr = arrowDescr->arrowAtomPtr;
+    int i;
+
+    /* Same order as in MakePathAtomsFromArrow. */
+    for (i = 0; i < DRAWABLE_PTS_IN_ARROW && atomPtr != NULL; i++) {
+        if (isnan(coords[i].x) || isnan(coords[i].y))
+            continue;
+        if (atomPtr->type == PATH_ATOM_M) {
+            ((MoveToAtom *) atomPtr)->x = coords[i].x;
+            ((MoveToAtom *) atomPtr)->y = coords[i].y;
+        } else {
+            ((LineToAtom *) atomPtr)->x = coords[i].x;
+            ((LineToAtom *) atomPtr)->y = coords[i].y;
+        }
+        atomPtr = atomPtr->nextPtr;
+    }
+}
+
+static void
+FreeArrowAtoms(ArrowDescr *arrowDescr)
+{
+    if (arrowDescr->arrowAtomPtr != NULL) {
+        TkPathFreeAtoms(arrowDescr->arrowAtomPtr);
+        arrowDescr->arrowAtomPtr = NULL;
+    }
+}
+
+static void
+GetArrowStyle(ArrowDescr *arrowDescr, Tk_PathStyle *const style,
+	      Tk_PathStyle *arrowStylePtr, TkPathColor *fcPtr)
+{
+    *arrowStylePtr = *style;
+    if (arrowDescr->arrowFillRatio > 0.0 &&
+	arrowDescr->arrowLength != 0.0) {
+        arrowStylePtr->strokeWidth = 0.0;
+        fcPtr->color = arrowStylePtr->strokeColor;
+        fcPtr->gradientInstPtr = NULL;
+        arrowStylePtr->fill = fcPtr;
+        arrowStylePtr->fillOpacity = arrowStylePtr->strokeOpacity;
+    } else {
+        arrowStylePtr->fill = NULL;
+        arrowStylePtr->fillOpacity = 1.0;
+        arrowStylePtr->joinStyle = 1;
+        arrowStylePtr->dashPtr = NULL;
+    }
+}
+
 void
 DisplayArrow(Tk_PathCanvas canvas, Drawable drawable, ArrowDescr *arrowDescr,
         Tk_PathStyle *const style, TMatrix *mPtr, PathRect *bboxPtr)
 {
     if (arrowDescr->arrowEnabled && arrowDescr->arrowPointsPtr != NULL) {
-        Tk_PathStyle arrowStyle = *style;
+        Tk_PathStyle arrowStyle;
         TkPathColor fc;
-        PathAtom *atomPtr;
-
-        if (arrowDescr->arrowFillRatio > 0.0 &&
-	    arrowDescr->arrowLength != 0.0) {
-            arrowStyle.strokeWidth = 0.0;
-            fc.color = arrowStyle.strokeColor;
-            fc.gradientInstPtr = NULL;
-            arrowStyle.fill = &fc;
-            arrowStyle.fillOpacity = arrowStyle.strokeOpacity;
-        } else {
-            arrowStyle.fill = NULL;
-            arrowStyle.fillOpacity = 1.0;
-            arrowStyle.joinStyle = 1;
-            arrowStyle.dashPtr = NULL;
+        TkPathContext context;
+        PathAtom *atomPtr = GetArrowAtoms(arrowDescr);
+
+        /*
+         * Not through TkPathDrawPath: arrowStyle lives on our stack and
+         * must not end up in the canvas' batch of same style items.
+         */
+
+        GetArrowStyle(arrowDescr, style, &arrowStyle, &fc);
+        context = TkPathCanvasBeginDraw(canvas, drawable);
+        if (mPtr != NULL) {
+            TkPathPushTMatrix(context, mPtr);
+        }
+        if (arrowStyle.matrixPtr != NULL) {
+            TkPathPushTMatrix(context, arrowStyle.matrixPtr);
         }
-        atomPtr = MakePathAtomsFromArrow(arrowDescr);
-        TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr,
-		       &arrowStyle, mPtr, bboxPtr);
-        TkPathFreeAtoms(atomPtr);
+        if (TkPathMakePath(context, atomPtr, &arrowStyle) == TCL_OK) {
+            TkPathPaintPath(context, atomPtr, &arrowStyle, bboxPtr);
+        }
+        TkPathCanvasEndDraw(canvas, context);
     }
 }
 
@@ -71,28 +146,14 @@ PaintArrow(TkPathContext context, ArrowDescr *arrowDescr,
 	   Tk_PathStyle *const style, PathRect *bboxPtr)
 {
     if (arrowDescr->arrowEnabled && arrowDescr->arrowPointsPtr != NULL) {
-        Tk_PathStyle arrowStyle = *style;
+        Tk_PathStyle arrowStyle;
         TkPathColor fc;
-        PathAtom *atomPtr;
-
-        if (arrowDescr->arrowFillRatio > 0.0 &&
-	    arrowDescr->arrowLength != 0.0) {
-            arrowStyle.strokeWidth = 0.0;
-            fc.color = arrowStyle.strokeColor;
-            fc.gradientInstPtr = NULL;
-            arrowStyle.fill = &fc;
-            arrowStyle.fillOpacity = arrowStyle.strokeOpacity;
-        } else {
-            arrowStyle.fill = NULL;
-            arrowStyle.fillOpacity = 1.0;
-            arrowStyle.joinStyle = 1;
-            arrowStyle.dashPtr = NULL;
-        }
-        atomPtr = MakePathAtomsFromArrow(arrowDescr);
+        PathAtom *atomPtr = GetArrowAtoms(arrowDescr);
+
+        GetArrowStyle(arrowDescr, style, &arrowStyle, &fc);
 	if (TkPathMakePath(context, atomPtr, &arrowStyle) == TCL_OK) {
 	    TkPathPaintPath(context, atomPtr, &arrowStyle, bboxPtr);
 	}
-        TkPathFreeAtoms(atomPtr);
     }
 }
 
@@ -104,6 +165,7 @@ TkPathArrowDescrInit(ArrowDescr *descrPtr)
     descrPtr->arrowWidth = (float)4.0;
     descrPtr->arrowFillRatio = (float)1.0;
     descrPtr->arrowPointsPtr = NULL;
+    descrPtr->arrowAtomPtr = NULL;
 }
 
 void
@@ -152,6 +214,7 @@ TkPathPreconfigureArrow(PathPoint *pf, ArrowDescr *arrowDescr)
         if (!arrowDescr->arrowEnabled) {
             ckfree((char *)arrowDescr->arrowPointsPtr);
             arrowDescr->arrowPointsPtr = NULL;
+            FreeArrowAtoms(arrowDescr);
         }
     }
 }
@@ -229,6 +292,8 @@ TkPathConfigureArrow(PathPoint pf, PathPoint pl, ArrowDescr *arrowDescr,
             poly[LINE_PT_IN_ARROW].y -= backup*sinTheta;
         }
 
+        FreeArrowAtoms(arrowDescr);
+        arrowDescr->arrowAtomPtr = MakePathAtomsFromArrow(arrowDescr);
         return poly[LINE_PT_IN_ARROW];
     }
     return pf;
@@ -243,6 +308,7 @@ TkPathTranslateArrow(ArrowDescr *arrowDescr, double deltaX, double deltaY)
             arrowDescr->arrowPointsPtr[i].x += deltaX;
             arrowDescr->arrowPointsPtr[i].y += deltaY;
         }
+        MoveArrowAtoms(arrowDescr);
     }
 }
 
@@ -256,8 +322,9 @@ TkPathScaleArrow(ArrowDescr *arrowDescr, double originX, double originY,
         for (i = 0, pt = arrowDescr->arrowPointsPtr;
 	     i < PTS_IN_ARROW; i++, pt++) {
             pt->x = originX + scaleX*(pt->x - originX);
-            pt->y = originX + scaleX*(pt->y - originX);
+            pt->y = originY + scaleY*(pt->y - originY);
         }
+        MoveArrowAtoms(arrowDescr);
     }
 }
 
@@ -268,6 +335,7 @@ TkPathFreeArrow(ArrowDescr *arrowDescr)
         ckfree((char *)arrowDescr->arrowPointsPtr);
         arrowDescr->arrowPointsPtr = NULL;
     }
+    FreeArrowAtoms(arrowDescr);
 }
 
 typedef PathPoint *PathPointPtr;
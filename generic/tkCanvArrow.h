@@ -39,6 +39,9 @@ typedef struct ArrowDescr
     PathPoint *arrowPointsPtr;  /* Points to array of PTS_IN_ARROW points
                                  * describing polygon for arrowhead in line.
                                  * NULL means no arrowhead at current point. */
+    PathAtom *arrowAtomPtr;     /* The arrowhead polygon as path atoms, made
+                                 * by TkPathConfigureArrow and moved with
+                                 * arrowPointsPtr. NULL if not made yet. */
 } ArrowDescr;
 
 MODULE_SCOPE void	TkPathArrowDescrInit(ArrowDescr *descr);
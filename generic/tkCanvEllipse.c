@@ -24,6 +24,8 @@ typedef struct EllipseItem  {
     double center[2];	    /* Center coord. */
     double rx;		    /* Radius. Circle uses rx for overall radius. */
     double ry;
+    PathPolyCache polyCache;/* Flattened ellipse for Area and Point functions
+			     * when transformed by a non rectilinear matrix. */
 } EllipseItem;
 
 enum {
@@ -137,7 +139,7 @@ Tk_PathItemType tkCircleType = {
     EllipseCoords,			/* coordProc */
     DeleteEllipse,			/* deleteProc */
     DisplayEllipse,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     EllipseBbox,			/* bboxProc */
     EllipseToPoint,			/* pointProc */
     EllipseToArea,			/* areaProc */
@@ -164,7 +166,7 @@ Tk_PathItemType tkEllipseType = {
     EllipseCoords,			/* coordProc */
     DeleteEllipse,			/* deleteProc */
     DisplayEllipse,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     EllipseBbox,			/* bboxProc */
     EllipseToPoint,			/* pointProc */
     EllipseToArea,			/* areaProc */
@@ -218,9 +220,11 @@ CreateAny(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->styleGen = 0;
     itemPtr->bbox = NewEmptyPathRect();
     itemPtr->totalBbox = NewEmptyPathRect();
     ellPtr->type = type;
+    PathPolyCacheInit(&ellPtr->polyCache);
 
     if (ellPtr->type == kOvalTypeCircle) {
 	optionTable = Tk_CreateOptionTable(interp, optionSpecsCircle);
@@ -290,6 +294,7 @@ ComputeEllipseBbox(Tk_PathCanvas canvas, EllipseItem *ellPtr)
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
 
+    PathPolyCacheInvalidate(&ellPtr->polyCache);
     if (state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
     }
@@ -374,6 +379,7 @@ DeleteEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
     if (itemExPtr->styleInst != NULL) {
 	TkPathFreeStyle(itemExPtr->styleInst);
     }
+    PathPolyCacheFree(&ellPtr->polyCache);
     Tk_FreeConfigOptions((char *) itemPtr, itemPtr->optionTable,
 			 Tk_PathCanvasTkwin(canvas));
 }
@@ -404,7 +410,7 @@ DisplayEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Dra
 
     itemPtr->bbox = GetBareBbox(ellPtr);
     style = TkPathCanvasInheritStyle(itemPtr, 0);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr, &style, &m, &itemPtr->bbox);
+    TkPathDrawPath(canvas, drawable, atomPtr, &style, &m, &itemPtr->bbox);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -485,7 +491,7 @@ EllipseToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
             ellAtom.rx = ellPtr->rx;
             ellAtom.ry = ellPtr->ry;
             dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr,
-                    kPathNumSegmentsEllipse+1, pointPtr);
+                    &ellPtr->polyCache, pointPtr);
         }
     }
     TkPathCanvasFreeInheritedStyle(&style);
@@ -587,7 +593,7 @@ EllipseToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
         ellAtom.rx = ellPtr->rx;
         ellAtom.ry = ellPtr->ry;
         result = GenericPathToArea(canvas, itemPtr, &style, atomPtr,
-                kPathNumSegmentsEllipse+1, areaPtr);
+                &ellPtr->polyCache, areaPtr);
     }
     TkPathCanvasFreeInheritedStyle(&style);
     return result;
@@ -645,6 +651,7 @@ ScaleEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
     ellPtr->center[1] = originY + scaleY*(ellPtr->center[1] - originY);
     ellPtr->rx *= scaleX;
     ellPtr->ry *= scaleY;
+    PathPolyCacheInvalidate(&ellPtr->polyCache);
     ScalePathRect(&itemPtr->bbox, originX, originY, scaleX, scaleY);
     ScaleItemHeader(itemPtr, originX, originY, scaleX, scaleY);
 }
@@ -659,6 +666,7 @@ TranslateEllipse(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
 
     ellPtr->center[0] += deltaX;
     ellPtr->center[1] += deltaY;
+    PathPolyCacheInvalidate(&ellPtr->polyCache);
 #if 0
     TranslatePathAtoms(ellPtr->atomPtr, deltaX, deltaY);
 #endif
@@ -18,7 +18,27 @@ enum {
     /* When childs update themself so they set all
      * its ancestors dirty bbox flag so they know
      * when they need to recompute its bbox. */
-    GROUP_FLAG_DIRTY_BBOX	    = (1L << 0)
+    GROUP_FLAG_DIRTY_BBOX	    = (1L << 0),
+    /* Same but for the -cache surface, which is rendered
+     * again and whether the subtree can be cached at all
+     * is found out anew. */
+    GROUP_FLAG_DIRTY_CACHE	    = (1L << 1),
+    /* All items of the subtree draw into a path context. */
+    GROUP_FLAG_CACHEABLE	    = (1L << 2),
+    /* Keeps GROUP_FLAG_DIRTY_CACHE over a pure translation. */
+    GROUP_FLAG_WAS_DIRTY	    = (1L << 3)
+};
+
+/*
+ * A -cache surface is not made for groups covering more pixels than this,
+ * their items are then drawn one by one as without -cache.
+ */
+
+#define GROUP_MAX_CACHE_PIXELS	(2048*2048)
+
+enum {
+    GROUP_OPTION_INDEX_CACHE =
+	(1L << (PATH_STYLE_OPTION_INDEX_END + 1))
 };
 
 /*
@@ -31,6 +51,14 @@ typedef struct GroupItem  {
     PathRect totalBbox;		/* Bounding box including stroke.
 				 * Untransformed coordinates. */
     long flags;			/* Various flags, see enum. */
+    int cache;			/* Value of -cache: render the subtree once
+				 * and composite the result until something
+				 * in it changes. */
+    TkPathContext cacheCtx;	/* Surface with the rendered subtree, or 0
+				 * if it must be rendered. */
+    int cacheX1, cacheY1,	/* Area of the subtree in canvas coordinates */
+	cacheX2, cacheY2;	/* when its cacheability was found out. */
+    TMatrix cacheMatrix;	/* Matrix of the group at the same time. */
 } GroupItem;
 
 
@@ -50,6 +78,15 @@ static void	DeleteGroup(Tk_PathCanvas canvas,
 static void	DisplayGroup(Tk_PathCanvas canvas,
 		    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
 		    int x, int y, int width, int height);
+static void	DisplayGroupChildren(Tk_PathCanvas canvas,
+		    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+		    int x, int y, int width, int height);
+static int	GetGroupCacheArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+		    PathRect *areaPtr);
+static TMatrix	GetGroupTMatrix(Tk_PathItem *itemPtr);
+static void	KeepGroupCaches(Tk_PathItem *itemPtr, int restore);
+static void	RenderGroupCache(Tk_PathCanvas canvas,
+		    Tk_PathItem *itemPtr, Display *display, Drawable drawable);
 static void	GroupBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int flags);
 static int	GroupCoords(Tcl_Interp *interp,
 		    Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
@@ -78,9 +115,15 @@ PATH_OPTION_STRING_TABLES_FILL
 PATH_OPTION_STRING_TABLES_STROKE
 PATH_OPTION_STRING_TABLES_STATE
 
+#define PATH_OPTION_SPEC_CACHE				    \
+    {TK_OPTION_BOOLEAN, "-cache", NULL, NULL,		    \
+        "0", -1, offsetof(GroupItem, cache),		    \
+        0, 0, GROUP_OPTION_INDEX_CACHE}
+
 static Tk_OptionSpec optionSpecs[] = {
     PATH_OPTION_SPEC_CORE(Tk_PathItemEx),
     PATH_OPTION_SPEC_PARENT,
+    PATH_OPTION_SPEC_CACHE,
     PATH_OPTION_SPEC_STYLE_FILL(Tk_PathItemEx, ""),
     PATH_OPTION_SPEC_STYLE_MATRIX(Tk_PathItemEx),
     PATH_OPTION_SPEC_STYLE_STROKE(Tk_PathItemEx, "black"),
@@ -101,7 +144,7 @@ Tk_PathItemType tkGroupType = {
     GroupCoords,			/* coordProc */
     DeleteGroup,			/* deleteProc */
     DisplayGroup,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     GroupBbox,				/* bboxProc */
     GroupToPoint,			/* pointProc */
     GroupToArea,			/* areaProc */
@@ -138,8 +181,11 @@ CreateGroup(Tcl_Interp *interp,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->styleGen = 0;
     groupPtr->totalBbox = NewEmptyPathRect();
-    groupPtr->flags = 0L;
+    groupPtr->flags = GROUP_FLAG_DIRTY_CACHE;
+    groupPtr->cache = 0;
+    groupPtr->cacheCtx = 0;
     itemExPtr->header.x1 = itemExPtr->header.x2 =
     itemExPtr->header.y1 = itemExPtr->header.y2 = -1;
 
@@ -174,9 +220,13 @@ ConfigureGroup(Tcl_Interp *interp, Tk_PathCanvas canvas,
     Tk_Window tkwin;
     Tk_SavedOptions savedOptions;
     Tcl_Obj *errorResult = NULL;
+    TMatrix oldMatrix = kPathUnitTMatrix, newMatrix;
     int error, mask;
 
     tkwin = Tk_PathCanvasTkwin(canvas);
+    if (itemPtr->firstChildPtr != NULL) {
+	oldMatrix = GetGroupTMatrix(itemPtr);
+    }
     for (error = 0; error <= 1; error++) {
 	if (!error) {
 	    if (Tk_SetOptions(interp, (char *) groupPtr, itemPtr->optionTable,
@@ -220,12 +270,36 @@ ConfigureGroup(Tcl_Interp *interp, Tk_PathCanvas canvas,
     stylePtr->strokeOpacity = MAX(0.0, MIN(1.0, stylePtr->strokeOpacity));
     stylePtr->fillOpacity   = MAX(0.0, MIN(1.0, stylePtr->fillOpacity));
 
+    if (!groupPtr->cache && (groupPtr->cacheCtx != 0)) {
+	TkPathFree(groupPtr->cacheCtx);
+	groupPtr->cacheCtx = 0;
+    }
+
     /*
      * We must notify all children to update themself
      * since they may inherit features.
      */
     if (!error) {
-	GroupItemConfigured(canvas, itemPtr, mask);
+	newMatrix = oldMatrix;
+	if ((mask == PATH_STYLE_OPTION_MATRIX)
+		&& (itemPtr->firstChildPtr != NULL)) {
+	    newMatrix = GetGroupTMatrix(itemPtr);
+	}
+	if ((mask == PATH_STYLE_OPTION_MATRIX)
+		&& (newMatrix.a == oldMatrix.a) && (newMatrix.b == oldMatrix.b)
+		&& (newMatrix.c == oldMatrix.c) && (newMatrix.d == oldMatrix.d)) {
+	    /*
+	     * A pure translation moves the pixels of any cached subtree
+	     * but doesn't change them, so the caches are kept.
+	     */
+
+	    KeepGroupCaches(itemPtr, 0);
+	    GroupItemConfigured(canvas, itemPtr, mask);
+	    KeepGroupCaches(itemPtr, 1);
+	} else {
+	    GroupItemConfigured(canvas, itemPtr, mask);
+	    groupPtr->flags |= GROUP_FLAG_DIRTY_CACHE;
+	}
     }
     if (error) {
 	Tcl_SetObjResult(interp, errorResult);
@@ -250,16 +324,146 @@ DeleteGroup(Tk_PathCanvas canvas,
     if (itemExPtr->styleInst != NULL) {
 	TkPathFreeStyle(itemExPtr->styleInst);
     }
+    if (groupPtr->cacheCtx != 0) {
+	TkPathFree(groupPtr->cacheCtx);
+    }
     Tk_FreeConfigOptions((char *) itemPtr, itemPtr->optionTable,
 			 Tk_PathCanvasTkwin(canvas));
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * DisplayGroup --
+ *
+ *	The children of a group display themselves, unless the group has
+ *	-cache set. Then the subtree is rendered once into a surface at
+ *	the current device scale, which is composited here until anything
+ *	in the subtree changes.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The cache surface may be rendered.
+ *
+ *----------------------------------------------------------------------
+ */
+
 static void
 DisplayGroup(Tk_PathCanvas canvas,
     Tk_PathItem *itemPtr, Display *display, Drawable drawable,
     int x, int y, int width, int height)
 {
-    /* Empty. */
+    GroupItem *groupPtr = (GroupItem *) itemPtr;
+    TkPathContext ctx;
+    short drawableX, drawableY;
+
+    if (!TkPathCanvasGroupCached(canvas, itemPtr)) {
+	return;
+    }
+    if (groupPtr->cacheCtx == 0) {
+	RenderGroupCache(canvas, itemPtr, display, drawable);
+	if (groupPtr->cacheCtx == 0) {
+	    /*
+	     * The children are left to us, so draw them without a cache.
+	     */
+
+	    DisplayGroupChildren(canvas, itemPtr, display, drawable,
+		    x, y, width, height);
+	    return;
+	}
+    }
+    Tk_PathCanvasDrawableCoords(canvas, (double) itemPtr->x1,
+	    (double) itemPtr->y1, &drawableX, &drawableY);
+    ctx = TkPathCanvasBeginDraw(canvas, drawable);
+    TkPathDrawSurface(ctx, groupPtr->cacheCtx, drawableX, drawableY);
+    TkPathCanvasEndDraw(canvas, ctx);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * RenderGroupCache --
+ *
+ *	Renders all items below a group into a new cache surface which
+ *	covers the area of the group.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets cacheCtx, unless the surface can't be made.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+RenderGroupCache(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+    Display *display, Drawable drawable)
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    GroupItem *groupPtr = (GroupItem *) itemPtr;
+    TkPathContext ctx, frameCtx;
+    int width = itemPtr->x2 - itemPtr->x1;
+    int height = itemPtr->y2 - itemPtr->y1;
+    int drawableXOrigin, drawableYOrigin;
+
+    if ((width <= 0) || (height <= 0) || (drawable != canvasPtr->frameDrawable)) {
+	return;
+    }
+    ctx = TkPathInitSurface(display, width, height);
+    if (ctx == 0) {
+	return;
+    }
+    TkPathSetTolerance(ctx, canvasPtr->tolerance);
+#ifdef TKPATH_TEST
+    canvasPtr->numCacheRenders++;
+#endif
+
+    /*
+     * The children get the surface as the frame context, and the drawable
+     * origin is moved to its top left corner.
+     */
+
+    TkPathCanvasFlushBatch(canvas);
+    frameCtx = canvasPtr->frameCtx;
+    drawableXOrigin = canvasPtr->drawableXOrigin;
+    drawableYOrigin = canvasPtr->drawableYOrigin;
+    canvasPtr->frameCtx = ctx;
+    canvasPtr->drawableXOrigin = itemPtr->x1;
+    canvasPtr->drawableYOrigin = itemPtr->y1;
+    DisplayGroupChildren(canvas, itemPtr, display, drawable,
+	    itemPtr->x1, itemPtr->y1, width, height);
+    TkPathCanvasFlushBatch(canvas);
+    canvasPtr->frameCtx = frameCtx;
+    canvasPtr->drawableXOrigin = drawableXOrigin;
+    canvasPtr->drawableYOrigin = drawableYOrigin;
+    groupPtr->cacheCtx = ctx;
+}
+
+static void
+DisplayGroupChildren(Tk_PathCanvas canvas,
+    Tk_PathItem *itemPtr, Display *display, Drawable drawable,
+    int x, int y, int width, int height)
+{
+    Tk_PathItem *walkPtr;
+
+    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL;
+	    walkPtr = walkPtr->nextPtr) {
+	if (walkPtr->typePtr == &tkGroupType) {
+	    DisplayGroupChildren(canvas, walkPtr, display, drawable,
+		    x, y, width, height);
+	    continue;
+	}
+	if (walkPtr->state == TK_PATHSTATE_HIDDEN ||
+		(walkPtr->state == TK_PATHSTATE_NULL &&
+		TkPathCanvasState(canvas) == TK_PATHSTATE_HIDDEN)) {
+	    continue;
+	}
+	(*walkPtr->typePtr->displayProc)(canvas, walkPtr, display, drawable,
+		x, y, width, height);
+    }
 }
 
 static void
@@ -355,7 +559,33 @@ void
 TkPathCanvasSetGroupDirtyBbox(Tk_PathItem *itemPtr)
 {
     GroupItem *groupPtr = (GroupItem *) itemPtr;
-    groupPtr->flags &= GROUP_FLAG_DIRTY_BBOX;
+    groupPtr->flags |= GROUP_FLAG_DIRTY_BBOX;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasSetGroupDirtyCache --
+ *
+ *	Tells us that the pixels of one or more of our childrens have
+ *	changed, so that any -cache surface must be rendered again. Only
+ *	real changes of geometry, style or contents call this; a child
+ *	that is just registered for redisplay again doesn't.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasSetGroupDirtyCache(Tk_PathItem *itemPtr)
+{
+    GroupItem *groupPtr = (GroupItem *) itemPtr;
+    groupPtr->flags |= GROUP_FLAG_DIRTY_BBOX|GROUP_FLAG_DIRTY_CACHE;
 }
 
 void
@@ -369,6 +599,197 @@ TkPathCanvasUpdateGroupBbox(Tk_PathCanvas canvas, Tk_PathItem *itemPtr)
 	groupPtr->flags &= ~GROUP_FLAG_DIRTY_BBOX;
     }
 }
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasGroupCached --
+ *
+ *	Tells whether a group draws its subtree from its -cache surface,
+ *	in which case the items below it must not display themselves.
+ *	This requires that all items in the subtree draw into the path
+ *	context and that the group's matrix differs from the one the
+ *	cache was made with by at most a translation of whole pixels.
+ *
+ * Results:
+ *	1 if the group draws from the cache, else 0.
+ *
+ * Side effects:
+ *	The bbox of the group is set to the area of the cache, which is
+ *	freed if it is stale.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkPathCanvasGroupCached(Tk_PathCanvas canvas, Tk_PathItem *itemPtr)
+{
+    GroupItem *groupPtr = (GroupItem *) itemPtr;
+    TMatrix matrix;
+    PathRect area;
+    double dx, dy;
+
+    if ((itemPtr->typePtr != &tkGroupType) || !groupPtr->cache
+	    || (itemPtr->firstChildPtr == NULL)
+	    || itemPtr->state == TK_PATHSTATE_HIDDEN
+	    || (itemPtr->state == TK_PATHSTATE_NULL
+		&& TkPathCanvasState(canvas) == TK_PATHSTATE_HIDDEN)) {
+	return 0;
+    }
+    matrix = GetGroupTMatrix(itemPtr);
+    if (!(groupPtr->flags & GROUP_FLAG_DIRTY_CACHE)) {
+	dx = matrix.tx - groupPtr->cacheMatrix.tx;
+	dy = matrix.ty - groupPtr->cacheMatrix.ty;
+	if ((matrix.a != groupPtr->cacheMatrix.a)
+		|| (matrix.b != groupPtr->cacheMatrix.b)
+		|| (matrix.c != groupPtr->cacheMatrix.c)
+		|| (matrix.d != groupPtr->cacheMatrix.d)
+		|| (fabs(dx - floor(dx + 0.5)) > 1e-6)
+		|| (fabs(dy - floor(dy + 0.5)) > 1e-6)) {
+	    groupPtr->flags |= GROUP_FLAG_DIRTY_CACHE;
+	}
+    }
+    if (groupPtr->flags & GROUP_FLAG_DIRTY_CACHE) {
+	if (groupPtr->cacheCtx != 0) {
+	    TkPathFree(groupPtr->cacheCtx);
+	    groupPtr->cacheCtx = 0;
+	}
+	groupPtr->flags &= ~(GROUP_FLAG_DIRTY_CACHE|GROUP_FLAG_CACHEABLE);
+	area = NewEmptyPathRect();
+	if (TkPathCanDrawSurface()
+		&& GetGroupCacheArea(canvas, itemPtr, &area)
+		&& ((area.x2 - area.x1) * (area.y2 - area.y1)
+		    <= GROUP_MAX_CACHE_PIXELS)) {
+	    groupPtr->flags |= GROUP_FLAG_CACHEABLE;
+	}
+	if (IsPathRectEmpty(&area)) {
+	    groupPtr->cacheX1 = groupPtr->cacheX2 = -1;
+	    groupPtr->cacheY1 = groupPtr->cacheY2 = -1;
+	} else {
+	    groupPtr->cacheX1 = (int) area.x1;
+	    groupPtr->cacheY1 = (int) area.y1;
+	    groupPtr->cacheX2 = (int) area.x2;
+	    groupPtr->cacheY2 = (int) area.y2;
+	}
+	groupPtr->cacheMatrix = matrix;
+    }
+    if (!(groupPtr->flags & GROUP_FLAG_CACHEABLE)) {
+	return 0;
+    }
+
+    /*
+     * The bbox follows any translation made since the cache was made.
+     */
+
+    dx = floor(matrix.tx - groupPtr->cacheMatrix.tx + 0.5);
+    dy = floor(matrix.ty - groupPtr->cacheMatrix.ty + 0.5);
+    itemPtr->x1 = groupPtr->cacheX1 + (int) dx;
+    itemPtr->y1 = groupPtr->cacheY1 + (int) dy;
+    itemPtr->x2 = groupPtr->cacheX2 + (int) dx;
+    itemPtr->y2 = groupPtr->cacheY2 + (int) dy;
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetGroupCacheArea --
+ *
+ *	Adds the bboxes of all visible items below a group to a rect.
+ *
+ * Results:
+ *	1 if all of them draw into the path context and can be cached,
+ *	else 0.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+GetGroupCacheArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
+    PathRect *areaPtr)
+{
+    Tk_PathItem *walkPtr;
+
+    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL;
+	    walkPtr = walkPtr->nextPtr) {
+	if (walkPtr->typePtr == &tkGroupType) {
+	    if (!GetGroupCacheArea(canvas, walkPtr, areaPtr)) {
+		return 0;
+	    }
+	    continue;
+	}
+	if (!(walkPtr->typePtr->alwaysRedraw & TK_PATH_DRAWS_IN_CONTEXT)) {
+	    return 0;
+	}
+	if (walkPtr->state == TK_PATHSTATE_HIDDEN ||
+		(walkPtr->state == TK_PATHSTATE_NULL &&
+		TkPathCanvasState(canvas) == TK_PATHSTATE_HIDDEN)) {
+	    continue;
+	}
+	if ((walkPtr->x1 >= walkPtr->x2) || (walkPtr->y1 >= walkPtr->y2)) {
+	    continue;
+	}
+	IncludePointInRect(areaPtr, walkPtr->x1, walkPtr->y1);
+	IncludePointInRect(areaPtr, walkPtr->x2, walkPtr->y2);
+    }
+    return 1;
+}
+
+/*
+ * The matrix of a group including its own, which is what its children
+ * inherit. Only valid for groups with children.
+ */
+
+static TMatrix
+GetGroupTMatrix(Tk_PathItem *itemPtr)
+{
+    return TkPathCanvasInheritTMatrix(itemPtr->firstChildPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * KeepGroupCaches --
+ *
+ *	Called around GroupItemConfigured for a pure translation of a
+ *	group. The children then report themselves as changed, but the
+ *	caches of the group and of any groups below it stay valid. With
+ *	restore 0 the GROUP_FLAG_DIRTY_CACHE flags are remembered and
+ *	with restore 1 they are put back.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Flags of groups in the subtree changed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+KeepGroupCaches(Tk_PathItem *itemPtr, int restore)
+{
+    GroupItem *groupPtr = (GroupItem *) itemPtr;
+    Tk_PathItem *walkPtr;
+
+    if (!restore) {
+	groupPtr->flags &= ~GROUP_FLAG_WAS_DIRTY;
+	if (groupPtr->flags & GROUP_FLAG_DIRTY_CACHE) {
+	    groupPtr->flags |= GROUP_FLAG_WAS_DIRTY;
+	}
+    } else if (!(groupPtr->flags & GROUP_FLAG_WAS_DIRTY)) {
+	groupPtr->flags &= ~GROUP_FLAG_DIRTY_CACHE;
+    }
+    for (walkPtr = itemPtr->firstChildPtr; walkPtr != NULL;
+	    walkPtr = walkPtr->nextPtr) {
+	if (walkPtr->typePtr == &tkGroupType) {
+	    KeepGroupCaches(walkPtr, restore);
+	}
+    }
+}
 
 /*
  * Local Variables:
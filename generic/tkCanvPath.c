@@ -30,9 +30,8 @@ typedef struct PathItem  {
     Tcl_Obj *pathObjPtr;    /* The object containing the path definition. */
     int pathLen;
     Tcl_Obj *normPathObjPtr;/* The object containing the normalized path. */
-    PathAtom *atomPtr;
-    int maxNumSegments;     /* Max number of straight segments (for subpath)
-                             * needed for Area and Point functions. */
+    TkPathData pathData;    /* The parsed path in compact storage. */
+    PathPolyCache polyCache;/* Flattened path for Area and Point functions. */
     ArrowDescr startarrow;
     ArrowDescr endarrow;
     long flags;             /* Various flags, see enum. */
@@ -84,7 +83,6 @@ static int      ConfigureArrows(Tk_PathCanvas canvas, PathItem *pathPtr);
 
 /* Support functions. */
 
-static int		GetSubpathMaxNumSegments(PathAtom *atomPtr);
 
 
 PATH_STYLE_CUSTOM_OPTION_RECORDS
@@ -118,7 +116,7 @@ Tk_PathItemType tkPathType = {
     PathCoords,			/* coordProc */
     DeletePath,			/* deleteProc */
     DisplayPath,		/* displayProc */
-    0,                          /* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,   /* flags */
     PathBbox,                   /* bboxProc */
     PathToPoint,		/* pointProc */
     PathToArea,			/* areaProc */
@@ -201,13 +199,14 @@ CreatePath(
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->styleGen = 0;
     pathPtr->pathObjPtr = NULL;
     pathPtr->pathLen = 0;
     pathPtr->normPathObjPtr = NULL;
-    pathPtr->atomPtr = NULL;
+    TkPathDataInit(&pathPtr->pathData);
     itemPtr->bbox = NewEmptyPathRect();
     itemPtr->totalBbox = NewEmptyPathRect();
-    pathPtr->maxNumSegments = 0;
+    PathPolyCacheInit(&pathPtr->polyCache);
     TkPathArrowDescrInit(&pathPtr->startarrow);
     TkPathArrowDescrInit(&pathPtr->endarrow);
     pathPtr->flags = 0L;
@@ -287,27 +286,25 @@ ProcessPath(
             if (pathPtr->normPathObjPtr != NULL) {
                 Tcl_DecrRefCount(pathPtr->normPathObjPtr);
             }
-            TkPathNormalize(interp, pathPtr->atomPtr, &(pathPtr->normPathObjPtr));
+            atomPtr = TkPathDataGetAtoms(&pathPtr->pathData);
+            TkPathNormalize(interp, atomPtr, &(pathPtr->normPathObjPtr));
+            TkPathDataFreeAtoms(atomPtr);
             Tcl_IncrRefCount(pathPtr->normPathObjPtr);
             pathPtr->flags &= ~kPathItemNeedNewNormalizedPath;
         }
         Tcl_SetObjResult(interp, pathPtr->normPathObjPtr);
         return TCL_OK;
     } else if (objc == 1) {
-        result = TkPathParseToAtoms(interp, objv[0], &atomPtr, &len);
+        /* Items made from equal paths share the parsed geometry. */
+        result = TkPathDataSetFromObj(interp, TkPathCanvasPathTable(canvas),
+                objv[0], &pathPtr->pathData, &len);
         if (result == TCL_OK) {
-
-            /* Free any old atoms. */
-            if (pathPtr->atomPtr != NULL) {
-                TkPathFreeAtoms(pathPtr->atomPtr);
-            }
-            pathPtr->atomPtr = atomPtr;
             pathPtr->pathLen = len;
             if (pathPtr->pathObjPtr != NULL) {
 		Tcl_DecrRefCount(pathPtr->pathObjPtr);
 	    }
             pathPtr->pathObjPtr = objv[0];
-            pathPtr->maxNumSegments = GetSubpathMaxNumSegments(atomPtr);
+            PathPolyCacheInvalidate(&pathPtr->polyCache);
             Tcl_IncrRefCount(pathPtr->pathObjPtr);
         }
         return result;
@@ -384,6 +381,7 @@ ComputePathBbox(
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
 
+    PathPolyCacheInvalidate(&pathPtr->polyCache);
     if (state == TK_PATHSTATE_NULL) {
         state = TkPathCanvasState(canvas);
     }
@@ -398,10 +396,10 @@ ComputePathBbox(
      * Get an approximation of the path's bounding box
      * assuming zero stroke width.
      */
-    itemPtr->bbox = GetGenericBarePathBbox(pathPtr->atomPtr);
+    itemPtr->bbox = GetPathDataBareBbox(&pathPtr->pathData);
     IncludeArrowPointsInRect(&itemPtr->bbox, &pathPtr->startarrow);
     IncludeArrowPointsInRect(&itemPtr->bbox, &pathPtr->endarrow);
-    itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(pathPtr->atomPtr,
+    itemPtr->totalBbox = GetPathDataTotalBboxFromBare(&pathPtr->pathData,
             &style, &itemPtr->bbox);
     SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr, &itemPtr->totalBbox);
     TkPathCanvasFreeInheritedStyle(&style);
@@ -415,9 +413,20 @@ ConfigureArrows(
     PathPoint psecond;
     PathPoint ppenult;
     PathPoint *plastp;
+    PathAtom *atomPtr;
+    int error;
 
-    int error = GetSegmentsFromPathAtomList(pathPtr->atomPtr, &pfirstp,
+    /*
+     * The end points are adjusted in the compact storage and not in
+     * the temporary atoms.
+     */
+    atomPtr = TkPathDataGetAtoms(&pathPtr->pathData);
+    error = GetSegmentsFromPathAtomList(atomPtr, &pfirstp,
 			&psecond, &ppenult, &plastp);
+    TkPathDataFreeAtoms(atomPtr);
+    if (error == TCL_OK) {
+        error = TkPathDataGetEndPoints(&pathPtr->pathData, &pfirstp, &plastp);
+    }
 
     if (error == TCL_OK) {
         PathPoint pfirst = *pfirstp;
@@ -429,10 +438,19 @@ ConfigureArrows(
         TkPathPreconfigureArrow(&pfirst, &pathPtr->startarrow);
         TkPathPreconfigureArrow(&plast, &pathPtr->endarrow);
 
-        *pfirstp = TkPathConfigureArrow(pfirst, psecond,
+        pfirst = TkPathConfigureArrow(pfirst, psecond,
 			&pathPtr->startarrow, lineStyle, isOpen);
-        *plastp = TkPathConfigureArrow(plast, ppenult, &pathPtr->endarrow,
+        plast = TkPathConfigureArrow(plast, ppenult, &pathPtr->endarrow,
 			lineStyle, isOpen);
+
+        /* Only copy a shared path if the end points really move. */
+        if ((pfirst.x != pfirstp->x) || (pfirst.y != pfirstp->y)
+                || (plast.x != plastp->x) || (plast.y != plastp->y)) {
+            TkPathDataUnshare(&pathPtr->pathData);
+            TkPathDataGetEndPoints(&pathPtr->pathData, &pfirstp, &plastp);
+            *pfirstp = pfirst;
+            *plastp = plast;
+        }
     } else {
         TkPathFreeArrow(&pathPtr->startarrow);
         TkPathFreeArrow(&pathPtr->endarrow);
@@ -561,10 +579,8 @@ DeletePath(
     if (pathPtr->normPathObjPtr != NULL) {
         Tcl_DecrRefCount(pathPtr->normPathObjPtr);
     }
-    if (pathPtr->atomPtr != NULL) {
-        TkPathFreeAtoms(pathPtr->atomPtr);
-        pathPtr->atomPtr = NULL;
-    }
+    TkPathDataFree(&pathPtr->pathData);
+    PathPolyCacheFree(&pathPtr->polyCache);
     TkPathFreeArrow(&pathPtr->startarrow);
     TkPathFreeArrow(&pathPtr->endarrow);
     Tk_FreeConfigOptions((char *) pathPtr, itemPtr->optionTable,
@@ -605,7 +621,7 @@ DisplayPath(
 
     if (pathPtr->pathLen > 2) {
         style = TkPathCanvasInheritStyle(itemPtr, 0);
-        TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, pathPtr->atomPtr,
+        TkPathDrawPathData(canvas, drawable, &pathPtr->pathData,
                 &style, &m, &itemPtr->bbox);
         /*
          * Display arrowheads, if they are wanted.
@@ -660,13 +676,17 @@ PathToPoint(
     double *pointPtr)		/* Pointer to x and y coordinates. */
 {
     PathItem        *pathPtr = (PathItem *) itemPtr;
-    PathAtom        *atomPtr = pathPtr->atomPtr;
+    PathAtom        *atomPtr = NULL;
     Tk_PathStyle style;
     double dist;
 
     style = TkPathCanvasInheritStyle(itemPtr, 0);
+    if (!PathPolyCacheIsValid(&pathPtr->polyCache, canvas, style.matrixPtr)) {
+        atomPtr = TkPathDataGetAtoms(&pathPtr->pathData);
+    }
     dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr,
-            pathPtr->maxNumSegments, pointPtr);
+            &pathPtr->polyCache, pointPtr);
+    TkPathDataFreeAtoms(atomPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return dist;
 }
@@ -733,119 +753,6 @@ TkLineToPoint2(
 }
 #endif
 
-/*
- * Get maximum number of segments needed to describe path.
- * Needed to see if we can use static space or need to allocate more.
- */
-
-static int
-GetArcNumSegments(double currentX, double currentY, ArcAtom *arc)
-{
-    int result;
-    int ntheta, nlength;
-    int numSteps;			/* Number of curve points to
-					 * generate.  */
-    double cx, cy, rx, ry;
-    double theta1, dtheta;
-
-    result = EndpointToCentralArcParameters(
-            currentX, currentY,
-            arc->x, arc->y, arc->radX, arc->radY,
-            DEGREES_TO_RADIANS * arc->angle,
-            arc->largeArcFlag, arc->sweepFlag,
-            &cx, &cy, &rx, &ry,
-            &theta1, &dtheta);
-    if (result == kPathArcLine) {
-        return 2;
-    } else if (result == kPathArcSkip) {
-        return 0;
-    }
-
-    /* Estimate the number of steps needed.
-     * Max 10 degrees or length 50.
-     */
-    ntheta = (int) (dtheta/5.0 + 0.5);
-    nlength = (int) (0.5*(rx + ry)*dtheta/50 + 0.5);
-    numSteps = MAX(4, MAX(ntheta, nlength));;
-    return numSteps;
-}
-
-static int
-GetSubpathMaxNumSegments(PathAtom *atomPtr)
-{
-    int			num;
-    int 		maxNumSegments;
-    double 		currentX = 0.0, currentY = 0.0;
-    double 		startX = 0.0, startY = 0.0;
-    MoveToAtom 	*move;
-    LineToAtom 	*line;
-    ArcAtom 	*arc;
-    QuadBezierAtom *quad;
-    CurveToAtom *curve;
-
-    num = 0;
-    maxNumSegments = 0;
-
-    while (atomPtr != NULL) {
-
-        switch (atomPtr->type) {
-            case PATH_ATOM_M: {
-                move = (MoveToAtom *) atomPtr;
-                num = 1;
-                currentX = move->x;
-                currentY = move->y;
-                startX = currentX;
-                startY = currentY;
-                break;
-            }
-            case PATH_ATOM_L: {
-                line = (LineToAtom *) atomPtr;
-                num++;
-                currentX = line->x;
-                currentY = line->y;
-                break;
-            }
-            case PATH_ATOM_A: {
-                arc = (ArcAtom *) atomPtr;
-                num += GetArcNumSegments(currentX, currentY, arc);
-                currentX = arc->x;
-                currentY = arc->y;
-                break;
-            }
-            case PATH_ATOM_Q: {
-                quad = (QuadBezierAtom *) atomPtr;
-                num += kPathNumSegmentsQuadBezier;
-                currentX = quad->anchorX;
-                currentY = quad->anchorY;
-                break;
-            }
-            case PATH_ATOM_C: {
-                curve = (CurveToAtom *) atomPtr;
-                num += kPathNumSegmentsCurveTo;
-                currentX = curve->anchorX;
-                currentY = curve->anchorY;
-                break;
-            }
-            case PATH_ATOM_Z: {
-                num++;
-                currentX = startX;
-                currentY = startY;
-                break;
-            }
-            case PATH_ATOM_ELLIPSE:
-            case PATH_ATOM_RECT: {
-                /* Empty. */
-                break;
-            }
-        }
-        if (num > maxNumSegments) {
-            maxNumSegments = num;
-        }
-        atomPtr = atomPtr->nextPtr;
-    }
-    return maxNumSegments;
-}
-
 /*
  *--------------------------------------------------------------
  *
@@ -878,12 +785,17 @@ PathToArea(
                              * area.  */
 {
     PathItem *pathPtr = (PathItem *) itemPtr;
+    PathAtom *atomPtr = NULL;
     Tk_PathStyle style;
     int area;
 
     style = TkPathCanvasInheritStyle(itemPtr, 0);
+    if (!PathPolyCacheIsValid(&pathPtr->polyCache, canvas, style.matrixPtr)) {
+        atomPtr = TkPathDataGetAtoms(&pathPtr->pathData);
+    }
     area = GenericPathToArea(canvas, itemPtr, &style,
-            pathPtr->atomPtr, pathPtr->maxNumSegments, areaPtr);
+            atomPtr, &pathPtr->polyCache, areaPtr);
+    TkPathDataFreeAtoms(atomPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return area;
 }
@@ -918,13 +830,13 @@ ScalePath(
     double scaleY)                  /* Amount to scale in Y direction. */
 {
     PathItem *pathPtr = (PathItem *) itemPtr;
-    PathAtom *atomPtr = pathPtr->atomPtr;
 
     CompensateScale(itemPtr, compensate, &originX, &originY, &scaleX, &scaleY);
 
     /* @@@ TODO: Arc atoms with nonzero rotation angle is WRONG! */
 
-    ScalePathAtoms(atomPtr, originX, originY, scaleX, scaleY);
+    ScalePathData(&pathPtr->pathData, originX, originY, scaleX, scaleY);
+    PathPolyCacheInvalidate(&pathPtr->polyCache);
 
     /*
      * Set flags bit so we know that PathCoords need to update the
@@ -969,11 +881,11 @@ TranslatePath(
     double deltaY)              /* moved. */
 {
     PathItem *pathPtr = (PathItem *) itemPtr;
-    PathAtom *atomPtr = pathPtr->atomPtr;
 
     CompensateTranslate(itemPtr, compensate, &deltaX, &deltaY);
 
-    TranslatePathAtoms(atomPtr, deltaX, deltaY);
+    TranslatePathData(&pathPtr->pathData, deltaX, deltaY);
+    PathPolyCacheInvalidate(&pathPtr->polyCache);
 
     /*
      * Set flags bit so we know that PathCoords need to update the
@@ -1034,9 +946,12 @@ PathToPdf(
 	return result;
     }
     if (pathPtr->pathLen > 2) {
+	PathAtom *atomPtr = TkPathDataGetAtoms(&pathPtr->pathData);
+
 	style = TkPathCanvasInheritStyle(itemPtr, 0);
-	result = TkPathPdf(interp, pathPtr->atomPtr, &style, &itemPtr->bbox,
+	result = TkPathPdf(interp, atomPtr, &style, &itemPtr->bbox,
 			   objc, objv);
+	TkPathDataFreeAtoms(atomPtr);
 	if (result == TCL_OK) {
 	    result = TkPathPdfArrow(interp, &pathPtr->startarrow, &style);
 	    if (result == TCL_OK) {
@@ -18,12 +18,15 @@
  */
 #define kPathStrokeThicknessLimit 	4.0
 
-#define MAX_NUM_STATIC_SEGMENTS  2000
-
 static void		MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
-                        int *numPointsPtr, int *numStrokesPtr, TMatrix *matrixPtr);
+                        int *numPointsPtr, int *numStrokesPtr, TMatrix *matrixPtr,
+                        double tolerance);
 static int		SubPathToArea(Tk_PathStyle *stylePtr, double *polyPtr, int numPoints,
                         int	numStrokes,	double *rectPtr, int inside);
+static void		ScaleArcParameters(double *radXPtr, double *radYPtr,
+			double *anglePtr, double scaleX, double scaleY);
+static PathRect		TotalBboxFromBare(PathAtom *atomPtr, TkPathData *dataPtr,
+			Tk_PathStyle *stylePtr, PathRect *bboxPtr);
 
 
 /*
@@ -395,6 +398,116 @@ GetGenericBarePathBbox(PathAtom *atomPtr)
     return r;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * GetPathDataBareBbox
+ *
+ *	Same as GetGenericBarePathBbox but for a path in compact
+ *	storage.
+ *
+ * Results:
+ *	A PathRect.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+PathRect
+GetPathDataBareBbox(TkPathData *dataPtr)
+{
+    double *pt = dataPtr->coords;
+    double *arc = pt + 2*dataPtr->numPoints;
+    double x1, y1, x2, y2, x3, y3;
+    double currentX = 0.0, currentY = 0.0;
+    PathRect r = {1.0e36, 1.0e36, -1.0e36, -1.0e36};
+    int i;
+
+    for (i = 0; i < dataPtr->numVerbs; i++) {
+        switch (dataPtr->verbs[i]) {
+            case PATH_ATOM_M:
+            case PATH_ATOM_L:
+                IncludePointInRect(&r, pt[0], pt[1]);
+                currentX = pt[0];
+                currentY = pt[1];
+                pt += 2;
+                break;
+            case PATH_ATOM_A: {
+                int result;
+                double cx, cy, rx, ry;
+                double theta1, dtheta;
+                int flags = (int) arc[3];
+
+                result = EndpointToCentralArcParameters(
+                        currentX, currentY, pt[0], pt[1], arc[0], arc[1],
+                        DEGREES_TO_RADIANS * arc[2],
+                        (flags & kPathDataArcLarge) ? 1 : 0,
+                        (flags & kPathDataArcSweep) ? 1 : 0,
+                        &cx, &cy, &rx, &ry,
+                        &theta1, &dtheta);
+                if (result == kPathArcLine) {
+                    IncludePointInRect(&r, pt[0], pt[1]);
+                } else if (result == kPathArcOK) {
+                    PathRect arcRect;
+
+                    arcRect = GetBareArcBbox(cx, cy, rx, ry, theta1, dtheta,
+                            DEGREES_TO_RADIANS * arc[2]);
+                    IncludePointInRect(&r, arcRect.x1, arcRect.y1);
+                    IncludePointInRect(&r, arcRect.x2, arcRect.y2);
+                }
+                currentX = pt[0];
+                currentY = pt[1];
+                arc += 4;
+                pt += 2;
+                break;
+            }
+            case PATH_ATOM_Q:
+                IncludePointInRect(&r, (currentX + pt[0])/2.0,
+                        (currentY + pt[1])/2.0);
+                IncludePointInRect(&r, (pt[0] + pt[2])/2.0,
+                        (pt[1] + pt[3])/2.0);
+                currentX = pt[2];
+                currentY = pt[3];
+                IncludePointInRect(&r, currentX, currentY);
+                pt += 4;
+                break;
+            case PATH_ATOM_C:
+                x1 = (currentX + pt[0])/2.0;
+                y1 = (currentY + pt[1])/2.0;
+                x2 = (pt[0] + pt[2])/2.0;
+                y2 = (pt[1] + pt[3])/2.0;
+                x3 = (pt[2] + pt[4])/2.0;
+                y3 = (pt[3] + pt[5])/2.0;
+                IncludePointInRect(&r, x1, y1);
+                IncludePointInRect(&r, x3, y3);
+                IncludePointInRect(&r, (x1 + x2)/2.0, (y1 + y2)/2.0);
+                IncludePointInRect(&r, (x2 + x3)/2.0, (y2 + y3)/2.0);
+                currentX = pt[4];
+                currentY = pt[5];
+                IncludePointInRect(&r, currentX, currentY);
+                pt += 6;
+                break;
+            case PATH_ATOM_Z:
+                pt += 2;
+                break;
+            case PATH_ATOM_ELLIPSE:
+                /* The second point is the corner at center + (rx, ry). */
+                IncludePointInRect(&r, 2.0*pt[0] - pt[2], 2.0*pt[1] - pt[3]);
+                IncludePointInRect(&r, pt[2], pt[3]);
+                pt += 4;
+                break;
+            case PATH_ATOM_RECT:
+                IncludePointInRect(&r, pt[0], pt[1]);
+                IncludePointInRect(&r, pt[2], pt[3]);
+                pt += 4;
+                break;
+        }
+    }
+    return r;
+}
+
 static void
 CopyPoint(double ptSrc[2], double ptDst[2])
 {
@@ -621,7 +734,7 @@ GetMiterBbox(PathAtom *atomPtr, double width, double miterLimit)
                 p1[0] = curve->ctrlX2;
                 p1[1] = curve->ctrlY2;
                 p1[0] = curve->anchorX;
-                p1[1] = curve->anchorX;
+                p1[1] = curve->anchorY;
                 npts += 2;
                 break;
             }
@@ -661,13 +774,132 @@ GetMiterBbox(PathAtom *atomPtr, double width, double miterLimit)
     return bounds;
 }
 
+/*
+ * Same as GetMiterBbox but for a path in compact storage.
+ */
+
+static PathRect
+GetPathDataMiterBbox(TkPathData *dataPtr, double width, double miterLimit)
+{
+    double	*pt = dataPtr->coords;
+    int		i, npts;
+    double 	p1[2], p2[2], p3[2];
+    double	current[2], second[2];
+    double 	sinThetaLimit;
+    PathRect	bounds = {1.0e36, 1.0e36, -1.0e36, -1.0e36};
+
+    npts = 0;
+    current[0] = 0.0;
+    current[1] = 0.0;
+    second[0] = 0.0;
+    second[1] = 0.0;
+
+    if (miterLimit > 8) {
+        sinThetaLimit = 2.0/miterLimit;
+    } else if (miterLimit > 2) {
+        sinThetaLimit = sin(2*asin(1.0/miterLimit));
+    } else {
+        return bounds;
+    }
+
+    for (i = 0; i < dataPtr->numVerbs; i++) {
+        switch (dataPtr->verbs[i]) {
+            case PATH_ATOM_M:
+                current[0] = pt[0];
+                current[1] = pt[1];
+                CopyPoint(pt, p1);
+                npts = 1;
+                pt += 2;
+                break;
+            case PATH_ATOM_L:
+                current[0] = pt[0];
+                current[1] = pt[1];
+                CopyPoint(p2, p3);
+                CopyPoint(p1, p2);
+                CopyPoint(pt, p1);
+                npts++;
+                if (npts >= 3) {
+                    IncludeMiterPointsInRect(p1, p2, p3, &bounds, width, sinThetaLimit);
+                }
+                pt += 2;
+                break;
+            case PATH_ATOM_A:
+                current[0] = pt[0];
+                current[1] = pt[1];
+                /* @@@ TODO */
+                pt += 2;
+                break;
+            case PATH_ATOM_Q:
+                current[0] = pt[2];
+                current[1] = pt[3];
+                /* The control point(s) form the tangent lines at ends. */
+                CopyPoint(p2, p3);
+                CopyPoint(p1, p2);
+                CopyPoint(pt, p1);
+                npts++;
+                if (npts >= 3) {
+                    IncludeMiterPointsInRect(p1, p2, p3, &bounds, width, sinThetaLimit);
+                }
+                CopyPoint(p1, p2);
+                CopyPoint(pt + 2, p1);
+                npts += 2;
+                pt += 4;
+                break;
+            case PATH_ATOM_C:
+                current[0] = pt[4];
+                current[1] = pt[5];
+                /* The control point(s) form the tangent lines at ends. */
+                CopyPoint(p2, p3);
+                CopyPoint(p1, p2);
+                CopyPoint(pt, p1);
+                npts++;
+                if (npts >= 3) {
+                    IncludeMiterPointsInRect(p1, p2, p3, &bounds, width, sinThetaLimit);
+                }
+                CopyPoint(pt + 4, p1);
+                npts += 2;
+                pt += 6;
+                break;
+            case PATH_ATOM_Z:
+                current[0] = pt[0];
+                current[1] = pt[1];
+                CopyPoint(p2, p3);
+                CopyPoint(p1, p2);
+                CopyPoint(pt, p1);
+                npts++;
+                if (npts >= 3) {
+                    IncludeMiterPointsInRect(p1, p2, p3, &bounds, width, sinThetaLimit);
+                }
+                /* Check also the joint of first segment with the last segment. */
+                CopyPoint(p2, p3);
+                CopyPoint(p1, p2);
+                CopyPoint(second, p1);
+                if (npts >= 3) {
+                    IncludeMiterPointsInRect(p1, p2, p3, &bounds, width, sinThetaLimit);
+                }
+                pt += 2;
+                break;
+            case PATH_ATOM_ELLIPSE:
+            case PATH_ATOM_RECT:
+                pt += 4;
+                break;
+        }
+        if (npts == 2) {
+            CopyPoint(current, second);
+        }
+    }
+
+    return bounds;
+}
+
 /*
  *--------------------------------------------------------------
  *
- * GetGenericPathTotalBboxFromBare --
+ * GetGenericPathTotalBboxFromBare, GetPathDataTotalBboxFromBare --
  *
- *	This procedure calculates the items total bbox from the
- *	bare bbox. Untransformed coords!
+ *	These procedures calculate the items total bbox from the
+ *	bare bbox, for a path as atoms or in compact storage.
+ *	Untransformed coords!
  *
  * Results:
  *	PathRect.
@@ -680,6 +912,19 @@ GetMiterBbox(PathAtom *atomPtr, double width, double miterLimit)
 
 PathRect
 GetGenericPathTotalBboxFromBare(PathAtom *atomPtr, Tk_PathStyle *stylePtr, PathRect *bboxPtr)
+{
+    return TotalBboxFromBare(atomPtr, NULL, stylePtr, bboxPtr);
+}
+
+PathRect
+GetPathDataTotalBboxFromBare(TkPathData *dataPtr, Tk_PathStyle *stylePtr, PathRect *bboxPtr)
+{
+    return TotalBboxFromBare(NULL, dataPtr, stylePtr, bboxPtr);
+}
+
+static PathRect
+TotalBboxFromBare(PathAtom *atomPtr, TkPathData *dataPtr,
+        Tk_PathStyle *stylePtr, PathRect *bboxPtr)
 {
     double fudge = 1.0;
     double width = 0.0;
@@ -697,10 +942,14 @@ GetGenericPathTotalBboxFromBare(PathAtom *atomPtr, Tk_PathStyle *stylePtr, PathR
     }
 
     /* Add the miter corners if necessary. */
-    if (atomPtr && (stylePtr->joinStyle == JoinMiter)
+    if ((atomPtr || dataPtr) && (stylePtr->joinStyle == JoinMiter)
             && (stylePtr->strokeWidth > 1.0)) {
         PathRect miterBox;
-        miterBox = GetMiterBbox(atomPtr, width, stylePtr->miterLimit);
+        if (atomPtr) {
+            miterBox = GetMiterBbox(atomPtr, width, stylePtr->miterLimit);
+        } else {
+            miterBox = GetPathDataMiterBbox(dataPtr, width, stylePtr->miterLimit);
+        }
         if (!IsPathRectEmpty(&miterBox)) {
             IncludePointInRect(&rect, miterBox.x1, miterBox.y1);
             IncludePointInRect(&rect, miterBox.x2, miterBox.y2);
@@ -779,6 +1028,170 @@ SetGenericPathHeaderBbox(
     headerPtr->y2 = (int) rect.y2;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * PathPolyCacheInit, PathPolyCacheInvalidate, PathPolyCacheFree --
+ *
+ *	Manage the flattened geometry an item keeps for its 'Area'
+ *	and 'Point' functions. Items must call PathPolyCacheInvalidate
+ *	whenever their coords change (coords, configure, scale,
+ *	translate); matrix and tolerance changes are detected
+ *	automatically.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory may be freed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+PathPolyCacheInit(PathPolyCache *cachePtr)
+{
+    memset(cachePtr, 0, sizeof(PathPolyCache));
+    cachePtr->stamp = 1;
+}
+
+void
+PathPolyCacheInvalidate(PathPolyCache *cachePtr)
+{
+    cachePtr->stamp++;
+}
+
+void
+PathPolyCacheFree(PathPolyCache *cachePtr)
+{
+    if (cachePtr->polyPtr != NULL) {
+        ckfree((char *) cachePtr->polyPtr);
+    }
+    if (cachePtr->subPtr != NULL) {
+        ckfree((char *) cachePtr->subPtr);
+    }
+    PathPolyCacheInit(cachePtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathPolyCacheIsValid --
+ *
+ *	Checks if the flattened geometry may be used as is with
+ *	the given matrix.
+ *
+ * Results:
+ *	1 if valid, else 0. Callers that need to make atoms just to
+ *	query the geometry can skip that if this returns 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+PathPolyCacheIsValid(PathPolyCache *cachePtr, Tk_PathCanvas canvas,
+        TMatrix *matrixPtr)
+{
+    if ((cachePtr->builtStamp != cachePtr->stamp)
+            || (cachePtr->tolerance != TkPathCanvasTolerance(canvas))) {
+        return 0;
+    }
+    if (matrixPtr == NULL) {
+        return !cachePtr->haveMatrix;
+    }
+    return cachePtr->haveMatrix &&
+            (memcmp(matrixPtr, &cachePtr->matrix, sizeof(TMatrix)) == 0);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * MakePolyCache --
+ *
+ *	Flattens all subpaths of atomPtr, with the matrix applied,
+ *	into the cache unless it is already valid.
+ *
+ * Results:
+ *	1 if the cache is usable, 0 if there is nothing to test
+ *	against.
+ *
+ * Side effects:
+ *	Memory may be (re)allocated.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+MakePolyCache(
+    PathPolyCache *cachePtr,
+    Tk_PathCanvas canvas,
+    PathAtom *atomPtr,
+    TMatrix *matrixPtr)
+{
+    int numPoints, numStrokes, used;
+    int maxNumSegments;		/* Max number of points of a subpath. */
+    double tolerance;
+
+    if (PathPolyCacheIsValid(cachePtr, canvas, matrixPtr)) {
+        return 1;
+    }
+    if (atomPtr == NULL) {
+        return 0;
+    }
+    tolerance = TkPathCanvasTolerance(canvas);
+    maxNumSegments = GetSubpathMaxNumSegments(atomPtr, matrixPtr, tolerance);
+
+    /* A 'M' atom must be first, may show up later as well. */
+    cachePtr->haveStart = 1;
+    if (atomPtr->type == PATH_ATOM_M) {
+	MoveToAtom *move = (MoveToAtom *) atomPtr;
+
+	PathApplyTMatrixToPoint(matrixPtr, &(move->x), cachePtr->start);
+    } else if (atomPtr->type == PATH_ATOM_ELLIPSE) {
+	EllipseAtom *ellipse = (EllipseAtom *) atomPtr;
+
+	PathApplyTMatrixToPoint(matrixPtr, &(ellipse->cx), cachePtr->start);
+    } else if (atomPtr->type == PATH_ATOM_RECT) {
+	RectAtom *rect = (RectAtom *) atomPtr;
+
+	PathApplyTMatrixToPoint(matrixPtr, &(rect->x), cachePtr->start);
+    } else {
+        cachePtr->haveStart = 0;
+    }
+
+    used = 0;
+    cachePtr->numSubpaths = 0;
+    while (atomPtr != NULL) {
+        if (used + 2*maxNumSegments > cachePtr->polySize) {
+            cachePtr->polySize = 2*(used + 2*maxNumSegments);
+            cachePtr->polyPtr = (double *) ckrealloc(
+                    (char *) cachePtr->polyPtr,
+                    (unsigned) (cachePtr->polySize*sizeof(double)));
+        }
+        if (cachePtr->numSubpaths >= cachePtr->subSize) {
+            cachePtr->subSize = 2*cachePtr->subSize + 1;
+            cachePtr->subPtr = (int *) ckrealloc((char *) cachePtr->subPtr,
+                    (unsigned) (2*cachePtr->subSize*sizeof(int)));
+        }
+        MakeSubPathSegments(&atomPtr, cachePtr->polyPtr + used,
+                &numPoints, &numStrokes, matrixPtr, tolerance);
+        cachePtr->subPtr[2*cachePtr->numSubpaths] = numPoints;
+        cachePtr->subPtr[2*cachePtr->numSubpaths+1] = numStrokes;
+        cachePtr->numSubpaths++;
+        used += 2*numPoints;
+    }
+    cachePtr->haveMatrix = (matrixPtr != NULL);
+    if (matrixPtr != NULL) {
+        cachePtr->matrix = *matrixPtr;
+    }
+    cachePtr->tolerance = tolerance;
+    cachePtr->builtStamp = cachePtr->stamp;
+    return 1;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -794,7 +1207,7 @@ SetGenericPathHeaderBbox(
  *	distance from the point to the line.
  *
  * Side effects:
- *	None.
+ *	The flattened geometry is remade in cachePtr if needed.
  *
  *--------------------------------------------------------------
  */
@@ -804,11 +1217,12 @@ GenericPathToPoint(
     Tk_PathCanvas canvas,	/* Canvas containing item. */
     Tk_PathItem *itemPtr,	/* Item to check against point. */
     Tk_PathStyle *stylePtr,
-    PathAtom *atomPtr,
-    int maxNumSegments,
+    PathAtom *atomPtr,		/* May be NULL if cachePtr is valid. */
+    PathPolyCache *cachePtr,	/* Flattened geometry of item, or NULL
+				 * to flatten atomPtr just for this call. */
     double *pointPtr)		/* Pointer to x and y coordinates. */
 {
-    int		    numPoints, numStrokes;
+    int		    i, numPoints, numStrokes;
     int		    isclosed;
     int		    intersections, nonzerorule;
     int		    sumIntersections = 0, sumNonzerorule = 0;
@@ -816,7 +1230,7 @@ GenericPathToPoint(
     double	    bestDist, radius, width, dist;
     Tk_PathState    state = itemPtr->state;
     TMatrix	    *matrixPtr = stylePtr->matrixPtr;
-    double	    staticSpace[2*MAX_NUM_STATIC_SEGMENTS];
+    PathPolyCache   tempCache;
 
     bestDist = 1.0e36;
 
@@ -826,17 +1240,12 @@ GenericPathToPoint(
     if (!HaveAnyFillFromPathColor(stylePtr->fill) && (stylePtr->strokeColor == NULL)) {
         return bestDist;
     }
-    if (atomPtr == NULL) {
-        return bestDist;
+    if (cachePtr == NULL) {
+        PathPolyCacheInit(&tempCache);
+        cachePtr = &tempCache;
     }
-
-    /*
-     * Do we need more memory or can we use static space?
-     */
-    if (maxNumSegments > MAX_NUM_STATIC_SEGMENTS) {
-        polyPtr = (double *) ckalloc((unsigned) (2*maxNumSegments*sizeof(double)));
-    } else {
-        polyPtr = staticSpace;
+    if (!MakePolyCache(cachePtr, canvas, atomPtr, matrixPtr)) {
+        return bestDist;
     }
     width = stylePtr->strokeWidth;
     if (width < 1.0) {
@@ -845,7 +1254,7 @@ GenericPathToPoint(
     radius = width/2.0;
 
     /*
-     * Loop through each subpath, creating the approximate polyline,
+     * Loop through each subpath's approximate polyline,
      * and do the *ToPoint functions.
      *
      * Note: Strokes can be treated independently for each subpath,
@@ -853,8 +1262,10 @@ GenericPathToPoint(
      *		 "holes".
      */
 
-    while (atomPtr != NULL) {
-        MakeSubPathSegments(&atomPtr, polyPtr, &numPoints, &numStrokes, matrixPtr);
+    polyPtr = cachePtr->polyPtr;
+    for (i = 0; i < cachePtr->numSubpaths; i++, polyPtr += 2*numPoints) {
+        numPoints = cachePtr->subPtr[2*i];
+        numStrokes = cachePtr->subPtr[2*i+1];
         isclosed = 0;
         if (numStrokes == numPoints) {
             isclosed = 1;
@@ -918,8 +1329,8 @@ GenericPathToPoint(
     }
 
 done:
-    if (polyPtr != staticSpace) {
-        ckfree((char *) polyPtr);
+    if (cachePtr == &tempCache) {
+        PathPolyCacheFree(&tempCache);
     }
     return bestDist;
 }
@@ -942,7 +1353,7 @@ done:
  *	inside the given area.
  *
  * Side effects:
- *	None.
+ *	The flattened geometry is remade in cachePtr if needed.
  *
  *--------------------------------------------------------------
  */
@@ -952,8 +1363,9 @@ GenericPathToArea(
     Tk_PathCanvas canvas,   /* Canvas containing item. */
     Tk_PathItem *itemPtr,   /* Item to check against line. */
     Tk_PathStyle *stylePtr,
-    PathAtom *atomPtr,
-    int maxNumSegments,
+    PathAtom *atomPtr,	    /* May be NULL if cachePtr is valid. */
+    PathPolyCache *cachePtr,/* Flattened geometry of item, or NULL
+			     * to flatten atomPtr just for this call. */
     double *areaPtr)	    /* Pointer to array of four coordinates
                              * (x1, y1, x2, y2) describing rectangular
                              * area.  */
@@ -964,13 +1376,11 @@ GenericPathToArea(
                              * inside the area;  -1 means everything
                              * was outside the area.  0 means overlap
                              * has been found. */
-    int		    numPoints = 0;
-    int		    numStrokes = 0;
+    int		    i, numPoints, numStrokes;
     double	    *polyPtr;
-    double	    currentT[2];
+    double	    *currentT;
     Tk_PathState    state = itemPtr->state;
-    TMatrix	    *matrixPtr = stylePtr->matrixPtr;
-    double	    staticSpace[2*MAX_NUM_STATIC_SEGMENTS];
+    PathPolyCache   tempCache;
 
     if (state == TK_PATHSTATE_HIDDEN) {
         return -1;
@@ -978,50 +1388,33 @@ GenericPathToArea(
     if ((GetColorFromPathColor(stylePtr->fill) == NULL) && (stylePtr->strokeColor == NULL)) {
         return -1;
     }
-    if (atomPtr == NULL) {
-        return -1;
+    if (cachePtr == NULL) {
+        PathPolyCacheInit(&tempCache);
+        cachePtr = &tempCache;
+    }
+    if (!MakePolyCache(cachePtr, canvas, atomPtr, stylePtr->matrixPtr)
+            || !cachePtr->haveStart) {
+        inside = -1;
+        goto done;
     }
 
     /*
-     * Do we need more memory or can we use static space?
+     * This defines the starting point. It is either -1 or 1.
+     * If any subseqent segment has a different 'inside'
+     * then return 0 since one port (in|out)side and another
+     * (out|in)side
      */
-    if (maxNumSegments > MAX_NUM_STATIC_SEGMENTS) {
-        polyPtr = (double *) ckalloc((unsigned) (2*maxNumSegments*sizeof(double)));
-    } else {
-        polyPtr = staticSpace;
+    currentT = cachePtr->start;
+    inside = -1;
+    if ((currentT[0] >= areaPtr[0]) && (currentT[0] <= areaPtr[2])
+            && (currentT[1] >= areaPtr[1]) && (currentT[1] <= areaPtr[3])) {
+        inside = 1;
     }
 
-    /* A 'M' atom must be first, may show up later as well. */
-    if (atomPtr->type == PATH_ATOM_M) {
-	MoveToAtom *move = (MoveToAtom *) atomPtr;
-
-	PathApplyTMatrixToPoint(matrixPtr, &(move->x), currentT);
-    } else if (atomPtr->type == PATH_ATOM_ELLIPSE) {
-	EllipseAtom *ellipse = (EllipseAtom *) atomPtr;
-
-	PathApplyTMatrixToPoint(matrixPtr, &(ellipse->cx), currentT);
-    } else if (atomPtr->type == PATH_ATOM_RECT) {
-	RectAtom *rect = (RectAtom *) atomPtr;
-
-	PathApplyTMatrixToPoint(matrixPtr, &(rect->x), currentT);
-    } else {
-        return -1;
-    }
-
-    /*
-     * This defines the starting point. It is either -1 or 1.
-     * If any subseqent segment has a different 'inside'
-     * then return 0 since one port (in|out)side and another
-     * (out|in)side
-     */
-    inside = -1;
-    if ((currentT[0] >= areaPtr[0]) && (currentT[0] <= areaPtr[2])
-            && (currentT[1] >= areaPtr[1]) && (currentT[1] <= areaPtr[3])) {
-        inside = 1;
-    }
-
-    while (atomPtr != NULL) {
-        MakeSubPathSegments(&atomPtr, polyPtr, &numPoints, &numStrokes, matrixPtr);
+    polyPtr = cachePtr->polyPtr;
+    for (i = 0; i < cachePtr->numSubpaths; i++, polyPtr += 2*numPoints) {
+        numPoints = cachePtr->subPtr[2*i];
+        numStrokes = cachePtr->subPtr[2*i+1];
         if (SubPathToArea(stylePtr, polyPtr, numPoints, numStrokes,
                 areaPtr, inside) != inside) {
             inside = 0;
@@ -1030,8 +1423,8 @@ GenericPathToArea(
     }
 
 done:
-    if (polyPtr != staticSpace) {
-        ckfree((char *) polyPtr);
+    if (cachePtr == &tempCache) {
+        PathPolyCacheFree(&tempCache);
     }
     return inside;
 }
@@ -1091,40 +1484,332 @@ ArcSegments(
 }
 
 /*
- * Get maximum number of segments needed to describe path.
- * Needed to see if we can use static space or need to allocate more.
+ *--------------------------------------------------------------
+ *
+ * TkPathCurveNumSegments, TkPathQuadBezierNumSegments,
+ *   TkPathArcNumSegments --
+ *
+ *	Find the number of straight line segments needed to flatten a
+ *	curve so that no point on it is further than 'tolerance' from
+ *	the segments. The control points must already be transformed,
+ *	so that the tolerance is in pixels.
+ *
+ *	For Bezier curves we use Wang's bound which gives the number of
+ *	uniform steps for a given tolerance from the second differences
+ *	of the control points. It is what recursive de Casteljau
+ *	subdivision converges to, but the number of points is known
+ *	before we make them.
+ *
+ * Results:
+ *	The number of segments, at least 1.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+BoundToNumSegments(
+    double bound,		/* Max deviation for a single segment. */
+    double tolerance)
+{
+    double num;
+
+    if (tolerance < kPathMinTolerance) {
+        tolerance = kPathMinTolerance;
+    }
+    num = ceil(sqrt(bound/tolerance));
+    if (!(num >= 1.0)) {
+        return 1;
+    } else if (num > kPathMaxNumSegmentsAdaptive) {
+        return kPathMaxNumSegmentsAdaptive;
+    }
+    return (int) num;
+}
+
+int
+TkPathCurveNumSegments(
+    double control[],		/* x0, y0, x1, y1, ... x3 y3. */
+    double tolerance)
+{
+    double d1, d2;
+
+    d1 = hypot(control[0] - 2.0*control[2] + control[4],
+            control[1] - 2.0*control[3] + control[5]);
+    d2 = hypot(control[2] - 2.0*control[4] + control[6],
+            control[3] - 2.0*control[5] + control[7]);
+    return BoundToNumSegments(0.75 * MAX(d1, d2), tolerance);
+}
+
+int
+TkPathQuadBezierNumSegments(
+    double control[],		/* x0, y0, x1, y1, x2, y2. */
+    double tolerance)
+{
+    double d;
+
+    d = hypot(control[0] - 2.0*control[2] + control[4],
+            control[1] - 2.0*control[3] + control[5]);
+    return BoundToNumSegments(0.25 * d, tolerance);
+}
+
+int
+TkPathArcNumSegments(
+    double radius,		/* The largest radius. */
+    double dtheta,		/* Extent of arc in radians. */
+    double tolerance)
+{
+    double step, num;
+
+    if (tolerance < kPathMinTolerance) {
+        tolerance = kPathMinTolerance;
+    }
+    if (radius <= tolerance) {
+        return 1;
+    }
+
+    /* The sagitta of a chord spanning 'step' equals the tolerance. */
+    step = 2.0 * acos(1.0 - tolerance/radius);
+    num = ceil(fabs(dtheta)/step);
+    if (!(num >= 1.0)) {
+        return 1;
+    } else if (num > kPathMaxNumSegmentsAdaptive) {
+        return kPathMaxNumSegmentsAdaptive;
+    }
+    return (int) num;
+}
+
+/*
+ * Largest scale factor of a matrix, used to get arc radii in pixels.
+ */
+
+static double
+TMatrixMaxScale(TMatrix *matrixPtr)
+{
+    if (matrixPtr == NULL) {
+        return 1.0;
+    }
+    return MAX(hypot(matrixPtr->a, matrixPtr->b),
+            hypot(matrixPtr->c, matrixPtr->d));
+}
+
+/*
+ * Number of segments needed for the arc atom when the matrix is applied.
  */
 
 static int
-GetArcNumSegments(double currentX, double currentY, ArcAtom *arc)
+GetArcNumSegments(
+    TMatrix *matrixPtr,
+    double current[2],		/* Current untransformed point. */
+    ArcAtom *arc,
+    double tolerance,
+    CentralArcPars *arcParsPtr)	/* If not NULL, filled in. */
 {
     int result;
-    int ntheta, nlength;
-    int numSteps;			/* Number of curve points to
-					 * generate.  */
     double cx, cy, rx, ry;
     double theta1, dtheta;
 
     result = EndpointToCentralArcParameters(
-            currentX, currentY,
+            current[0], current[1],
             arc->x, arc->y, arc->radX, arc->radY,
             DEGREES_TO_RADIANS * arc->angle,
             arc->largeArcFlag, arc->sweepFlag,
             &cx, &cy, &rx, &ry,
             &theta1, &dtheta);
     if (result == kPathArcLine) {
-        return 2;
+        return 1;
     } else if (result == kPathArcSkip) {
         return 0;
     }
+    if (arcParsPtr != NULL) {
+        arcParsPtr->cx = cx;
+        arcParsPtr->cy = cy;
+        arcParsPtr->rx = rx;
+        arcParsPtr->ry = ry;
+        arcParsPtr->theta1 = theta1;
+        arcParsPtr->dtheta = dtheta;
+        arcParsPtr->phi = arc->angle;
+    }
+    return TkPathArcNumSegments(MAX(rx, ry) * TMatrixMaxScale(matrixPtr),
+            dtheta, tolerance);
+}
 
-    /* Estimate the number of steps needed.
-     * Max 10 degrees or length 50.
-     */
-    ntheta = (int) (dtheta/5.0 + 0.5);
-    nlength = (int) (0.5*(rx + ry)*dtheta/50 + 0.5);
-    numSteps = MAX(4, MAX(ntheta, nlength));;
-    return numSteps;
+/*
+ * Transformed control points of quadratic and cubic Bezier atoms.
+ */
+
+static void
+QuadBezierControlPoints(
+    TMatrix *matrixPtr,
+    double current[2],
+    QuadBezierAtom *quad,
+    double control[6])
+{
+    PathApplyTMatrixToPoint(matrixPtr, current, control);
+    PathApplyTMatrixToPoint(matrixPtr, &(quad->ctrlX), control+2);
+    PathApplyTMatrixToPoint(matrixPtr, &(quad->anchorX), control+4);
+}
+
+static void
+CurveToControlPoints(
+    TMatrix *matrixPtr,
+    double current[2],
+    CurveToAtom *curve,
+    double control[8])
+{
+    PathApplyTMatrixToPoint(matrixPtr, current, control);
+    PathApplyTMatrixToPoint(matrixPtr, &(curve->ctrlX1), control+2);
+    PathApplyTMatrixToPoint(matrixPtr, &(curve->ctrlX2), control+4);
+    PathApplyTMatrixToPoint(matrixPtr, &(curve->anchorX), control+6);
+}
+
+/*
+ * We transform the three points: c, c+rx, c+ry
+ * and then compute the parameters for the transformed ellipse.
+ * This is because an affine transform of an ellipse is still an ellipse.
+ * Returns the number of points needed, including both start and stop.
+ */
+
+static int
+GetEllipseParameters(
+    TMatrix *matrixPtr,
+    EllipseAtom *ellipse,
+    double tolerance,
+    double c[2],
+    double *rxPtr, double *ryPtr, double *anglePtr)
+{
+    double rx, ry;
+    double crx[2], cry[2];
+    double p[2];
+
+    p[0] = ellipse->cx;
+    p[1] = ellipse->cy;
+    PathApplyTMatrixToPoint(matrixPtr, p, c);
+    p[0] = ellipse->cx + ellipse->rx;
+    p[1] = ellipse->cy;
+    PathApplyTMatrixToPoint(matrixPtr, p, crx);
+    p[0] = ellipse->cx;
+    p[1] = ellipse->cy + ellipse->ry;
+    PathApplyTMatrixToPoint(matrixPtr, p, cry);
+    rx = hypot(crx[0]-c[0], crx[1]-c[1]);
+    ry = hypot(cry[0]-c[0], cry[1]-c[1]);
+    *rxPtr = rx;
+    *ryPtr = ry;
+    *anglePtr = atan2(crx[1]-c[1], crx[0]-c[0]);
+
+    /* Small things wont need so many segments. */
+    if (rx+ry < 2.1) {
+        return 1;
+    }
+    return MAX(3, TkPathArcNumSegments(MAX(rx, ry), 2*M_PI, tolerance)) + 1;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetSubpathMaxNumSegments --
+ *
+ *	Get maximum number of points needed to describe any subpath
+ *	when flattened with the given matrix and tolerance.
+ *	Needed to see if we can use static space or need to allocate more.
+ *	This must be kept in sync with MakeSubPathSegments.
+ *
+ * Results:
+ *	Max number of points.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+GetSubpathMaxNumSegments(
+    PathAtom *atomPtr,
+    TMatrix *matrixPtr,
+    double tolerance)
+{
+    int 	num, maxNumSegments;
+    double 	current[2], start[2];
+    double	control[8];
+
+    num = 0;
+    maxNumSegments = 0;
+    current[0] = current[1] = 0.0;
+    start[0] = start[1] = 0.0;
+
+    while (atomPtr != NULL) {
+
+        switch (atomPtr->type) {
+            case PATH_ATOM_M: {
+                MoveToAtom *move = (MoveToAtom *) atomPtr;
+
+                num = 1;
+                current[0] = start[0] = move->x;
+                current[1] = start[1] = move->y;
+                break;
+            }
+            case PATH_ATOM_L: {
+                LineToAtom *line = (LineToAtom *) atomPtr;
+
+                num++;
+                current[0] = line->x;
+                current[1] = line->y;
+                break;
+            }
+            case PATH_ATOM_A: {
+                ArcAtom *arc = (ArcAtom *) atomPtr;
+
+                num += GetArcNumSegments(matrixPtr, current, arc,
+                        tolerance, NULL);
+                current[0] = arc->x;
+                current[1] = arc->y;
+                break;
+            }
+            case PATH_ATOM_Q: {
+                QuadBezierAtom *quad = (QuadBezierAtom *) atomPtr;
+
+                QuadBezierControlPoints(matrixPtr, current, quad, control);
+                num += TkPathQuadBezierNumSegments(control, tolerance);
+                current[0] = quad->anchorX;
+                current[1] = quad->anchorY;
+                break;
+            }
+            case PATH_ATOM_C: {
+                CurveToAtom *curve = (CurveToAtom *) atomPtr;
+
+                CurveToControlPoints(matrixPtr, current, curve, control);
+                num += TkPathCurveNumSegments(control, tolerance);
+                current[0] = curve->anchorX;
+                current[1] = curve->anchorY;
+                break;
+            }
+            case PATH_ATOM_Z: {
+                num++;
+                current[0] = start[0];
+                current[1] = start[1];
+                break;
+            }
+            case PATH_ATOM_ELLIPSE: {
+                EllipseAtom *ellipse = (EllipseAtom *) atomPtr;
+                double rx, ry, angle;
+
+                num += GetEllipseParameters(matrixPtr, ellipse, tolerance,
+                        control, &rx, &ry, &angle);
+                break;
+            }
+            case PATH_ATOM_RECT: {
+                num += 4;
+                break;
+            }
+        }
+        if (num > maxNumSegments) {
+            maxNumSegments = num;
+        }
+        atomPtr = atomPtr->nextPtr;
+    }
+    return maxNumSegments;
 }
 
 /*
@@ -1160,8 +1845,8 @@ CurveSegments(
     double u, u2, u3, t, t2, t3;
 
     /*
-     * We should use the 'de Castlejau' algorithm to iterate
-     * line segments until a certain tolerance.
+     * The number of steps is normally found from a tolerance
+     * by TkPathCurveNumSegments.
      */
 
     for (i = istart; i <= numSteps; i++, coordPtr += 2) {
@@ -1228,15 +1913,17 @@ EllipseSegments(
     int numSteps,		/* Number of curve segments to generate. */
     double *coordPtr)		/* Where to put new points. */
 {
+    int i;
     double phi, delta;
     double cosA, sinA;
     double cosPhi, sinPhi;
 
     cosA = cos(angle);
     sinA = sin(angle);
-    delta = 2*M_PI/(numSteps-1);
+    delta = (numSteps > 1) ? 2*M_PI/(numSteps-1) : 0.0;
 
-    for (phi = 0.0; phi <= 2*M_PI+1e-6; phi += delta, coordPtr += 2) {
+    for (i = 0; i < numSteps; i++, coordPtr += 2) {
+        phi = i*delta;
         cosPhi = cos(phi);
         sinPhi = sin(phi);
         coordPtr[0] = center[0] + rx*cosA*cosPhi - ry*sinA*sinPhi;
@@ -1267,27 +1954,20 @@ AddArcSegments(
     TMatrix *matrixPtr,
     double current[2],		/* Current point. */
     ArcAtom *arc,
+    double tolerance,
     double *coordPtr)		/* Where to put the points. */
 {
-    int result;
     int numPoints;
     CentralArcPars arcPars;
-    double cx, cy, rx, ry;
-    double theta1, dtheta;
 
     /*
      * Note: The arc parametrization used cannot generally
      * be transformed. Need to transform each line segment separately!
      */
 
-    result = EndpointToCentralArcParameters(
-            current[0], current[1],
-            arc->x, arc->y, arc->radX, arc->radY,
-            DEGREES_TO_RADIANS * arc->angle,
-            arc->largeArcFlag, arc->sweepFlag,
-            &cx, &cy, &rx, &ry,
-            &theta1, &dtheta);
-    if (result == kPathArcLine) {
+    numPoints = GetArcNumSegments(matrixPtr, current, arc, tolerance,
+            &arcPars);
+    if (numPoints == 1) {
         double pts[2];
 
         pts[0] = arc->x;
@@ -1296,19 +1976,9 @@ AddArcSegments(
         coordPtr[0] = pts[0];
         coordPtr[1] = pts[1];
         return 1;
-    } else if (result == kPathArcSkip) {
+    } else if (numPoints == 0) {
         return 0;
     }
-
-    arcPars.cx = cx;
-    arcPars.cy = cy;
-    arcPars.rx = rx;
-    arcPars.ry = ry;
-    arcPars.theta1 = theta1;
-    arcPars.dtheta = dtheta;
-    arcPars.phi = arc->angle;
-
-    numPoints = GetArcNumSegments(current[0], current[1], arc);
     ArcSegments(&arcPars, matrixPtr, 0, numPoints, coordPtr);
 
     return numPoints;
@@ -1319,17 +1989,15 @@ AddQuadBezierSegments(
     TMatrix *matrixPtr,
     double current[2],		/* Current point. */
     QuadBezierAtom *quad,
+    double tolerance,
     double *coordPtr)		/* Where to put the points. */
 {
     int numPoints;			/* Number of curve points to
                              * generate.  */
     double control[6];
 
-    PathApplyTMatrixToPoint(matrixPtr, current, control);
-    PathApplyTMatrixToPoint(matrixPtr, &(quad->ctrlX), control+2);
-    PathApplyTMatrixToPoint(matrixPtr, &(quad->anchorX), control+4);
-
-    numPoints = kPathNumSegmentsQuadBezier;
+    QuadBezierControlPoints(matrixPtr, current, quad, control);
+    numPoints = TkPathQuadBezierNumSegments(control, tolerance);
     QuadBezierSegments(control, 0, numPoints, coordPtr);
 
     return numPoints;
@@ -1340,19 +2008,16 @@ AddCurveToSegments(
     TMatrix *matrixPtr,
     double current[2],			/* Current point. */
     CurveToAtom *curve,
+    double tolerance,
     double *coordPtr)
 {
     int numSteps;				/* Number of curve points to
                                  * generate.  */
     double control[8];
 
-    PathApplyTMatrixToPoint(matrixPtr, current, control);
-    PathApplyTMatrixToPoint(matrixPtr, &(curve->ctrlX1), control+2);
-    PathApplyTMatrixToPoint(matrixPtr, &(curve->ctrlX2), control+4);
-    PathApplyTMatrixToPoint(matrixPtr, &(curve->anchorX), control+6);
-
-    numSteps = kPathNumSegmentsCurveTo;
-    CurveSegments(control, 1, numSteps, coordPtr);
+    CurveToControlPoints(matrixPtr, current, curve, control);
+    numSteps = TkPathCurveNumSegments(control, tolerance);
+    CurveSegments(control, 0, numSteps, coordPtr);
 
     return numSteps;
 }
@@ -1361,44 +2026,15 @@ static int
 AddEllipseToSegments(
     TMatrix *matrixPtr,
     EllipseAtom *ellipse,
+    double tolerance,
     double *coordPtr)
 {
     int numSteps;
     double rx, ry, angle;
-    double c[2], crx[2], cry[2];
-    double p[2];
+    double c[2];
 
-    /*
-     * We transform the three points: c, c+rx, c+ry
-     * and then compute the parameters for the transformed ellipse.
-     * This is because an affine transform of an ellipse is still an ellipse.
-     */
-    p[0] = ellipse->cx;
-    p[1] = ellipse->cy;
-    PathApplyTMatrixToPoint(matrixPtr, p, c);
-    p[0] = ellipse->cx + ellipse->rx;
-    p[1] = ellipse->cy;
-    PathApplyTMatrixToPoint(matrixPtr, p, crx);
-    p[0] = ellipse->cx;
-    p[1] = ellipse->cy + ellipse->ry;
-    PathApplyTMatrixToPoint(matrixPtr, p, cry);
-    rx = hypot(crx[0]-c[0], crx[1]-c[1]);
-    ry = hypot(cry[0]-c[0], cry[1]-c[1]);
-    angle = atan2(crx[1]-c[1], crx[0]-c[0]);
-
-    /* Note we add 1 here since we need both start and stop points.
-     * Small things wont need so many segments.
-     * Approximate circumference: 4(rx+ry)
-     */
-    if (rx+ry < 2.1) {
-        numSteps = 1;
-    } else if (rx+ry < 4) {
-        numSteps = 3;
-    } else if (rx+ry < kPathNumSegmentsEllipse) {
-        numSteps = (int)(rx+ry+2);
-    } else {
-        numSteps = kPathNumSegmentsEllipse + 1;
-    }
+    numSteps = GetEllipseParameters(matrixPtr, ellipse, tolerance,
+            c, &rx, &ry, &angle);
     EllipseSegments(c, rx, ry, angle, numSteps, coordPtr);
 
     return numSteps;
@@ -1449,7 +2085,8 @@ AddRectToSegments(
 
 static void
 MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
-        int *numPointsPtr, int *numStrokesPtr, TMatrix *matrixPtr)
+        int *numPointsPtr, int *numStrokesPtr, TMatrix *matrixPtr,
+        double tolerance)
 {
     int 	first = 1;
     int		numPoints;
@@ -1519,7 +2156,8 @@ MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
             case PATH_ATOM_A: {
                 ArcAtom *arc = (ArcAtom *) atomPtr;
 
-                numAdded = AddArcSegments(matrixPtr, current, arc, coordPtr);
+                numAdded = AddArcSegments(matrixPtr, current, arc,
+                        tolerance, coordPtr);
                 coordPtr += 2 * numAdded;
                 numPoints += numAdded;
                 current[0] = arc->x;
@@ -1530,7 +2168,7 @@ MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
                 QuadBezierAtom *quad = (QuadBezierAtom *) atomPtr;
 
                 numAdded = AddQuadBezierSegments(matrixPtr, current,
-                        quad, coordPtr);
+                        quad, tolerance, coordPtr);
                 coordPtr += 2 * numAdded;
                 numPoints += numAdded;
                 current[0] = quad->anchorX;
@@ -1541,7 +2179,7 @@ MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
                 CurveToAtom *curve = (CurveToAtom *) atomPtr;
 
                 numAdded = AddCurveToSegments(matrixPtr, current,
-                        curve, coordPtr);
+                        curve, tolerance, coordPtr);
                 coordPtr += 2 * numAdded;
                 numPoints += numAdded;
                 current[0] = curve->anchorX;
@@ -1567,7 +2205,8 @@ MakeSubPathSegments(PathAtom **atomPtrPtr, double *polyPtr,
                 if (first) {
                     coordPtr = polyPtr;
                 }
-                numAdded = AddEllipseToSegments(matrixPtr, ellipse, coordPtr);
+                numAdded = AddEllipseToSegments(matrixPtr, ellipse,
+                        tolerance, coordPtr);
                 coordPtr += 2 * numAdded;
                 numPoints += numAdded;
                 if (first) {
@@ -1806,28 +2445,9 @@ ScalePathAtoms(
             }
             case PATH_ATOM_A: {
                 ArcAtom *arc = (ArcAtom *) atomPtr;
-		/*
-		 * @@@ TODO: This is a very much simplified math which is WRONG!
-		 */
-		if (fabs(fmod(arc->angle, 180.0)) < 0.001) {
-		    arc->radX = scaleX*arc->radX;
-		    arc->radY = scaleY*arc->radY;
-		} else if (fabs(fmod(arc->angle, 90.0)) < 0.001) {
-		    arc->radX = scaleY*arc->radX;
-		    arc->radY = scaleX*arc->radY;
-		} else {
-		    double angle;
-		    double nx, ny;
-
-		    if (scaleX == 0.0) Tcl_Panic("singularity when scaling arc atom");
-		    angle = atan(scaleY/scaleX * tan(arc->angle * DEGREES_TO_RADIANS));
-		    nx = cos(arc->angle * DEGREES_TO_RADIANS);
-		    ny = sin(arc->angle * DEGREES_TO_RADIANS);
-
-		    arc->angle = angle * RADIANS_TO_DEGREES;
-		    arc->radX = arc->radX * hypot( scaleX*nx, scaleY*ny);
-		    arc->radY = arc->radY * hypot(-scaleX*ny, scaleY*nx);
-		}
+
+		ScaleArcParameters(&arc->radX, &arc->radY, &arc->angle,
+			scaleX, scaleY);
 		arc->x = originX + scaleX*(arc->x - originX);
 		arc->y = originY + scaleY*(arc->y - originY);
                 break;
@@ -1869,6 +2489,110 @@ ScalePathAtoms(
     }
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * ScaleArcParameters --
+ *
+ *	Scales the radii and rotation angle of an arc.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Values at radXPtr, radYPtr and anglePtr changed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+ScaleArcParameters(
+    double *radXPtr, double *radYPtr,
+    double *anglePtr,			/* In degrees. */
+    double scaleX, double scaleY)
+{
+    /*
+     * @@@ TODO: This is a very much simplified math which is WRONG!
+     */
+    if (fabs(fmod(*anglePtr, 180.0)) < 0.001) {
+	*radXPtr = scaleX * *radXPtr;
+	*radYPtr = scaleY * *radYPtr;
+    } else if (fabs(fmod(*anglePtr, 90.0)) < 0.001) {
+	*radXPtr = scaleY * *radXPtr;
+	*radYPtr = scaleX * *radYPtr;
+    } else {
+	double angle;
+	double nx, ny;
+
+	if (scaleX == 0.0) Tcl_Panic("singularity when scaling arc atom");
+	angle = atan(scaleY/scaleX * tan(*anglePtr * DEGREES_TO_RADIANS));
+	nx = cos(*anglePtr * DEGREES_TO_RADIANS);
+	ny = sin(*anglePtr * DEGREES_TO_RADIANS);
+
+	*anglePtr = angle * RADIANS_TO_DEGREES;
+	*radXPtr = *radXPtr * hypot( scaleX*nx, scaleY*ny);
+	*radYPtr = *radYPtr * hypot(-scaleX*ny, scaleY*nx);
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TranslatePathData, ScalePathData --
+ *
+ *	Translates or scales a path in compact storage. All points
+ *	are plain x,y pairs so this is a single loop over them; only
+ *	arcs need their radii and angle treated separately when
+ *	scaling. A shared path is copied first.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Path coords changed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TranslatePathData(
+    TkPathData *dataPtr,
+    double deltaX,			/* Amount by which item is to be */
+    double deltaY)			/* moved. */
+{
+    double *pt;
+    int i, n = dataPtr->numPoints;
+
+    TkPathDataUnshare(dataPtr);
+    pt = dataPtr->coords;
+    for (i = 0; i < n; i++) {
+	pt[2*i]   += deltaX;
+	pt[2*i+1] += deltaY;
+    }
+}
+
+void
+ScalePathData(
+    TkPathData *dataPtr,
+    double originX, double originY,	/* Origin about which to scale. */
+    double scaleX,			/* Amount to scale in X direction. */
+    double scaleY)			/* Amount to scale in Y direction. */
+{
+    double *pt, *arc;
+    int i, n = dataPtr->numPoints;
+
+    TkPathDataUnshare(dataPtr);
+    pt = dataPtr->coords;
+    arc = pt + 2*n;
+    for (i = 0; i < n; i++) {
+	pt[2*i]   = originX + scaleX*(pt[2*i] - originX);
+	pt[2*i+1] = originY + scaleY*(pt[2*i+1] - originY);
+    }
+    for (i = 0; i < dataPtr->numArcs; i++, arc += 4) {
+	ScaleArcParameters(&arc[0], &arc[1], &arc[2], scaleX, scaleY);
+    }
+}
+
 /*------------------*/
 
 TMatrix
@@ -2638,6 +3362,7 @@ TkPathCanvasItemExConfigure(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathIte
     Tk_PathStyle *stylePtr = &itemExPtr->style;
 
     tkwin = Tk_PathCanvasTkwin(canvas);
+    TkPathCanvasStyleChanged(itemPtr);
     if (mask & PATH_CORE_OPTION_PARENT) {
 	if (TkPathCanvasFindGroup(interp, canvas, itemPtr->parentObj, &parentPtr) != TCL_OK) {
 	    return TCL_ERROR;
@@ -2708,6 +3433,7 @@ PathGradientChangedProc(ClientData clientData, int flags)
     Tk_PathStyle *stylePtr = &(itemExPtr->style);
 
     if (flags) {
+	TkPathCanvasStyleChanged(itemPtr);
 	if (flags & PATH_GRADIENT_FLAG_DELETE) {
 	    TkPathFreePathColor(stylePtr->fill);
 	    stylePtr->fill = NULL;
@@ -2732,6 +3458,7 @@ PathStyleChangedProc(ClientData clientData, int flags)
     Tk_PathItem *itemPtr = (Tk_PathItem *) itemExPtr;
 
     if (flags) {
+	TkPathCanvasStyleChanged(itemPtr);
 	if (flags & PATH_STYLE_FLAG_DELETE) {
 	    TkPathFreeStyle(itemExPtr->styleInst);
 	    itemExPtr->styleInst = NULL;
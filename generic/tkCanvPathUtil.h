@@ -16,6 +16,28 @@
 extern "C" {
 #endif
 
+/*
+ * Flattened geometry of an item as used by the 'Area' and 'Point'
+ * functions. The polyline is only remade when the item bumps its stamp,
+ * or when the effective matrix or canvas tolerance differs from the ones
+ * it was made with.
+ */
+
+typedef struct PathPolyCache {
+    unsigned long stamp;	/* Bumped each time the geometry changes. */
+    unsigned long builtStamp;	/* Value of stamp when polyPtr was made. */
+    int haveMatrix;		/* Was a matrix applied to the points? */
+    TMatrix matrix;		/* The matrix applied, if any. */
+    double tolerance;		/* Flattening tolerance used. */
+    int haveStart;		/* Is start valid? */
+    double start[2];		/* Transformed start point of the path. */
+    double *polyPtr;		/* Points of all subpaths, back to back. */
+    int polySize;		/* Number of doubles allocated at polyPtr. */
+    int *subPtr;		/* numPoints and numStrokes for each subpath. */
+    int numSubpaths;
+    int subSize;		/* Number of subpaths allocated at subPtr. */
+} PathPolyCache;
+
 MODULE_SCOPE int	CoordsForPointItems(Tcl_Interp *interp,
 			    Tk_PathCanvas canvas,
 			    double *pointPtr, Tcl_Size objc, Tcl_Obj *const objv[]);
@@ -23,8 +45,11 @@ MODULE_SCOPE int	CoordsForRectangularItems(Tcl_Interp *interp,
 			    Tk_PathCanvas canvas,
 			    PathRect *rectPtr, Tcl_Size objc, Tcl_Obj *const objv[]);
 MODULE_SCOPE PathRect	GetGenericBarePathBbox(PathAtom *atomPtr);
+MODULE_SCOPE PathRect	GetPathDataBareBbox(TkPathData *dataPtr);
 MODULE_SCOPE PathRect	GetGenericPathTotalBboxFromBare(PathAtom *atomPtr,
 			    Tk_PathStyle *stylePtr, PathRect *bboxPtr);
+MODULE_SCOPE PathRect	GetPathDataTotalBboxFromBare(TkPathData *dataPtr,
+			    Tk_PathStyle *stylePtr, PathRect *bboxPtr);
 MODULE_SCOPE void	SetGenericPathHeaderBbox(Tk_PathItem *headerPtr,
 			    TMatrix *mPtr, PathRect *totalBboxPtr);
 MODULE_SCOPE TMatrix	GetCanvasTMatrix(Tk_PathCanvas canvas);
@@ -33,16 +58,25 @@ MODULE_SCOPE int	IsPathRectEmpty(PathRect *r);
 MODULE_SCOPE void	IncludePointInRect(PathRect *r, double x, double y);
 MODULE_SCOPE double	GenericPathToPoint(Tk_PathCanvas canvas,
 			    Tk_PathItem *itemPtr, Tk_PathStyle *stylePtr,
-			    PathAtom *atomPtr, int maxNumSegments,
+			    PathAtom *atomPtr, PathPolyCache *cachePtr,
 			    double *pointPtr);
 MODULE_SCOPE int	GenericPathToArea(Tk_PathCanvas canvas,
 			    Tk_PathItem *itemPtr, Tk_PathStyle *stylePtr,
-			    PathAtom * atomPtr, int maxNumSegments,
+			    PathAtom * atomPtr, PathPolyCache *cachePtr,
 			    double *areaPtr);
+MODULE_SCOPE void	PathPolyCacheInit(PathPolyCache *cachePtr);
+MODULE_SCOPE void	PathPolyCacheInvalidate(PathPolyCache *cachePtr);
+MODULE_SCOPE int	PathPolyCacheIsValid(PathPolyCache *cachePtr,
+			    Tk_PathCanvas canvas, TMatrix *matrixPtr);
+MODULE_SCOPE void	PathPolyCacheFree(PathPolyCache *cachePtr);
 MODULE_SCOPE void	TranslatePathAtoms(PathAtom *atomPtr, double deltaX,
 			    double deltaY);
 MODULE_SCOPE void	ScalePathAtoms(PathAtom *atomPtr, double originX,
 			    double originY, double scaleX, double scaleY);
+MODULE_SCOPE void	TranslatePathData(TkPathData *dataPtr, double deltaX,
+			    double deltaY);
+MODULE_SCOPE void	ScalePathData(TkPathData *dataPtr, double originX,
+			    double originY, double scaleX, double scaleY);
 MODULE_SCOPE void	TranslatePathRect(PathRect *r, double deltaX,
 			    double deltaY);
 MODULE_SCOPE void	ScalePathRect(PathRect *r, double originX,
@@ -79,6 +113,14 @@ MODULE_SCOPE double	PathRectToPointWithMatrix(PathRect bbox, TMatrix *mPtr,
 			    double *pointPtr);
 MODULE_SCOPE void	CurveSegments(double control[], int includeFirst,
 			    int numSteps, double *coordPtr);
+MODULE_SCOPE int	TkPathCurveNumSegments(double control[],
+			    double tolerance);
+MODULE_SCOPE int	TkPathQuadBezierNumSegments(double control[],
+			    double tolerance);
+MODULE_SCOPE int	TkPathArcNumSegments(double radius, double dtheta,
+			    double tolerance);
+MODULE_SCOPE int	GetSubpathMaxNumSegments(PathAtom *atomPtr,
+			    TMatrix *matrixPtr, double tolerance);
 
 /*
  * New API option parsing.
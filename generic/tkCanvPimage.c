@@ -46,6 +46,8 @@ typedef struct PimageItem  {
     double tintAmount;
     int interpolation;
     PathRect *srcRegionPtr;
+    void *custom;	    /* Photo converted for drawing, kept by
+			     * TkPathImage until the photo changes. */
 } PimageItem;
 
 /*
@@ -228,7 +230,7 @@ Tk_PathItemType tkPimageType = {
     PimageCoords,			/* coordProc */
     DeletePimage,			/* deleteProc */
     DisplayPimage,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     PimageBbox,				/* bboxProc */
     PimageToPoint,			/* pointProc */
     PimageToArea,			/* areaProc */
@@ -268,6 +270,7 @@ CreatePimage(Tcl_Interp *interp, Tk_PathCanvas canvas,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->styleGen = 0;
     pimagePtr->fillOpacity = 1.0;
     pimagePtr->matrixPtr = NULL;
     pimagePtr->imageObj = NULL;
@@ -280,6 +283,7 @@ CreatePimage(Tcl_Interp *interp, Tk_PathCanvas canvas,
     pimagePtr->tintAmount = 0.0;
     pimagePtr->interpolation = kPathImageInterpolationFast;
     pimagePtr->srcRegionPtr = NULL;
+    pimagePtr->custom = NULL;
     itemPtr->bbox = NewEmptyPathRect();
 
     optionTable = Tk_CreateOptionTable(interp, optionSpecs);
@@ -537,6 +541,8 @@ ConfigurePimage(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
 	    }
 	    pimagePtr->image = image;
 	    pimagePtr->photo = photo;
+	    TkPathImageFree(pimagePtr->custom);
+	    pimagePtr->custom = NULL;
 	}
 
 	/*
@@ -547,6 +553,7 @@ ConfigurePimage(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     if (!error) {
 	Tk_FreeSavedOptions(&savedOptions);
     }
+    TkPathCanvasStyleChanged(itemPtr);
     pimagePtr->fillOpacity = MAX(0.0, MIN(1.0, pimagePtr->fillOpacity));
 
     /*
@@ -573,6 +580,7 @@ DeletePimage(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
     if (pimagePtr->image != NULL) {
         Tk_FreeImage(pimagePtr->image);
     }
+    TkPathImageFree(pimagePtr->custom);
     Tk_FreeConfigOptions((char *) pimagePtr, itemPtr->optionTable,
 			 Tk_PathCanvasTkwin(canvas));
 }
@@ -586,7 +594,7 @@ DisplayPimage(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display,
     TMatrix m = GetCanvasTMatrix(canvas);
     TkPathContext ctx;
 
-    ctx = TkPathInit(Tk_PathCanvasTkwin(canvas), drawable);
+    ctx = TkPathCanvasBeginDraw(canvas, drawable);
     TkPathPushTMatrix(ctx, &m);
     m = GetTMatrix(pimagePtr);
     TkPathPushTMatrix(ctx, &m);
@@ -596,8 +604,8 @@ DisplayPimage(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display,
             pimagePtr->width, pimagePtr->height, pimagePtr->fillOpacity,
             pimagePtr->tintColor, pimagePtr->tintAmount,
 	    pimagePtr->interpolation,
-            pimagePtr->srcRegionPtr);
-    TkPathFree(ctx);
+            pimagePtr->srcRegionPtr, &pimagePtr->custom);
+    TkPathCanvasEndDraw(canvas, ctx);
 }
 
 static void
@@ -1086,6 +1094,18 @@ ImageChangedProc(
     int imgWidth, int imgHeight)/* New dimensions of image. */
 {
     PimageItem *pimagePtr = (PimageItem *) clientData;
+    Tk_PathItem *walkPtr;
+
+    /*
+     * The pixels have changed so any converted photo is stale, and so
+     * are the caches of any groups above us.
+     */
+    TkPathImageFree(pimagePtr->custom);
+    pimagePtr->custom = NULL;
+    for (walkPtr = pimagePtr->headerEx.header.parentPtr; walkPtr != NULL;
+	    walkPtr = walkPtr->parentPtr) {
+	TkPathCanvasSetGroupDirtyCache(walkPtr);
+    }
 
     /*
      * If the image's size changed and it's not anchored at its
@@ -1108,6 +1128,8 @@ ImageChangedProc(
 		pimagePtr->headerEx.header.x2, pimagePtr->headerEx.header.y2);
     }
     ComputePimageBbox(pimagePtr->headerEx.canvas, pimagePtr);
+    TkPathCanvasIndexUpdate((TkPathCanvas *) pimagePtr->headerEx.canvas,
+	    (Tk_PathItem *) pimagePtr);
     Tk_PathCanvasEventuallyRedraw(pimagePtr->headerEx.canvas,
 	    pimagePtr->headerEx.header.x1 + x,
 	    pimagePtr->headerEx.header.y1 + y,
@@ -1122,6 +1144,7 @@ PimageStyleChangedProc(ClientData clientData, int flags)
     PimageItem *pimagePtr = (PimageItem *) itemPtr;
 
     if (flags) {
+	TkPathCanvasStyleChanged(itemPtr);
 	if (flags & PATH_STYLE_FLAG_DELETE) {
 	    TkPathFreeStyle(pimagePtr->headerEx.styleInst);
 	    pimagePtr->headerEx.styleInst = NULL;
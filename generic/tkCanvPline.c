@@ -22,6 +22,7 @@ typedef struct PlineItem  {
     Tk_PathItemEx headerEx; /* Generic stuff that's the same for all
                              * path types.  MUST BE FIRST IN STRUCTURE. */
     PathRect coords;		/* Coordinates (unorders bare bbox). */
+    PathPolyCache polyCache;	/* Flattened line for Area and Point functions. */
     ArrowDescr startarrow;
     ArrowDescr endarrow;
 } PlineItem;
@@ -99,7 +100,7 @@ Tk_PathItemType tkPlineType = {
     PlineCoords,			/* coordProc */
     DeletePline,			/* deleteProc */
     DisplayPline,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     PlineBbox,				/* bboxProc */
     PlineToPoint,			/* pointProc */
     PlineToArea,			/* areaProc */
@@ -139,7 +140,9 @@ CreatePline(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPt
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->styleGen = 0;
     itemPtr->totalBbox = NewEmptyPathRect();
+    PathPolyCacheInit(&plinePtr->polyCache);
     TkPathArrowDescrInit(&plinePtr->startarrow);
     TkPathArrowDescrInit(&plinePtr->endarrow);
 
@@ -236,6 +239,7 @@ ComputePlineBbox(Tk_PathCanvas canvas, PlineItem *plinePtr)
     Tk_PathState state = itemExPtr->header.state;
     PathRect r;
 
+    PathPolyCacheInvalidate(&plinePtr->polyCache);
     if (state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
     }
@@ -331,6 +335,7 @@ DeletePline(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
     if (itemExPtr->styleInst != NULL) {
 	TkPathFreeStyle(itemExPtr->styleInst);
     }
+    PathPolyCacheFree(&plinePtr->polyCache);
     TkPathFreeArrow(&plinePtr->startarrow);
     TkPathFreeArrow(&plinePtr->endarrow);
     Tk_FreeConfigOptions((char *) itemPtr, itemPtr->optionTable,
@@ -356,7 +361,7 @@ DisplayPline(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawa
 
     atomPtr = MakePathAtoms(plinePtr);
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr, &style, &m, &r);
+    TkPathDrawPath(canvas, drawable, atomPtr, &style, &m, &r);
     TkPathFreeAtoms(atomPtr);
 
     /*
@@ -386,9 +391,12 @@ PlineToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
 
     /* @@@ Perhaps we should do a simplified treatment here instead of the generic. */
-    atomPtr = MakePathAtoms(plinePtr);
+    atomPtr = NULL;
+    if (!PathPolyCacheIsValid(&plinePtr->polyCache, canvas, style.matrixPtr)) {
+        atomPtr = MakePathAtoms(plinePtr);
+    }
     point = GenericPathToPoint(canvas, itemPtr, &style,
-            atomPtr, 2, pointPtr);
+            atomPtr, &plinePtr->polyCache, pointPtr);
     TkPathFreeAtoms(atomPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return point;
@@ -405,9 +413,12 @@ PlineToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
 
     /* @@@ Perhaps we should do a simplified treatment here instead of the generic. */
-    atomPtr = MakePathAtoms(plinePtr);
+    atomPtr = NULL;
+    if (!PathPolyCacheIsValid(&plinePtr->polyCache, canvas, style.matrixPtr)) {
+        atomPtr = MakePathAtoms(plinePtr);
+    }
     area = GenericPathToArea(canvas, itemPtr, &style,
-            atomPtr, 2, areaPtr);
+            atomPtr, &plinePtr->polyCache, areaPtr);
     TkPathFreeAtoms(atomPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return area;
@@ -480,6 +491,7 @@ TranslatePline(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
     /* Just translate the bbox as well. */
     TranslatePathRect(&itemPtr->bbox, deltaX, deltaY);
     TranslatePathRect(&plinePtr->coords, deltaX, deltaY);
+    PathPolyCacheInvalidate(&plinePtr->polyCache);
     TkPathTranslateArrow(&plinePtr->startarrow, deltaX, deltaY);
     TkPathTranslateArrow(&plinePtr->endarrow, deltaX, deltaY);
     TranslateItemHeader(itemPtr, deltaX, deltaY);
@@ -534,6 +546,7 @@ ConfigureArrows(
     newp = TkPathConfigureArrow(pl, pf, &linePtr->endarrow, lineStyle, dontFill);
     linePtr->coords.x2 = newp.x;
     linePtr->coords.y2 = newp.y;
+    PathPolyCacheInvalidate(&linePtr->polyCache);
 
     return TCL_OK;
 }
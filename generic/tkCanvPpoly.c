@@ -22,9 +22,8 @@ typedef struct PpolyItem  {
     Tk_PathItemEx headerEx; /* Generic stuff that's the same for all
                              * path types.  MUST BE FIRST IN STRUCTURE. */
     char type;		    /* Polyline or polygon. */
-    PathAtom *atomPtr;
-    int maxNumSegments;	    /* Max number of straight segments (for subpath)
-			     * needed for Area and Point functions. */
+    TkPathData pathData;    /* The points in compact storage. */
+    PathPolyCache polyCache;/* Flattened path for Area and Point functions. */
     ArrowDescr startarrow;
     ArrowDescr endarrow;
 } PpolyItem;
@@ -45,7 +44,7 @@ static int	ConfigurePpoly(Tcl_Interp *interp, Tk_PathCanvas canvas,
                         Tcl_Obj *const objv[], int flags);
 static int	CoordsForPolygonline(Tcl_Interp *interp, Tk_PathCanvas canvas,
 			int closed, Tcl_Size objc, Tcl_Obj *const objv[],
-			PathAtom **atomPtrPtr, Tcl_Size *lenPtr);
+			TkPathData *dataPtr, Tcl_Size *lenPtr);
 static int	CreateAny(Tcl_Interp *interp,
                         Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
                         Tcl_Size objc, Tcl_Obj *const objv[], char type);
@@ -121,7 +120,7 @@ Tk_PathItemType tkPolylineType = {
     PpolyCoords,			/* coordProc */
     DeletePpoly,			/* deleteProc */
     DisplayPpoly,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     PpolyBbox,				/* bboxProc */
     PpolyToPoint,			/* pointProc */
     PpolyToArea,			/* areaProc */
@@ -148,7 +147,7 @@ Tk_PathItemType tkPpolygonType = {
     PpolyCoords,			/* coordProc */
     DeletePpoly,			/* deleteProc */
     DisplayPpoly,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     PpolyBbox,				/* bboxProc */
     PpolyToPoint,			/* pointProc */
     PpolyToArea,			/* areaProc */
@@ -202,11 +201,12 @@ CreateAny(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
-    ppolyPtr->atomPtr = NULL;
+    itemExPtr->styleGen = 0;
+    TkPathDataInit(&ppolyPtr->pathData);
     ppolyPtr->type = type;
     itemPtr->bbox = NewEmptyPathRect();
     itemPtr->totalBbox = NewEmptyPathRect();
-    ppolyPtr->maxNumSegments = 0;
+    PathPolyCacheInit(&ppolyPtr->polyCache);
     TkPathArrowDescrInit(&ppolyPtr->startarrow);
     TkPathArrowDescrInit(&ppolyPtr->endarrow);
 
@@ -229,10 +229,9 @@ CreateAny(Tcl_Interp *interp, Tk_PathCanvas canvas, struct Tk_PathItem *itemPtr,
     }
     if (CoordsForPolygonline(interp, canvas,
 	    (ppolyPtr->type == kPpolyTypePolyline) ? 0 : 1,
-	    i, objv, &(ppolyPtr->atomPtr), &len) != TCL_OK) {
+	    i, objv, &ppolyPtr->pathData, &len) != TCL_OK) {
         goto error;
     }
-    ppolyPtr->maxNumSegments = len;
 
     if (ConfigurePpoly(interp, canvas, itemPtr, objc-i, objv+i, 0) == TCL_OK) {
         return TCL_OK;
@@ -258,10 +257,10 @@ PpolyCoords(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
 
     closed = (ppolyPtr->type == kPpolyTypePolyline) ? 0 : 1;
     if (CoordsForPolygonline(interp, canvas, closed, objc, objv,
-            &(ppolyPtr->atomPtr), &len) != TCL_OK) {
+            &ppolyPtr->pathData, &len) != TCL_OK) {
         return TCL_ERROR;
     }
-    ppolyPtr->maxNumSegments = len;
+    PathPolyCacheInvalidate(&ppolyPtr->polyCache);
     ConfigureArrows(canvas, ppolyPtr);
     ComputePpolyBbox(canvas, ppolyPtr);
     return TCL_OK;
@@ -275,19 +274,20 @@ ComputePpolyBbox(Tk_PathCanvas canvas, PpolyItem *ppolyPtr)
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
 
+    PathPolyCacheInvalidate(&ppolyPtr->polyCache);
     if (state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
     }
-    if ((ppolyPtr->atomPtr == NULL) || (state == TK_PATHSTATE_HIDDEN)) {
+    if ((ppolyPtr->pathData.numVerbs == 0) || (state == TK_PATHSTATE_HIDDEN)) {
         itemExPtr->header.x1 = itemExPtr->header.x2 =
         itemExPtr->header.y1 = itemExPtr->header.y2 = -1;
         return;
     }
     style = TkPathCanvasInheritStyle(itemPtr, kPathMergeStyleNotFill);
-    itemPtr->bbox = GetGenericBarePathBbox(ppolyPtr->atomPtr);
+    itemPtr->bbox = GetPathDataBareBbox(&ppolyPtr->pathData);
     IncludeArrowPointsInRect(&itemPtr->bbox, &ppolyPtr->startarrow);
     IncludeArrowPointsInRect(&itemPtr->bbox, &ppolyPtr->endarrow);
-    itemPtr->totalBbox = GetGenericPathTotalBboxFromBare(ppolyPtr->atomPtr,
+    itemPtr->totalBbox = GetPathDataTotalBboxFromBare(&ppolyPtr->pathData,
             &style, &itemPtr->bbox);
     SetGenericPathHeaderBbox(&itemExPtr->header, style.matrixPtr,
 	    &itemPtr->totalBbox);
@@ -322,9 +322,17 @@ ConfigureArrows(Tk_PathCanvas canvas, PpolyItem *ppolyPtr)
     PathPoint psecond;
     PathPoint ppenult;
     PathPoint *plastp;
+    PathAtom *atomPtr;
+    int error;
 
-    int error = GetSegmentsFromPathAtomList(ppolyPtr->atomPtr,
+    atomPtr = TkPathDataGetAtoms(&ppolyPtr->pathData);
+    error = GetSegmentsFromPathAtomList(atomPtr,
 			&pfirstp, &psecond, &ppenult, &plastp);
+    TkPathDataFreeAtoms(atomPtr);
+    if (error == TCL_OK) {
+        error = TkPathDataGetEndPoints(&ppolyPtr->pathData,
+			&pfirstp, &plastp);
+    }
 
     if (error == TCL_OK) {
         PathPoint pfirst = *pfirstp;
@@ -412,10 +420,8 @@ DeletePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
     if (itemExPtr->styleInst != NULL) {
 	TkPathFreeStyle(itemExPtr->styleInst);
     }
-    if (ppolyPtr->atomPtr != NULL) {
-        TkPathFreeAtoms(ppolyPtr->atomPtr);
-        ppolyPtr->atomPtr = NULL;
-    }
+    TkPathDataFree(&ppolyPtr->pathData);
+    PathPolyCacheFree(&ppolyPtr->polyCache);
     TkPathFreeArrow(&ppolyPtr->startarrow);
     TkPathFreeArrow(&ppolyPtr->endarrow);
     Tk_FreeConfigOptions((char *) itemPtr, itemPtr->optionTable,
@@ -431,7 +437,7 @@ DisplayPpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display,
     Tk_PathStyle style;
 
     style = TkPathCanvasInheritStyle(itemPtr, 0);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, ppolyPtr->atomPtr,
+    TkPathDrawPathData(canvas, drawable, &ppolyPtr->pathData,
 	    &style, &m, &itemPtr->bbox);
     /*
      * Display arrowheads, if they are wanted.
@@ -454,6 +460,7 @@ static double
 PpolyToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
 {
     PpolyItem *ppolyPtr = (PpolyItem *) itemPtr;
+    PathAtom *atomPtr = NULL;
     Tk_PathStyle style;
     double dist;
     long flags;
@@ -461,8 +468,12 @@ PpolyToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
     flags = (ppolyPtr->type == kPpolyTypePolyline) ?
 	    kPathMergeStyleNotFill : 0;
     style = TkPathCanvasInheritStyle(itemPtr, flags);
-    dist = GenericPathToPoint(canvas, itemPtr, &style, ppolyPtr->atomPtr,
-            ppolyPtr->maxNumSegments, pointPtr);
+    if (!PathPolyCacheIsValid(&ppolyPtr->polyCache, canvas, style.matrixPtr)) {
+        atomPtr = TkPathDataGetAtoms(&ppolyPtr->pathData);
+    }
+    dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr,
+            &ppolyPtr->polyCache, pointPtr);
+    TkPathDataFreeAtoms(atomPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return dist;
 }
@@ -471,6 +482,7 @@ static int
 PpolyToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
 {
     PpolyItem *ppolyPtr = (PpolyItem *) itemPtr;
+    PathAtom *atomPtr = NULL;
     Tk_PathStyle style;
     int area;
     long flags;
@@ -478,8 +490,12 @@ PpolyToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
     flags = (ppolyPtr->type == kPpolyTypePolyline) ?
 	    kPathMergeStyleNotFill : 0;
     style = TkPathCanvasInheritStyle(itemPtr, flags);
+    if (!PathPolyCacheIsValid(&ppolyPtr->polyCache, canvas, style.matrixPtr)) {
+        atomPtr = TkPathDataGetAtoms(&ppolyPtr->pathData);
+    }
     area = GenericPathToArea(canvas, itemPtr, &style,
-            ppolyPtr->atomPtr, ppolyPtr->maxNumSegments, areaPtr);
+            atomPtr, &ppolyPtr->polyCache, areaPtr);
+    TkPathDataFreeAtoms(atomPtr);
     TkPathCanvasFreeInheritedStyle(&style);
     return area;
 }
@@ -491,17 +507,20 @@ PpolyToPdf(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     Tk_PathStyle style;
     PpolyItem *ppolyPtr = (PpolyItem *) itemPtr;
     Tk_PathState state = itemPtr->state;
+    PathAtom *atomPtr;
     int result;
 
     if (state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
     }
-    if ((ppolyPtr->atomPtr == NULL) || (state == TK_PATHSTATE_HIDDEN)) {
+    if ((ppolyPtr->pathData.numVerbs == 0) || (state == TK_PATHSTATE_HIDDEN)) {
 	return TCL_OK;
     }
     style = TkPathCanvasInheritStyle(itemPtr, 0);
-    result = TkPathPdf(interp, ppolyPtr->atomPtr, &style, &itemPtr->bbox,
+    atomPtr = TkPathDataGetAtoms(&ppolyPtr->pathData);
+    result = TkPathPdf(interp, atomPtr, &style, &itemPtr->bbox,
 		       objc, objv);
+    TkPathDataFreeAtoms(atomPtr);
     if (result == TCL_OK) {
 	result = TkPathPdfArrow(interp, &ppolyPtr->startarrow, &style);
 	if (result == TCL_OK) {
@@ -529,7 +548,8 @@ ScalePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
 
     CompensateScale(itemPtr, compensate, &originX, &originY, &scaleX, &scaleY);
 
-    ScalePathAtoms(ppolyPtr->atomPtr, originX, originY, scaleX, scaleY);
+    ScalePathData(&ppolyPtr->pathData, originX, originY, scaleX, scaleY);
+    PathPolyCacheInvalidate(&ppolyPtr->polyCache);
     ScalePathRect(&itemPtr->bbox, originX, originY, scaleX, scaleY);
     TkPathScaleArrow(&ppolyPtr->startarrow, originX, originY, scaleX, scaleY);
     TkPathScaleArrow(&ppolyPtr->endarrow, originX, originY, scaleX, scaleY);
@@ -545,7 +565,8 @@ TranslatePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
 
     CompensateTranslate(itemPtr, compensate, &deltaX, &deltaY);
 
-    TranslatePathAtoms(ppolyPtr->atomPtr, deltaX, deltaY);
+    TranslatePathData(&ppolyPtr->pathData, deltaX, deltaY);
+    PathPolyCacheInvalidate(&ppolyPtr->polyCache);
     TranslatePathRect(&itemPtr->bbox, deltaX, deltaY);
     TkPathTranslateArrow(&ppolyPtr->startarrow, deltaX, deltaY);
     TkPathTranslateArrow(&ppolyPtr->endarrow, deltaX, deltaY);
@@ -563,7 +584,7 @@ TranslatePpoly(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
  *		Standard tcl result.
  *
  * Side effects:
- *		May store new atoms in atomPtrPtr and max number of points
+ *		May store new points in dataPtr and max number of points
  *		in lenPtr.
  *
  *--------------------------------------------------------------
@@ -576,37 +597,21 @@ CoordsForPolygonline(
     int closed,				/* Polyline (0) or polygon (1) */
     Tcl_Size objc,
     Tcl_Obj *const objv[],
-    PathAtom **atomPtrPtr,
+    TkPathData *dataPtr,
     Tcl_Size *lenPtr)
 {
-    PathAtom *atomPtr = *atomPtrPtr;
-
     if (objc == 0) {
         Tcl_Obj *obj = Tcl_NewListObj(0, (Tcl_Obj **) NULL);
-
-        while (atomPtr != NULL) {
-            switch (atomPtr->type) {
-                case PATH_ATOM_M: {
-                    MoveToAtom *move = (MoveToAtom *) atomPtr;
-                    Tcl_ListObjAppendElement(interp, obj, Tcl_NewDoubleObj(move->x));
-                    Tcl_ListObjAppendElement(interp, obj, Tcl_NewDoubleObj(move->y));
-                    break;
-                }
-                case PATH_ATOM_L: {
-                    LineToAtom *line = (LineToAtom *) atomPtr;
-                    Tcl_ListObjAppendElement(interp, obj, Tcl_NewDoubleObj(line->x));
-                    Tcl_ListObjAppendElement(interp, obj, Tcl_NewDoubleObj(line->y));
-                    break;
-                }
-                case PATH_ATOM_Z: {
-
-                    break;
-                }
-                default: {
-                    /* empty */
-                }
+        int i;
+
+        /* Only M and L are made here, and each has a single point. */
+        for (i = 0; i < dataPtr->numVerbs; i++) {
+            if (dataPtr->verbs[i] != PATH_ATOM_Z) {
+                Tcl_ListObjAppendElement(interp, obj,
+                        Tcl_NewDoubleObj(dataPtr->coords[2*i]));
+                Tcl_ListObjAppendElement(interp, obj,
+                        Tcl_NewDoubleObj(dataPtr->coords[2*i+1]));
             }
-            atomPtr = atomPtr->nextPtr;
         }
         Tcl_SetObjResult(interp, obj);
         *lenPtr = 0;
@@ -630,44 +635,27 @@ CoordsForPolygonline(
         return TCL_ERROR;
     } else {
         Tcl_Size i;
-        double	x, y;
-        double	firstX = 0.0, firstY = 0.0;
-        PathAtom *firstAtomPtr = NULL;
+        double *pointsPtr;
 
         /*
-        * Free any old stuff.
-        */
-        if (atomPtr != NULL) {
-            TkPathFreeAtoms(atomPtr);
-            atomPtr = NULL;
-        }
-        for (i = 0; i < objc; i += 2) {
-            if (Tk_PathCanvasGetCoordFromObj(interp, canvas, objv[i], &x) != TCL_OK) {
-                /* @@@ error recovery? */
-                return TCL_ERROR;
-            }
-            if (Tk_PathCanvasGetCoordFromObj(interp, canvas, objv[i+1], &y) != TCL_OK) {
+         * Read all coords before touching the old points so that
+         * an error leaves the item as it was.
+         */
+        pointsPtr = (double *) ckalloc(objc * sizeof(double));
+        for (i = 0; i < objc; i++) {
+            if (Tk_PathCanvasGetCoordFromObj(interp, canvas, objv[i],
+                    &pointsPtr[i]) != TCL_OK) {
+                ckfree((char *) pointsPtr);
                 return TCL_ERROR;
             }
-            if (i == 0) {
-                firstX = x;
-                firstY = y;
-                atomPtr = NewMoveToAtom(x, y);
-                firstAtomPtr = atomPtr;
-            } else {
-                atomPtr->nextPtr = NewLineToAtom(x, y);
-                atomPtr = atomPtr->nextPtr;
-            }
         }
-        if (closed) {
-            atomPtr->nextPtr = NewCloseAtom(firstX, firstY);
-        }
-        *atomPtrPtr = firstAtomPtr;
-        *lenPtr = i/2 + 2;
+        TkPathDataFromPoints(dataPtr, pointsPtr, (int) (objc/2), closed);
+        ckfree((char *) pointsPtr);
+        *lenPtr = objc/2 + 2;
     }
     return TCL_OK;
 }
-
+
 /*
  * Local Variables:
  * mode: c
@@ -22,8 +22,8 @@ typedef struct PrectItem  {
                              * path types.  MUST BE FIRST IN STRUCTURE. */
     double rx;		    /* Radius of corners. */
     double ry;
-    int maxNumSegments;	    /* Max number of straight segments (for subpath)
-                             * needed for Area and Point functions. */
+    PathPolyCache polyCache;/* Flattened rounded rect for Area and Point
+                             * functions. */
 } PrectItem;
 
 /*
@@ -112,7 +112,7 @@ Tk_PathItemType tkPrectType = {
     PrectCoords,			/* coordProc */
     DeletePrect,			/* deleteProc */
     DisplayPrect,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     PrectBbox,				/* bboxProc */
     PrectToPoint,			/* pointProc */
     PrectToArea,			/* areaProc */
@@ -153,9 +153,10 @@ CreatePrect(Tcl_Interp *interp, Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->styleGen = 0;
     itemPtr->bbox = NewEmptyPathRect();
     itemPtr->totalBbox = NewEmptyPathRect();
-    prectPtr->maxNumSegments = 100;		/* Crude overestimate. */
+    PathPolyCacheInit(&prectPtr->polyCache);
 
     optionTable = Tk_CreateOptionTable(interp, optionSpecs);
     itemPtr->optionTable = optionTable;
@@ -209,6 +210,7 @@ ComputePrectBbox(Tk_PathCanvas canvas, PrectItem *prectPtr)
     Tk_PathStyle style;
     Tk_PathState state = itemExPtr->header.state;
 
+    PathPolyCacheInvalidate(&prectPtr->polyCache);
     if (state == TK_PATHSTATE_NULL) {
 	state = TkPathCanvasState(canvas);
     }
@@ -306,6 +308,7 @@ DeletePrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display)
     if (itemExPtr->styleInst != NULL) {
 	TkPathFreeStyle(itemExPtr->styleInst);
     }
+    PathPolyCacheFree(&prectPtr->polyCache);
     Tk_FreeConfigOptions((char *) itemPtr, itemPtr->optionTable,
 			 Tk_PathCanvasTkwin(canvas));
 }
@@ -321,7 +324,7 @@ DisplayPrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display, Drawa
 
     style = TkPathCanvasInheritStyle(itemPtr, 0);
     atomPtr = MakePathAtoms(prectPtr);
-    TkPathDrawPath(Tk_PathCanvasTkwin(canvas), drawable, atomPtr,
+    TkPathDrawPath(canvas, drawable, atomPtr,
 	    &style, &m, &itemPtr->bbox);
     TkPathFreeAtoms(atomPtr);
     TkPathCanvasFreeInheritedStyle(&style);
@@ -375,9 +378,14 @@ PrectToPoint(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *pointPtr)
     if (rectiLinear) {
         dist = PathRectToPoint(bareRect, width, filled, pointPtr);
     } else {
-	PathAtom *atomPtr = MakePathAtoms(prectPtr);
+	PathAtom *atomPtr = NULL;
+
+	if (!PathPolyCacheIsValid(&prectPtr->polyCache, canvas,
+		style.matrixPtr)) {
+	    atomPtr = MakePathAtoms(prectPtr);
+	}
         dist = GenericPathToPoint(canvas, itemPtr, &style, atomPtr,
-            prectPtr->maxNumSegments, pointPtr);
+            &prectPtr->polyCache, pointPtr);
 	TkPathFreeAtoms(atomPtr);
     }
     TkPathCanvasFreeInheritedStyle(&style);
@@ -426,9 +434,14 @@ PrectToArea(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, double *areaPtr)
     if (rectiLinear) {
         area = PathRectToArea(bareRect, width, filled, areaPtr);
     } else {
-	PathAtom *atomPtr = MakePathAtoms(prectPtr);
+	PathAtom *atomPtr = NULL;
+
+	if (!PathPolyCacheIsValid(&prectPtr->polyCache, canvas,
+		style.matrixPtr)) {
+	    atomPtr = MakePathAtoms(prectPtr);
+	}
         area = GenericPathToArea(canvas, itemPtr, &style,
-                atomPtr, prectPtr->maxNumSegments, areaPtr);
+                atomPtr, &prectPtr->polyCache, areaPtr);
 	TkPathFreeAtoms(atomPtr);
     }
     TkPathCanvasFreeInheritedStyle(&style);
@@ -477,9 +490,12 @@ static void
 ScalePrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
     double originX, double originY, double scaleX, double scaleY)
 {
+    PrectItem *prectPtr = (PrectItem *) itemPtr;
+
     CompensateScale(itemPtr, compensate, &originX, &originY, &scaleX, &scaleY);
 
     ScalePathRect(&itemPtr->bbox, originX, originY, scaleX, scaleY);
+    PathPolyCacheInvalidate(&prectPtr->polyCache);
     ScaleItemHeader(itemPtr, originX, originY, scaleX, scaleY);
 }
 
@@ -487,10 +503,13 @@ static void
 TranslatePrect(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
     double deltaX, double deltaY)
 {
+    PrectItem *prectPtr = (PrectItem *) itemPtr;
+
     CompensateTranslate(itemPtr, compensate, &deltaX, &deltaY);
 
     /* Just translate the bbox'es as well. */
     TranslatePathRect(&itemPtr->bbox, deltaX, deltaY);
+    PathPolyCacheInvalidate(&prectPtr->polyCache);
     TranslateItemHeader(itemPtr, deltaX, deltaY);
 }
 
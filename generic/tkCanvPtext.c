@@ -207,7 +207,7 @@ Tk_PathItemType tkPtextType = {
     PtextCoords,			/* coordProc */
     DeletePtext,			/* deleteProc */
     DisplayPtext,			/* displayProc */
-    0,					/* flags */
+    TK_PATH_DRAWS_IN_CONTEXT,		/* flags */
     PtextBbox,				/* bboxProc */
     PtextToPoint,			/* pointProc */
     PtextToArea,			/* areaProc */
@@ -248,6 +248,7 @@ CreatePtext(Tcl_Interp *interp, Tk_PathCanvas canvas,
     itemExPtr->canvas = canvas;
     itemExPtr->styleObj = NULL;
     itemExPtr->styleInst = NULL;
+    itemExPtr->styleGen = 0;
     itemPtr->bbox = NewEmptyPathRect();
     ptextPtr->utf8Obj = NULL;
     ptextPtr->numChars = 0;
@@ -565,7 +566,7 @@ DisplayPtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display,
 	style.strokeColor = itemExPtr->style.strokeColor;
     }
 
-    ctx = TkPathInit(Tk_PathCanvasTkwin(canvas), drawable);
+    ctx = TkPathCanvasBeginDraw(canvas, drawable);
     TkPathPushTMatrix(ctx, &m);
     if (style.matrixPtr != NULL) {
         TkPathPushTMatrix(ctx, style.matrixPtr);
@@ -581,7 +582,7 @@ DisplayPtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, Display *display,
 		   ptextPtr->fillOverStroke,
 		   Tcl_GetString(ptextPtr->utf8Obj), ptextPtr->custom);
     TkPathEndPath(ctx);
-    TkPathFree(ctx);
+    TkPathCanvasEndDraw(canvas, ctx);
     TkPathCanvasFreeInheritedStyle(&style);
 }
 
@@ -909,6 +910,105 @@ TranslatePtext(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
     TranslateItemHeader(itemPtr, deltaX, deltaY);
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * TextMeasureObjCmd --
+ *
+ *	Implements the ::tkp::textmeasure command which measures many
+ *	strings at once, the same way as ptext items are measured:
+ *
+ *	    ::tkp::textmeasure ?-fontfamily family? ?-fontsize size?
+ *		    ?-fontslant slant? ?-fontweight weight? textList
+ *
+ * Results:
+ *	A standard Tcl result. The result is a list with the bbox
+ *	{x1 y1 x2 y2} of each string, relative to its start on the
+ *	baseline.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+TextMeasureObjCmd(ClientData clientData, Tcl_Interp *interp,
+    int objc, Tcl_Obj *const objv[])
+{
+    static const char *optionStrings[] = {
+	"-fontfamily", "-fontsize", "-fontslant", "-fontweight", NULL
+    };
+    enum {
+	OPT_FONTFAMILY, OPT_FONTSIZE, OPT_FONTSLANT, OPT_FONTWEIGHT
+    };
+    Tk_Window tkwin = (Tk_Window) clientData;
+    Tk_PathTextStyle textStyle;
+    Tcl_Obj **textObjv;
+    Tcl_Obj *resultObj, *bboxObj;
+    Tcl_Size textObjc, i;
+    PathRect r;
+    char *utf8;
+    int index, value;
+
+    if ((objc < 2) || (objc % 2 != 0)) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?-option value ...? textList");
+	return TCL_ERROR;
+    }
+    textStyle.fontFamily = DEF_PATHCANVTEXT_FONTFAMILY;
+    textStyle.fontSize = atof(DEF_PATHCANVTEXT_FONTSIZE);
+    textStyle.fontWeight = PATH_TEXT_WEIGHT_NORMAL;
+    textStyle.fontSlant = PATH_TEXT_SLANT_NORMAL;
+    for (i = 1; i < objc - 1; i += 2) {
+	if (Tcl_GetIndexFromObj(interp, objv[i], optionStrings, "option", 0,
+		&index) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	switch (index) {
+	    case OPT_FONTFAMILY:
+		textStyle.fontFamily = Tcl_GetString(objv[i+1]);
+		break;
+	    case OPT_FONTSIZE:
+		if (Tcl_GetDoubleFromObj(interp, objv[i+1],
+			&textStyle.fontSize) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		break;
+	    case OPT_FONTSLANT:
+		if (Tcl_GetIndexFromObj(interp, objv[i+1], fontSlantST,
+			"font slant", 0, &value) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		textStyle.fontSlant = value;
+		break;
+	    case OPT_FONTWEIGHT:
+		if (Tcl_GetIndexFromObj(interp, objv[i+1], fontWeightST,
+			"font weight", 0, &value) != TCL_OK) {
+		    return TCL_ERROR;
+		}
+		textStyle.fontWeight = value;
+		break;
+	}
+    }
+    if (Tcl_ListObjGetElements(interp, objv[objc-1], &textObjc,
+	    &textObjv) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    resultObj = Tcl_NewListObj(0, NULL);
+    for (i = 0; i < textObjc; i++) {
+	utf8 = Tcl_GetString(textObjv[i]);
+	r = TkPathTextMeasureBbox(Tk_Display(tkwin), &textStyle, utf8, NULL);
+	bboxObj = Tcl_NewListObj(0, NULL);
+	Tcl_ListObjAppendElement(NULL, bboxObj, Tcl_NewDoubleObj(r.x1));
+	Tcl_ListObjAppendElement(NULL, bboxObj, Tcl_NewDoubleObj(r.y1));
+	Tcl_ListObjAppendElement(NULL, bboxObj, Tcl_NewDoubleObj(r.x2));
+	Tcl_ListObjAppendElement(NULL, bboxObj, Tcl_NewDoubleObj(r.y2));
+	Tcl_ListObjAppendElement(NULL, resultObj, bboxObj);
+    }
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
 #if 0	/* TODO */
 static void
 PtextDeleteChars(Tk_PathCanvas canvas, Tk_PathItem *itemPtr,
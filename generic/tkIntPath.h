@@ -91,15 +91,21 @@ extern "C" {
 #define HaveAnyFillFromPathColor(pcol) 		(((pcol != NULL) && ((pcol->color != NULL) || (pcol->gradientInstPtr != NULL))) ? 1 : 0 )
 
 /*
- * So far we use a fixed number of straight line segments when
- * doing various things, but it would be better to use the de Castlejau
- * algorithm to iterate these segments.
+ * Curves, arcs and ellipses are flattened into as many straight line
+ * segments as needed to stay within a tolerance, in pixels, of the true
+ * curve; see TkPathCurveNumSegments and friends. The tolerance is the
+ * canvas -tolerance option. Fixed numbers of segments are only used
+ * where no tolerance is known, such as when exporting to pdf.
  */
 #define kPathNumSegmentsCurveTo     	18
 #define kPathNumSegmentsQuadBezier 	12
 #define kPathNumSegmentsMax		18
 #define kPathNumSegmentsEllipse         48
 
+#define kPathDefaultTolerance		0.1
+#define kPathMinTolerance		0.001
+#define kPathMaxNumSegmentsAdaptive	1000
+
 #define kPathUnitTMatrix  {1.0, 0.0, 0.0, 1.0, 0.0, 0.0}
 
 /*
@@ -268,6 +274,59 @@ typedef struct RectAtom {
     double height;
 } RectAtom;
 
+/*
+ * Compact storage of a path: one verb (a PathAtomType) per path element,
+ * and all points packed as x,y pairs in the order of the atom fields:
+ *
+ *	M, L, A, Z	the end point (for Z the start of the subpath)
+ *	Q		control, anchor
+ *	C		control 1, control 2, anchor
+ *	ELLIPSE		center, center + (rx, ry)
+ *	RECT		x, y and x + width, y + height
+ *
+ * The remaining parameters of each arc, radX, radY, angle and flags,
+ * follow the numPoints points. Since the points are uniform pairs
+ * translating and scaling are plain loops over the coords array.
+ * The verbs and coords are the only two allocations made for a path.
+ *
+ * If sharedPtr is set the verbs and coords belong to a parsed path that
+ * other items use as well, and TkPathDataUnshare must be called before
+ * changing them.
+ */
+
+typedef struct TkPathData {
+    int numVerbs;		/* Number of path elements in verbs. */
+    int numPoints;		/* Number of x,y pairs at start of coords. */
+    int numArcs;		/* Number of arc parameter sets after the
+				 * points. */
+    unsigned char *verbs;	/* One PathAtomType per path element. */
+    double *coords;		/* Points followed by arc parameters. */
+    struct TkPathSharedData *sharedPtr;
+				/* Owner of verbs and coords if shared,
+				 * else NULL. */
+} TkPathData;
+
+/*
+ * A parsed path kept as the internal rep of a "tkpath" Tcl_Obj, and
+ * shared by every item made from that Tcl_Obj or from an equal string
+ * found in the canvas intern table. It is never changed once made.
+ */
+
+typedef struct TkPathSharedData {
+    Tcl_Size refCount;		/* Number of Tcl_Obj's and TkPathData's
+				 * using this. */
+    Tcl_Size len;		/* Path length from TkPathParseToAtoms. */
+    Tcl_HashEntry *hPtr;	/* Entry in an intern table, or NULL. */
+    TkPathData data;		/* Owns the verbs and coords. */
+} TkPathSharedData;
+
+/* Bits in the flags parameter of an arc in TkPathData. */
+
+enum {
+    kPathDataArcLarge =		(1L << 0),
+    kPathDataArcSweep =		(1L << 1)
+};
+
 /*
  * Flags for 'TkPathStyleMergeStyles'.
  */
@@ -284,6 +343,17 @@ enum {
 MODULE_SCOPE TkPathContext TkPathInit(Tk_Window tkwin, Drawable d);
 MODULE_SCOPE TkPathContext TkPathInitSurface(Display *display,
 			int width, int height);
+MODULE_SCOPE TkPathContext TkPathInitImage(Tk_Window tkwin, Drawable d,
+			PathRect *rectPtr);
+MODULE_SCOPE void   TkPathFlushImage(TkPathContext ctx, PathRect *rectPtr);
+MODULE_SCOPE int    TkPathReloadImage(TkPathContext ctx, PathRect *rectPtr);
+MODULE_SCOPE int    TkPathCanDrawSurface(void);
+MODULE_SCOPE void   TkPathDrawSurface(TkPathContext ctx,
+			TkPathContext surface, double x, double y);
+MODULE_SCOPE int    TkPathKeepPath(TkPathContext ctx, int keep);
+MODULE_SCOPE void * TkPathCopyPath(TkPathContext ctx);
+MODULE_SCOPE void   TkPathAppendPath(TkPathContext ctx, void *pathPtr);
+MODULE_SCOPE void   TkPathFreeCopiedPath(void *pathPtr);
 MODULE_SCOPE void   TkPathBeginPath(TkPathContext ctx, Tk_PathStyle *stylePtr);
 MODULE_SCOPE void   TkPathEndPath(TkPathContext ctx);
 MODULE_SCOPE void   TkPathMoveTo(TkPathContext ctx, double x, double y);
@@ -310,7 +380,9 @@ MODULE_SCOPE void   TkPathImage(TkPathContext ctx, Tk_Image image,
 			double x, double y, double width, double height,
 			double fillOpacity,
 			XColor *tintColor, double tintAmount,
-			int interpolation, PathRect *srcRegion);
+			int interpolation, PathRect *srcRegion,
+			void **customPtr);
+MODULE_SCOPE void   TkPathImageFree(void *custom);
 MODULE_SCOPE int    TkPathTextConfig(Tcl_Interp *interp,
 			Tk_PathTextStyle *textStylePtr, char *utf8,
 			void **customPtr);
@@ -331,7 +403,7 @@ MODULE_SCOPE void   TkPathSurfaceToPhoto(Tcl_Interp *interp,
  * General path drawing using linked list of path atoms.
  */
 
-MODULE_SCOPE void   TkPathDrawPath(Tk_Window tkwin, Drawable drawable,
+MODULE_SCOPE void   TkPathDrawPath(Tk_PathCanvas canvas, Drawable drawable,
 			PathAtom *atomPtr, Tk_PathStyle *stylePtr,
 			TMatrix *mPtr, PathRect *bboxPtr);
 MODULE_SCOPE void   TkPathPaintPath(TkPathContext context, PathAtom *atomPtr,
@@ -340,6 +412,33 @@ MODULE_SCOPE PathRect TkPathGetTotalBbox(PathAtom *atomPtr,
 			Tk_PathStyle *stylePtr);
 MODULE_SCOPE void   TkPathMakePrectAtoms(double *pointsPtr,
 			double rx, double ry, PathAtom **atomPtrPtr);
+
+/*
+ * Compact path storage. The atoms returned from TkPathDataGetAtoms
+ * live in a single block and must be freed with TkPathDataFreeAtoms.
+ */
+
+MODULE_SCOPE void   TkPathDataInit(TkPathData *dataPtr);
+MODULE_SCOPE void   TkPathDataFree(TkPathData *dataPtr);
+MODULE_SCOPE void   TkPathDataFromAtoms(TkPathData *dataPtr,
+			PathAtom *atomPtr);
+MODULE_SCOPE void   TkPathDataFromPoints(TkPathData *dataPtr,
+			double *pointsPtr, int numPoints, int closed);
+MODULE_SCOPE int    TkPathDataSetFromObj(Tcl_Interp *interp,
+			Tcl_HashTable *internTablePtr, Tcl_Obj *objPtr,
+			TkPathData *dataPtr, Tcl_Size *lenPtr);
+MODULE_SCOPE void   TkPathDataUnshare(TkPathData *dataPtr);
+MODULE_SCOPE void   TkPathInternTableFree(Tcl_HashTable *tablePtr);
+MODULE_SCOPE PathAtom *TkPathDataGetAtoms(TkPathData *dataPtr);
+MODULE_SCOPE void   TkPathDataFreeAtoms(PathAtom *atomPtr);
+MODULE_SCOPE int    TkPathDataMakePath(TkPathContext context,
+			TkPathData *dataPtr, Tk_PathStyle *stylePtr);
+MODULE_SCOPE int    TkPathDataGetEndPoints(TkPathData *dataPtr,
+			PathPoint **firstPtrPtr, PathPoint **lastPtrPtr);
+MODULE_SCOPE void   TkPathDrawPathData(Tk_PathCanvas canvas,
+			Drawable drawable, TkPathData *dataPtr,
+			Tk_PathStyle *stylePtr, TMatrix *mPtr,
+			PathRect *bboxPtr);
 MODULE_SCOPE TkPathColor *TkPathNewPathColor(Tcl_Interp *interp,
 			Tk_Window tkwin, Tcl_Obj *nameObj);
 MODULE_SCOPE void   TkPathFreePathColor(TkPathColor *colorPtr);
@@ -401,6 +500,9 @@ MODULE_SCOPE void   PathCopyBitsPremultipliedAlphaARGB(unsigned char *from,
 MODULE_SCOPE void   PathCopyBitsPremultipliedAlphaBGRA(unsigned char *from,
 			unsigned char *to,
 			int width, int height, int bytesPerRow);
+MODULE_SCOPE void   PathCopyBitsToPremultipliedAlphaBGRA(unsigned char *from,
+			unsigned char *to,
+			int width, int height, int bytesPerRow);
 MODULE_SCOPE int    ObjectIsEmpty(Tcl_Obj *objPtr);
 MODULE_SCOPE int    PathGetTMatrix(Tcl_Interp* interp, const char *list,
 			TMatrix *matrixPtr);
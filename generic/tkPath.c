@@ -17,6 +17,26 @@ MODULE_SCOPE int gDepixelize;
 
 static const char kPathSyntaxError[] = "syntax error in path definition";
 
+static void	DupPathInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *copyPtr);
+static void	FreePathInternalRep(Tcl_Obj *objPtr);
+static void	ReleaseSharedData(TkPathSharedData *sharedPtr);
+
+/*
+ * The "tkpath" Tcl_Obj type. The internal rep is a TkPathSharedData in
+ * twoPtrValue.ptr1 so that all items made from the same Tcl_Obj share
+ * one parsed path. The string rep is never invalidated which is why
+ * there is no updateStringProc.
+ */
+
+static const Tcl_ObjType pathObjType = {
+    "tkpath",			/* name */
+    FreePathInternalRep,	/* freeIntRepProc */
+    DupPathInternalRep,		/* dupIntRepProc */
+    NULL,			/* updateStringProc */
+    NULL,			/* setFromAnyProc */
+    TCL_OBJTYPE_V0
+};
+
 /*
  * A placeholder for the context we are working in.
  * The current and lastMove are always original untransformed coordinates.
@@ -1030,6 +1050,708 @@ TkPathMakePath(
     return TCL_OK;
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * PathDataNumPoints, PathAtomSize --
+ *
+ *		Number of points stored in TkPathData for a verb, and
+ *		size of the corresponding atom record.
+ *
+ * Results:
+ *		See above.
+ *
+ * Side effects:
+ *		None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+PathDataNumPoints(int verb)
+{
+    switch (verb) {
+        case PATH_ATOM_Q:
+        case PATH_ATOM_ELLIPSE:
+        case PATH_ATOM_RECT:
+            return 2;
+        case PATH_ATOM_C:
+            return 3;
+        default:
+            return 1;
+    }
+}
+
+static size_t
+PathAtomSize(int verb)
+{
+    switch (verb) {
+        case PATH_ATOM_M:	    return sizeof(MoveToAtom);
+        case PATH_ATOM_L:	    return sizeof(LineToAtom);
+        case PATH_ATOM_A:	    return sizeof(ArcAtom);
+        case PATH_ATOM_Q:	    return sizeof(QuadBezierAtom);
+        case PATH_ATOM_C:	    return sizeof(CurveToAtom);
+        case PATH_ATOM_Z:	    return sizeof(CloseAtom);
+        case PATH_ATOM_ELLIPSE:	    return sizeof(EllipseAtom);
+        case PATH_ATOM_RECT:	    return sizeof(RectAtom);
+    }
+    return sizeof(PathAtom);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataInit, TkPathDataFree --
+ *
+ *		Sets up an empty TkPathData, and frees its verbs and
+ *		coords leaving it empty.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		Memory may be freed.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathDataInit(TkPathData *dataPtr)
+{
+    memset(dataPtr, 0, sizeof(TkPathData));
+}
+
+void
+TkPathDataFree(TkPathData *dataPtr)
+{
+    if (dataPtr->sharedPtr != NULL) {
+        ReleaseSharedData(dataPtr->sharedPtr);
+    } else {
+        if (dataPtr->verbs != NULL) {
+            ckfree((char *) dataPtr->verbs);
+        }
+        if (dataPtr->coords != NULL) {
+            ckfree((char *) dataPtr->coords);
+        }
+    }
+    memset(dataPtr, 0, sizeof(TkPathData));
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataSetFromObj
+ *
+ *		Makes dataPtr use the parsed path of objPtr. The path is
+ *		only parsed if objPtr isn't already of the "tkpath" type
+ *		and its string isn't found in internTablePtr.
+ *
+ * Results:
+ *		A standard Tcl result. The path length as given by
+ *		TkPathParseToAtoms is returned in lenPtr.
+ *
+ * Side effects:
+ *		On success, any old contents of dataPtr is freed and
+ *		objPtr converted to the "tkpath" type. A newly parsed
+ *		path is entered in internTablePtr if given.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+TkPathDataSetFromObj(
+    Tcl_Interp *interp,
+    Tcl_HashTable *internTablePtr,	/* String keyed table of shared
+					 * paths, or NULL. */
+    Tcl_Obj *objPtr,
+    TkPathData *dataPtr,
+    Tcl_Size *lenPtr)
+{
+    const Tcl_ObjInternalRep *irPtr;
+    TkPathSharedData *sharedPtr = NULL;
+
+    irPtr = Tcl_FetchInternalRep(objPtr, &pathObjType);
+    if (irPtr != NULL) {
+        sharedPtr = (TkPathSharedData *) irPtr->twoPtrValue.ptr1;
+    } else {
+        Tcl_ObjInternalRep ir;
+        Tcl_HashEntry *hPtr;
+        const char *string = Tcl_GetString(objPtr);
+
+        if (internTablePtr != NULL) {
+            hPtr = Tcl_FindHashEntry(internTablePtr, string);
+            if (hPtr != NULL) {
+                sharedPtr = (TkPathSharedData *) Tcl_GetHashValue(hPtr);
+            }
+        }
+        if (sharedPtr == NULL) {
+            PathAtom *atomPtr;
+            Tcl_Size len;
+            int isNew;
+
+            if (TkPathParseToAtoms(interp, objPtr, &atomPtr, &len) != TCL_OK) {
+                return TCL_ERROR;
+            }
+            sharedPtr = (TkPathSharedData *) ckalloc(sizeof(TkPathSharedData));
+            sharedPtr->refCount = 0;
+            sharedPtr->len = len;
+            sharedPtr->hPtr = NULL;
+            TkPathDataInit(&sharedPtr->data);
+            TkPathDataFromAtoms(&sharedPtr->data, atomPtr);
+            TkPathFreeAtoms(atomPtr);
+            if (internTablePtr != NULL) {
+                hPtr = Tcl_CreateHashEntry(internTablePtr,
+                        Tcl_GetString(objPtr), &isNew);
+                Tcl_SetHashValue(hPtr, sharedPtr);
+                sharedPtr->hPtr = hPtr;
+            }
+        }
+
+        /* The parsing above may have shimmered objPtr to a list. */
+        sharedPtr->refCount++;
+        ir.twoPtrValue.ptr1 = sharedPtr;
+        ir.twoPtrValue.ptr2 = NULL;
+        Tcl_StoreInternalRep(objPtr, &pathObjType, &ir);
+    }
+
+    sharedPtr->refCount++;
+    TkPathDataFree(dataPtr);
+    *dataPtr = sharedPtr->data;
+    dataPtr->sharedPtr = sharedPtr;
+    *lenPtr = sharedPtr->len;
+    return TCL_OK;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataUnshare
+ *
+ *		Gives dataPtr its own copy of a shared path so that it
+ *		may be changed.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		Memory allocated and the shared path released.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathDataUnshare(TkPathData *dataPtr)
+{
+    TkPathSharedData *sharedPtr = dataPtr->sharedPtr;
+    size_t numCoords;
+
+    if (sharedPtr == NULL) {
+        return;
+    }
+    dataPtr->sharedPtr = NULL;
+    if (dataPtr->numVerbs > 0) {
+        numCoords = 2*dataPtr->numPoints + 4*dataPtr->numArcs;
+        dataPtr->verbs = (unsigned char *) ckalloc(dataPtr->numVerbs);
+        memcpy(dataPtr->verbs, sharedPtr->data.verbs, dataPtr->numVerbs);
+        dataPtr->coords = (double *) ckalloc(numCoords * sizeof(double));
+        memcpy(dataPtr->coords, sharedPtr->data.coords,
+                numCoords * sizeof(double));
+    } else {
+        dataPtr->verbs = NULL;
+        dataPtr->coords = NULL;
+    }
+    ReleaseSharedData(sharedPtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ReleaseSharedData
+ *
+ *		Drops a reference to a shared path and frees it when
+ *		the last one is gone.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		Memory may be freed and the intern table entry removed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+ReleaseSharedData(TkPathSharedData *sharedPtr)
+{
+    if (--sharedPtr->refCount > 0) {
+        return;
+    }
+    if (sharedPtr->hPtr != NULL) {
+        Tcl_DeleteHashEntry(sharedPtr->hPtr);
+    }
+    TkPathDataFree(&sharedPtr->data);
+    ckfree((char *) sharedPtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathInternTableFree
+ *
+ *		Deletes an intern table of shared paths. Paths still
+ *		kept alive by Tcl_Obj's are just unlinked from it.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		The hash table is deleted.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathInternTableFree(Tcl_HashTable *tablePtr)
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    TkPathSharedData *sharedPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(tablePtr, &search); hPtr != NULL;
+            hPtr = Tcl_NextHashEntry(&search)) {
+        sharedPtr = (TkPathSharedData *) Tcl_GetHashValue(hPtr);
+        sharedPtr->hPtr = NULL;
+    }
+    Tcl_DeleteHashTable(tablePtr);
+}
+
+static void
+FreePathInternalRep(Tcl_Obj *objPtr)
+{
+    ReleaseSharedData((TkPathSharedData *) objPtr->internalRep.twoPtrValue.ptr1);
+}
+
+static void
+DupPathInternalRep(Tcl_Obj *srcPtr, Tcl_Obj *copyPtr)
+{
+    TkPathSharedData *sharedPtr = (TkPathSharedData *)
+            srcPtr->internalRep.twoPtrValue.ptr1;
+
+    sharedPtr->refCount++;
+    copyPtr->internalRep.twoPtrValue.ptr1 = sharedPtr;
+    copyPtr->internalRep.twoPtrValue.ptr2 = NULL;
+    copyPtr->typePtr = &pathObjType;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataFromAtoms
+ *
+ *		Packs a linked list of path atoms into compact storage.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		Any old contents of dataPtr is freed and the verbs and
+ *		coords arrays allocated.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathDataFromAtoms(TkPathData *dataPtr, PathAtom *atomPtr)
+{
+    PathAtom *aPtr;
+    unsigned char *verbPtr;
+    double *pt, *arc;
+    int numVerbs = 0, numPoints = 0, numArcs = 0;
+
+    TkPathDataFree(dataPtr);
+    for (aPtr = atomPtr; aPtr != NULL; aPtr = aPtr->nextPtr) {
+        numVerbs++;
+        numPoints += PathDataNumPoints(aPtr->type);
+        if (aPtr->type == PATH_ATOM_A) {
+            numArcs++;
+        }
+    }
+    if (numVerbs == 0) {
+        return;
+    }
+    dataPtr->verbs = (unsigned char *) ckalloc(numVerbs);
+    dataPtr->coords = (double *)
+            ckalloc((2*numPoints + 4*numArcs) * sizeof(double));
+    dataPtr->numVerbs = numVerbs;
+    dataPtr->numPoints = numPoints;
+    dataPtr->numArcs = numArcs;
+
+    verbPtr = dataPtr->verbs;
+    pt = dataPtr->coords;
+    arc = pt + 2*numPoints;
+    for (aPtr = atomPtr; aPtr != NULL; aPtr = aPtr->nextPtr) {
+        *verbPtr++ = (unsigned char) aPtr->type;
+
+        switch (aPtr->type) {
+            case PATH_ATOM_M: {
+                MoveToAtom *move = (MoveToAtom *) aPtr;
+                *pt++ = move->x;
+                *pt++ = move->y;
+                break;
+            }
+            case PATH_ATOM_L: {
+                LineToAtom *line = (LineToAtom *) aPtr;
+                *pt++ = line->x;
+                *pt++ = line->y;
+                break;
+            }
+            case PATH_ATOM_A: {
+                ArcAtom *arcAtom = (ArcAtom *) aPtr;
+                *arc++ = arcAtom->radX;
+                *arc++ = arcAtom->radY;
+                *arc++ = arcAtom->angle;
+                *arc++ = (arcAtom->largeArcFlag ? kPathDataArcLarge : 0) |
+                        (arcAtom->sweepFlag ? kPathDataArcSweep : 0);
+                *pt++ = arcAtom->x;
+                *pt++ = arcAtom->y;
+                break;
+            }
+            case PATH_ATOM_Q: {
+                QuadBezierAtom *quad = (QuadBezierAtom *) aPtr;
+                *pt++ = quad->ctrlX;
+                *pt++ = quad->ctrlY;
+                *pt++ = quad->anchorX;
+                *pt++ = quad->anchorY;
+                break;
+            }
+            case PATH_ATOM_C: {
+                CurveToAtom *curve = (CurveToAtom *) aPtr;
+                *pt++ = curve->ctrlX1;
+                *pt++ = curve->ctrlY1;
+                *pt++ = curve->ctrlX2;
+                *pt++ = curve->ctrlY2;
+                *pt++ = curve->anchorX;
+                *pt++ = curve->anchorY;
+                break;
+            }
+            case PATH_ATOM_Z: {
+                CloseAtom *closeAtom = (CloseAtom *) aPtr;
+                *pt++ = closeAtom->x;
+                *pt++ = closeAtom->y;
+                break;
+            }
+            case PATH_ATOM_ELLIPSE: {
+                EllipseAtom *ell = (EllipseAtom *) aPtr;
+                *pt++ = ell->cx;
+                *pt++ = ell->cy;
+                *pt++ = ell->cx + ell->rx;
+                *pt++ = ell->cy + ell->ry;
+                break;
+            }
+            case PATH_ATOM_RECT: {
+                RectAtom *rect = (RectAtom *) aPtr;
+                *pt++ = rect->x;
+                *pt++ = rect->y;
+                *pt++ = rect->x + rect->width;
+                *pt++ = rect->y + rect->height;
+                break;
+            }
+        }
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataFromPoints
+ *
+ *		Makes a polyline, or a polygon if closed, from an array
+ *		of x,y pairs without going through atoms.
+ *
+ * Results:
+ *		None.
+ *
+ * Side effects:
+ *		Any old contents of dataPtr is freed and the verbs and
+ *		coords arrays allocated.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathDataFromPoints(TkPathData *dataPtr, double *pointsPtr, int numPoints,
+        int closed)
+{
+    int numVerbs = numPoints + (closed ? 1 : 0);
+
+    TkPathDataFree(dataPtr);
+    if (numPoints <= 0) {
+        return;
+    }
+    dataPtr->verbs = (unsigned char *) ckalloc(numVerbs);
+    dataPtr->coords = (double *) ckalloc(2*numVerbs * sizeof(double));
+    dataPtr->numVerbs = numVerbs;
+    dataPtr->numPoints = numVerbs;
+    dataPtr->numArcs = 0;
+
+    dataPtr->verbs[0] = PATH_ATOM_M;
+    memset(dataPtr->verbs + 1, PATH_ATOM_L, numPoints - 1);
+    memcpy(dataPtr->coords, pointsPtr, 2*numPoints * sizeof(double));
+    if (closed) {
+        dataPtr->verbs[numPoints] = PATH_ATOM_Z;
+        dataPtr->coords[2*numPoints] = pointsPtr[0];
+        dataPtr->coords[2*numPoints+1] = pointsPtr[1];
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataGetAtoms
+ *
+ *		Makes a linked list of path atoms from compact storage,
+ *		for code that still walks atoms. All atoms are placed
+ *		in one block of memory.
+ *
+ * Results:
+ *		The first atom or NULL if the path is empty.
+ *
+ * Side effects:
+ *		Memory allocated that must be freed with
+ *		TkPathDataFreeAtoms and not TkPathFreeAtoms.
+ *
+ *--------------------------------------------------------------
+ */
+
+PathAtom *
+TkPathDataGetAtoms(TkPathData *dataPtr)
+{
+    PathAtom *atomPtr, *prevPtr = NULL;
+    double *pt, *arc;
+    char *block, *p;
+    size_t size = 0;
+    int i;
+
+    if (dataPtr->numVerbs == 0) {
+        return NULL;
+    }
+    for (i = 0; i < dataPtr->numVerbs; i++) {
+        size += PathAtomSize(dataPtr->verbs[i]);
+    }
+    block = p = ckalloc(size);
+    pt = dataPtr->coords;
+    arc = pt + 2*dataPtr->numPoints;
+
+    for (i = 0; i < dataPtr->numVerbs; i++) {
+        atomPtr = (PathAtom *) p;
+        atomPtr->type = (PathAtomType) dataPtr->verbs[i];
+        atomPtr->nextPtr = NULL;
+        p += PathAtomSize(atomPtr->type);
+        if (prevPtr != NULL) {
+            prevPtr->nextPtr = atomPtr;
+        }
+        prevPtr = atomPtr;
+
+        switch (atomPtr->type) {
+            case PATH_ATOM_M: {
+                MoveToAtom *move = (MoveToAtom *) atomPtr;
+                move->x = pt[0];
+                move->y = pt[1];
+                break;
+            }
+            case PATH_ATOM_L: {
+                LineToAtom *line = (LineToAtom *) atomPtr;
+                line->x = pt[0];
+                line->y = pt[1];
+                break;
+            }
+            case PATH_ATOM_A: {
+                ArcAtom *arcAtom = (ArcAtom *) atomPtr;
+                int flags = (int) arc[3];
+                arcAtom->radX = arc[0];
+                arcAtom->radY = arc[1];
+                arcAtom->angle = arc[2];
+                arcAtom->largeArcFlag = (flags & kPathDataArcLarge) ? 1 : 0;
+                arcAtom->sweepFlag = (flags & kPathDataArcSweep) ? 1 : 0;
+                arcAtom->x = pt[0];
+                arcAtom->y = pt[1];
+                arc += 4;
+                break;
+            }
+            case PATH_ATOM_Q: {
+                QuadBezierAtom *quad = (QuadBezierAtom *) atomPtr;
+                quad->ctrlX = pt[0];
+                quad->ctrlY = pt[1];
+                quad->anchorX = pt[2];
+                quad->anchorY = pt[3];
+                break;
+            }
+            case PATH_ATOM_C: {
+                CurveToAtom *curve = (CurveToAtom *) atomPtr;
+                curve->ctrlX1 = pt[0];
+                curve->ctrlY1 = pt[1];
+                curve->ctrlX2 = pt[2];
+                curve->ctrlY2 = pt[3];
+                curve->anchorX = pt[4];
+                curve->anchorY = pt[5];
+                break;
+            }
+            case PATH_ATOM_Z: {
+                CloseAtom *closeAtom = (CloseAtom *) atomPtr;
+                closeAtom->x = pt[0];
+                closeAtom->y = pt[1];
+                break;
+            }
+            case PATH_ATOM_ELLIPSE: {
+                EllipseAtom *ell = (EllipseAtom *) atomPtr;
+                ell->cx = pt[0];
+                ell->cy = pt[1];
+                ell->rx = fabs(pt[2] - pt[0]);
+                ell->ry = fabs(pt[3] - pt[1]);
+                break;
+            }
+            case PATH_ATOM_RECT: {
+                RectAtom *rect = (RectAtom *) atomPtr;
+                rect->x = MIN(pt[0], pt[2]);
+                rect->y = MIN(pt[1], pt[3]);
+                rect->width = fabs(pt[2] - pt[0]);
+                rect->height = fabs(pt[3] - pt[1]);
+                break;
+            }
+        }
+        pt += 2*PathDataNumPoints(atomPtr->type);
+    }
+    return (PathAtom *) block;
+}
+
+void
+TkPathDataFreeAtoms(PathAtom *atomPtr)
+{
+    if (atomPtr != NULL) {
+        ckfree((char *) atomPtr);
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataMakePath
+ *
+ *		Defines the path using compact storage. Same as
+ *		TkPathMakePath but without any atoms.
+ *
+ * Results:
+ *		A standard Tcl result.
+ *
+ * Side effects:
+ *		Defines the current path in drawable.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+TkPathDataMakePath(
+    TkPathContext context,
+    TkPathData *dataPtr,
+    Tk_PathStyle *stylePtr)
+{
+    double *pt = dataPtr->coords;
+    double *arc = pt + 2*dataPtr->numPoints;
+    int i;
+
+    TkPathBeginPath(context, stylePtr);
+
+    for (i = 0; i < dataPtr->numVerbs; i++) {
+        switch (dataPtr->verbs[i]) {
+            case PATH_ATOM_M:
+                TkPathMoveTo(context, pt[0], pt[1]);
+                pt += 2;
+                break;
+            case PATH_ATOM_L:
+                TkPathLineTo(context, pt[0], pt[1]);
+                pt += 2;
+                break;
+            case PATH_ATOM_A: {
+                int flags = (int) arc[3];
+                TkPathArcTo(context, arc[0], arc[1], arc[2],
+                        (flags & kPathDataArcLarge) ? 1 : 0,
+                        (flags & kPathDataArcSweep) ? 1 : 0,
+                        pt[0], pt[1]);
+                arc += 4;
+                pt += 2;
+                break;
+            }
+            case PATH_ATOM_Q:
+                TkPathQuadBezier(context, pt[0], pt[1], pt[2], pt[3]);
+                pt += 4;
+                break;
+            case PATH_ATOM_C:
+                TkPathCurveTo(context, pt[0], pt[1], pt[2], pt[3],
+                        pt[4], pt[5]);
+                pt += 6;
+                break;
+            case PATH_ATOM_Z:
+                TkPathClosePath(context);
+                pt += 2;
+                break;
+            case PATH_ATOM_ELLIPSE:
+                TkPathOval(context, pt[0], pt[1],
+                        fabs(pt[2] - pt[0]), fabs(pt[3] - pt[1]));
+                pt += 4;
+                break;
+            case PATH_ATOM_RECT:
+                TkPathRect(context, MIN(pt[0], pt[2]), MIN(pt[1], pt[3]),
+                        fabs(pt[2] - pt[0]), fabs(pt[3] - pt[1]));
+                pt += 4;
+                break;
+        }
+    }
+    TkPathEndPath(context);
+    return TCL_OK;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDataGetEndPoints
+ *
+ *		Finds the first and last points of the path, which are
+ *		the ones adjusted for arrowheads.
+ *
+ * Results:
+ *		TCL_OK if the path starts with a move to, else TCL_ERROR.
+ *		Pointers into the coords array are returned in
+ *		firstPtrPtr and lastPtrPtr.
+ *
+ * Side effects:
+ *		None.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+TkPathDataGetEndPoints(TkPathData *dataPtr, PathPoint **firstPtrPtr,
+        PathPoint **lastPtrPtr)
+{
+    double *pt = dataPtr->coords;
+    int i, n;
+
+    *firstPtrPtr = *lastPtrPtr = NULL;
+    if ((dataPtr->numVerbs == 0) || (dataPtr->verbs[0] != PATH_ATOM_M)) {
+        return TCL_ERROR;
+    }
+    *firstPtrPtr = (PathPoint *) pt;
+    for (i = 0; i < dataPtr->numVerbs; i++) {
+        n = PathDataNumPoints(dataPtr->verbs[i]);
+        if ((dataPtr->verbs[i] != PATH_ATOM_ELLIPSE)
+                && (dataPtr->verbs[i] != PATH_ATOM_RECT)) {
+            *lastPtrPtr = (PathPoint *) (pt + 2*(n-1));
+        }
+        pt += 2*n;
+    }
+    return TCL_OK;
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -101,6 +101,8 @@ typedef struct LinearGradientFill {
     int fillRule;		/* Not yet used. */
     int units;
     GradientStopArray *stopArrPtr;
+    void *cachePtr;		/* Compiled gradient of the platform or NULL.
+				 * Freed by TkPathGradientChanged. */
 } LinearGradientFill;
 
 typedef struct RadialTransition {
@@ -117,6 +119,8 @@ typedef struct RadialGradientFill {
     int fillRule;		/* Not yet used. */
     int units;
     GradientStopArray *stopArrPtr;
+    void *cachePtr;		/* Compiled gradient of the platform or NULL.
+				 * Freed by TkPathGradientChanged. */
 } RadialGradientFill;
 
 enum {
@@ -303,6 +307,8 @@ MODULE_SCOPE int    TkPathMakePath(Drawable drawable, PathAtom *atomPtr,
 
 MODULE_SCOPE void   TkPathClipToPath(TkPathContext ctx, int fillRule);
 MODULE_SCOPE void   TkPathReleaseClipToPath(TkPathContext ctx);
+MODULE_SCOPE void   TkPathClipToRect(TkPathContext ctx, PathRect *rectPtr);
+MODULE_SCOPE void   TkPathSetTolerance(TkPathContext ctx, double tolerance);
 MODULE_SCOPE void   TkPathStroke(TkPathContext ctx, Tk_PathStyle *style);
 MODULE_SCOPE void   TkPathFill(TkPathContext ctx, Tk_PathStyle *style);
 MODULE_SCOPE void   TkPathFillAndStroke(TkPathContext ctx, Tk_PathStyle *style);
@@ -315,6 +321,7 @@ MODULE_SCOPE void   TkPathPaintLinearGradient(TkPathContext ctx,
 MODULE_SCOPE void   TkPathPaintRadialGradient(TkPathContext ctx,
 			PathRect *bbox, RadialGradientFill *fillPtr,
 			int fillRule, double fillOpacity, TMatrix *mPtr);
+MODULE_SCOPE void   TkPathFreeGradientCache(void *cachePtr);
 MODULE_SCOPE void   TkPathFree(TkPathContext ctx);
 MODULE_SCOPE int    TkPathDrawingDestroysPath(void);
 MODULE_SCOPE int    TkPathPixelAlign(void);
@@ -883,9 +883,31 @@ GradientInterpDeleted(ClientData clientData)
     ckfree((char *) dataPtr);
 }
 
+/*
+ * The platform code may keep the gradient compiled in the fill record
+ * between paints. It must be thrown away whenever the gradient changes.
+ */
+
+static void
+GradientFreeCache(TkPathGradientMaster *gradientPtr)
+{
+    void **cachePtrPtr;
+
+    if (gradientPtr->type == kPathGradientTypeLinear) {
+	cachePtrPtr = &gradientPtr->linearFill.cachePtr;
+    } else {
+	cachePtrPtr = &gradientPtr->radialFill.cachePtr;
+    }
+    if (*cachePtrPtr != NULL) {
+	TkPathFreeGradientCache(*cachePtrPtr);
+	*cachePtrPtr = NULL;
+    }
+}
+
 void
 PathGradientMasterFree(TkPathGradientMaster *gradientPtr)
 {
+    GradientFreeCache(gradientPtr);
     Tk_FreeConfigOptions((char *) gradientPtr, gradientPtr->optionTable, NULL);
     ckfree((char *) gradientPtr);
 }
@@ -1032,8 +1054,9 @@ TkPathFreeGradient(
  *	None.
  *
  * Side effects:
- *	Any items that display the gradient are notified so that they can
- *	redisplay themselves as appropriate.
+ *	The compiled gradient of the platform is freed. Any items that
+ *	display the gradient are notified so that they can redisplay
+ *	themselves as appropriate.
  *
  *----------------------------------------------------------------------
  */
@@ -1043,6 +1066,7 @@ TkPathGradientChanged(TkPathGradientMaster *masterPtr, int flags)
 {
     TkPathGradientInst *walkPtr, *nextPtr;
 
+    GradientFreeCache(masterPtr);
     if (flags) {
 	/*
 	 * NB: We may implicitly call TkPathFreeGradient if being deleted!
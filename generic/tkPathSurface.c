@@ -843,7 +843,7 @@ SurfaceCreatePimage(Tcl_Interp *interp, InterpData *dataPtr,
 	TkPathPushTMatrix(context, style.matrixPtr);
 	TkPathImage(context, image, photo, point[0], point[1],
 		    item.width, item.height, style.fillOpacity,
-		    NULL, 0.0, 99, NULL);
+		    NULL, 0.0, 99, NULL, NULL);
 	Tk_FreeImage(image);
 	TkPathRestoreState(context);
     }
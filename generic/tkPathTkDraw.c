@@ -32,6 +32,14 @@ typedef struct _PathSegments {
     struct _PathSegments *next;
 } _PathSegments;
 
+/*
+ * Saved transformation matrices, see TkPathSaveState.
+ */
+typedef struct _PathSavedState {
+    TMatrix 		*m;
+    struct _PathSavedState *next;
+} _PathSavedState;
+
 /*
  * A placeholder for the context we are working in.
  * The current and lastMove are always original untransformed coordinates.
@@ -43,8 +51,10 @@ typedef struct TkPathContext_ {
     double 			lastMove[2];
     int				hasCurrent;
     TMatrix 		*m;
+    double		tolerance;	/* Flattening tolerance in pixels. */
     _PathSegments 	*segm;
     _PathSegments 	*currentSegm;
+    _PathSavedState *saved;
 } TkPathContext_;
 
 
@@ -62,8 +72,10 @@ _NewPathContext(Tk_Window tkwin, Drawable drawable)
     ctx->lastMove[1] = 0.0;
     ctx->hasCurrent = 0;
     ctx->m = NULL;
+    ctx->tolerance = kPathDefaultTolerance;
     ctx->segm = NULL;
     ctx->currentSegm = NULL;
+    ctx->saved = NULL;
     return ctx;
 }
 
@@ -82,7 +94,7 @@ _NewPathSegments(void)
 }
 
 static void
-_PathContextFree(TkPathContext_ *ctx)
+_PathSegmentsFree(TkPathContext_ *ctx)
 {
     _PathSegments *tmpSegm, *segm;
 
@@ -93,6 +105,18 @@ _PathContextFree(TkPathContext_ *ctx)
         ckfree((char *) tmpSegm->points);
         ckfree((char *) tmpSegm);
     }
+    ctx->segm = NULL;
+    ctx->currentSegm = NULL;
+    ctx->hasCurrent = 0;
+}
+
+static void
+_PathContextFree(TkPathContext_ *ctx)
+{
+    _PathSegmentsFree(ctx);
+    while (ctx->saved != NULL) {
+        TkPathRestoreState((TkPathContext) ctx);
+    }
     if (ctx->m != NULL) {
         ckfree((char *) ctx->m);
     }
@@ -104,8 +128,11 @@ _CheckCoordSpace(_PathSegments *segm, int numPoints)
 {
     if (segm->npoints + numPoints >= segm->size) {
         double *points;
-        points = (double *) ckrealloc((char *)segm->points, 2*(segm->size + _PATH_N_BUFFER_POINTS)*sizeof(double));
+        int size = segm->npoints + numPoints + _PATH_N_BUFFER_POINTS;
+
+        points = (double *) ckrealloc((char *)segm->points, 2*size*sizeof(double));
         segm->points = points;
+        segm->size = size;
     }
 }
 
@@ -121,6 +148,68 @@ TkPathInitSurface(Display *display, int width, int height)
     return NULL;
 }
 
+TkPathContext
+TkPathInitImage(Tk_Window tkwin, Drawable d, PathRect *rectPtr)
+{
+    /* Not supported, the canvas then draws with TkPathInit. */
+    return 0;
+}
+
+void
+TkPathFlushImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    /* Empty. */
+}
+
+int
+TkPathReloadImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    return 1;
+}
+
+int
+TkPathCanDrawSurface(void)
+{
+    return 0;
+}
+
+void
+TkPathDrawSurface(TkPathContext ctx, TkPathContext surface, double x,
+    double y)
+{
+    /* Empty. */
+}
+
+int
+TkPathKeepPath(TkPathContext ctx, int keep)
+{
+    return 0;
+}
+
+void
+TkPathFreeGradientCache(void *cachePtr)
+{
+    /* Empty. */
+}
+
+void *
+TkPathCopyPath(TkPathContext ctx)
+{
+    return NULL;
+}
+
+void
+TkPathAppendPath(TkPathContext ctx, void *pathPtr)
+{
+    /* Empty. */
+}
+
+void
+TkPathFreeCopiedPath(void *pathPtr)
+{
+    /* Empty. */
+}
+
 void
 TkPathPushTMatrix(TkPathContext ctx, TMatrix *m)
 {
@@ -145,16 +234,44 @@ TkPathPushTMatrix(TkPathContext ctx, TMatrix *m)
     }
 }
 
+/*
+ * The only graphics state we keep is the transformation matrix.
+ * Since there is no separate path object, restoring also discards any
+ * segments so that a context can be reused for another path.
+ */
+
 void
 TkPathSaveState(TkPathContext ctx)
 {
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    _PathSavedState *statePtr;
 
+    statePtr = (_PathSavedState *) ckalloc(sizeof(_PathSavedState));
+    statePtr->m = NULL;
+    if (context->m != NULL) {
+        statePtr->m = (TMatrix *) ckalloc(sizeof(TMatrix));
+        *(statePtr->m) = *(context->m);
+    }
+    statePtr->next = context->saved;
+    context->saved = statePtr;
 }
 
 void
 TkPathRestoreState(TkPathContext ctx)
 {
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    _PathSavedState *statePtr = context->saved;
 
+    if (statePtr == NULL) {
+        return;
+    }
+    context->saved = statePtr->next;
+    if (context->m != NULL) {
+        ckfree((char *) context->m);
+    }
+    context->m = statePtr->m;
+    ckfree((char *) statePtr);
+    _PathSegmentsFree(context);
 }
 
 void
@@ -251,7 +368,7 @@ TkPathCurveTo(TkPathContext ctx, double x1, double y1,
     control[6] = x;
     control[7] = y;
 
-    numSteps = kPathNumSegmentsCurveTo;
+    numSteps = TkPathCurveNumSegments(control, context->tolerance);
     segm = context->currentSegm;
     _CheckCoordSpace(segm, numSteps);
     coordPtr = segm->points + 2*segm->npoints;
@@ -293,7 +410,8 @@ TkPathOval(TkPathContext ctx, double cx, double cy, double rx, double ry)
 void
 TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
         double x, double y, double width, double height, double fillOpacity,
-        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion)
+        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion,
+        void **customPtr)
 {
     /* FIXME use fillOpacity, tintColor, tintAmount parameters */
     TkPathContext_ *context = (TkPathContext_ *) ctx;
@@ -342,6 +460,12 @@ TkPathTextDraw(TkPathContext ctx, Tk_PathStyle *style, Tk_PathTextStyle *textSty
 
 }
 
+void
+TkPathImageFree(void *custom)
+{
+
+}
+
 void
 TkPathTextFree(Tk_PathTextStyle *textStylePtr, void *custom)
 {
@@ -380,6 +504,20 @@ TkPathReleaseClipToPath(TkPathContext ctx)
     /* empty */
 }
 
+void
+TkPathClipToRect(TkPathContext ctx, PathRect *rectPtr)
+{
+    /* empty */
+}
+
+void
+TkPathSetTolerance(TkPathContext ctx, double tolerance)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+    context->tolerance = tolerance;
+}
+
 /* @@@ This is a very much simplified version of TkPathCanvTranslatePath that
  * doesn't do any clipping and no translation since we do that with
  * the more general affine matrix transform.
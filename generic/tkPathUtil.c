@@ -9,10 +9,15 @@
 
 #include <float.h>
 #include "tkIntPath.h"
+#include "tkpCanvas.h"
 #include "tkCanvPathUtil.h"
 
 #define DOUBLE_EQUALS(x,y)      (fabs((x) - (y)) < DBL_EPSILON)
 
+static void	PaintPath(TkPathContext context, PathAtom *atomPtr,
+		    TkPathData *dataPtr, Tk_PathStyle *stylePtr,
+		    PathRect *bboxPtr);
+
 /*
  *--------------------------------------------------------------
  *
@@ -101,7 +106,7 @@ TkPathMakePrectAtoms(double *pointsPtr, double rx, double ry, PathAtom **atomPtr
 
 void
 TkPathDrawPath(
-    Tk_Window tkwin,        /* Tk window. */
+    Tk_PathCanvas canvas,   /* Canvas that contains item. */
     Drawable drawable,      /* Pixmap or window in which to draw
                              * item. */
     PathAtom *atomPtr,      /* The actual path as a linked list
@@ -117,20 +122,90 @@ TkPathDrawPath(
      * Define the path in the drawable using the path drawing functions.
      * Any transform matrix need to be considered and canvas drawable
      * offset must always be taken into account. Note the order!
+     * Paths with a plain style may be collected and painted later
+     * together with others.
      */
 
-    context = TkPathInit(tkwin, drawable);
+    context = TkPathCanvasBeginBatch(canvas, drawable, stylePtr, mPtr,
+	    bboxPtr);
+    if (context != 0) {
+        if (mPtr != NULL) {
+            TkPathPushTMatrix(context, mPtr);
+        }
+        if (stylePtr->matrixPtr != NULL) {
+            TkPathPushTMatrix(context, stylePtr->matrixPtr);
+        }
+        TkPathMakePath(context, atomPtr, stylePtr);
+        TkPathCanvasEndBatch(canvas, context);
+        return;
+    }
+    context = TkPathCanvasBeginDraw(canvas, drawable);
     if (mPtr != NULL) {
         TkPathPushTMatrix(context, mPtr);
     }
     if (stylePtr->matrixPtr != NULL) {
         TkPathPushTMatrix(context, stylePtr->matrixPtr);
     }
-    if (TkPathMakePath(context, atomPtr, stylePtr) != TCL_OK) {
+    if (TkPathMakePath(context, atomPtr, stylePtr) == TCL_OK) {
+        TkPathPaintPath(context, atomPtr, stylePtr, bboxPtr);
+    }
+    TkPathCanvasEndDraw(canvas, context);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TkPathDrawPathData --
+ *
+ *	Same as TkPathDrawPath but for a path in compact storage.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The path is drawn in drawable using the transformation
+ *	information in canvas.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+TkPathDrawPathData(
+    Tk_PathCanvas canvas,   /* Canvas that contains item. */
+    Drawable drawable,      /* Pixmap or window in which to draw
+                             * item. */
+    TkPathData *dataPtr,    /* The actual path. */
+    Tk_PathStyle *stylePtr, /* The paths style. */
+    TMatrix *mPtr,          /* Typically used for canvas offsets. */
+    PathRect *bboxPtr)      /* The bare (untransformed) bounding box
+                             * (assuming zero stroke width) */
+{
+    TkPathContext context;
+
+    context = TkPathCanvasBeginBatch(canvas, drawable, stylePtr, mPtr,
+	    bboxPtr);
+    if (context != 0) {
+        if (mPtr != NULL) {
+            TkPathPushTMatrix(context, mPtr);
+        }
+        if (stylePtr->matrixPtr != NULL) {
+            TkPathPushTMatrix(context, stylePtr->matrixPtr);
+        }
+        TkPathDataMakePath(context, dataPtr, stylePtr);
+        TkPathCanvasEndBatch(canvas, context);
         return;
     }
-    TkPathPaintPath(context, atomPtr, stylePtr,	bboxPtr);
-    TkPathFree(context);
+    context = TkPathCanvasBeginDraw(canvas, drawable);
+    if (mPtr != NULL) {
+        TkPathPushTMatrix(context, mPtr);
+    }
+    if (stylePtr->matrixPtr != NULL) {
+        TkPathPushTMatrix(context, stylePtr->matrixPtr);
+    }
+    if (TkPathDataMakePath(context, dataPtr, stylePtr) == TCL_OK) {
+        PaintPath(context, NULL, dataPtr, stylePtr, bboxPtr);
+    }
+    TkPathCanvasEndDraw(canvas, context);
 }
 
 /*
@@ -156,19 +231,47 @@ TkPathPaintPath(
                              * of PathAtoms. */
     Tk_PathStyle *stylePtr, /* The paths style. */
     PathRect *bboxPtr)
+{
+    PaintPath(context, atomPtr, NULL, stylePtr, bboxPtr);
+}
+
+static void
+PaintPath(
+    TkPathContext context,
+    PathAtom *atomPtr,      /* The path as atoms, or NULL if it is */
+    TkPathData *dataPtr,    /* in compact storage. */
+    Tk_PathStyle *stylePtr,
+    PathRect *bboxPtr)
 {
     TkPathGradientMaster *gradientPtr = GetGradientMasterFromPathColor(stylePtr->fill);
 
     if (gradientPtr != NULL) {
-        TkPathClipToPath(context, stylePtr->fillRule);
-        PathGradientPaint(context, bboxPtr, gradientPtr, stylePtr->fillRule, stylePtr->fillOpacity);
+        void *pathPtr = NULL;
 
         /* NB: Both CoreGraphics on MacOSX and Win32 GDI (and cairo from 1.0)
          *     clear the current path when setting clipping. Need therefore
-         *     to redo the path.
+         *     to redo the path, but only if it is to be stroked. A copy
+         *     of the path is cheaper than making it again when the
+         *     platform can make one.
          */
-        if (TkPathDrawingDestroysPath()) {
-            TkPathMakePath(context, atomPtr, stylePtr);
+        int redoPath = (stylePtr->strokeColor != NULL)
+                && TkPathDrawingDestroysPath();
+
+        if (redoPath) {
+            pathPtr = TkPathCopyPath(context);
+        }
+        TkPathClipToPath(context, stylePtr->fillRule);
+        PathGradientPaint(context, bboxPtr, gradientPtr, stylePtr->fillRule, stylePtr->fillOpacity);
+
+        if (pathPtr != NULL) {
+            TkPathAppendPath(context, pathPtr);
+            TkPathFreeCopiedPath(pathPtr);
+        } else if (redoPath) {
+            if (dataPtr != NULL) {
+                TkPathDataMakePath(context, dataPtr, stylePtr);
+            } else {
+                TkPathMakePath(context, atomPtr, stylePtr);
+            }
         }
 
         /* We shall remove the path clipping here! */
@@ -296,6 +399,742 @@ TkPathFreePathColor(TkPathColor *colorPtr)
     }
 }
 
+/*
+ * Row kernels for converting pixels between the photo format, RGBA, and the
+ * formats of the drawing backends. The scalar versions are the reference;
+ * the vector versions must give the same bytes and fall back to the scalar
+ * code for the tail of a row and for pixels they don't handle.
+ */
+
+typedef void (PathPixelRowProc)(const unsigned char *src, unsigned char *dst,
+		    int width);
+
+typedef struct PathPixelKernels {
+    PathPixelRowProc *swapRB;		/* BGRA to RGBA and vice versa. */
+    PathPixelRowProc *unpremultiplyRGBA;/* Premultiplied RGBA to RGBA. */
+    PathPixelRowProc *unpremultiplyBGRA;/* Premultiplied BGRA to RGBA. */
+    PathPixelRowProc *premultiplyBGRA;	/* RGBA to premultiplied BGRA. */
+} PathPixelKernels;
+
+static void
+SwapRBRowScalar(const unsigned char *src, unsigned char *dst, int width)
+{
+    int j;
+
+    for (j = 0; j < width; j++, src += 4) {
+        /* RED */
+        *dst++ = *(src+2);
+        /* GREEN */
+        *dst++ = *(src+1);
+        /* BLUE */
+        *dst++ = *src;
+        /* ALPHA */
+        *dst++ = *(src+3);
+    }
+}
+
+static void
+UnpremultiplyRGBARowScalar(const unsigned char *src, unsigned char *dst,
+        int width)
+{
+    unsigned char alpha;
+    int j;
+
+    for (j = 0; j < width; j++) {
+        alpha = *(src+3);
+        if (alpha == 0xFF || alpha == 0x00) {
+            memcpy(dst, src, 4);
+            src += 4;
+            dst += 4;
+        } else {
+            /* dst = 255*src/alpha */
+            *dst++ = (*src++*255)/alpha;
+            *dst++ = (*src++*255)/alpha;
+            *dst++ = (*src++*255)/alpha;
+            *dst++ = alpha;
+            src++;
+        }
+    }
+}
+
+static void
+UnpremultiplyBGRARowScalar(const unsigned char *src, unsigned char *dst,
+        int width)
+{
+    unsigned char alpha;
+    int j;
+
+    for (j = 0; j < width; j++, src += 4) {
+        alpha = *(src+3);
+        if (alpha == 0xFF || alpha == 0x00) {
+            /* RED */
+            *dst++ = *(src+2);
+            /* GREEN */
+            *dst++ = *(src+1);
+            /* BLUE */
+            *dst++ = *src;
+            /* ALPHA */
+            *dst++ = *(src+3);
+        } else {
+            /* dst = 255*src/alpha */
+            /* RED */
+            *dst++ = (*(src+2)*255)/alpha;
+            /* GREEN */
+            *dst++ = (*(src+1)*255)/alpha;
+            /* BLUE */
+            *dst++ = (*(src+0)*255)/alpha;
+            /* ALPHA */
+            *dst++ = alpha;
+        }
+    }
+}
+
+static void
+PremultiplyBGRARowScalar(const unsigned char *src, unsigned char *dst,
+        int width)
+{
+    unsigned int alpha;
+    int j;
+
+    for (j = 0; j < width; j++, src += 4, dst += 4) {
+        alpha = *(src+3);
+        *(dst+3) = alpha;
+        /* dst = alpha*src/255 */
+        *(dst+2) = alpha * *src / 255;
+        *(dst+1) = alpha * *(src+1) / 255;
+        *dst = alpha * *(src+2) / 255;
+    }
+}
+
+static const PathPixelKernels scalarKernels = {
+    SwapRBRowScalar, UnpremultiplyRGBARowScalar,
+    UnpremultiplyBGRARowScalar, PremultiplyBGRARowScalar
+};
+
+/*
+ * The vector versions. SSE2 is always there on x86-64, AVX2 is picked at
+ * runtime if the compiler lets us build it regardless of the target flags.
+ * NEON is always there on arm64.
+ *
+ * The premultiply uses that x/255 == (x + 1 + (x >> 8)) >> 8 for all
+ * 0 <= x <= 255*255, which keeps it in 16 bit lanes. The unpremultiply
+ * only vectorizes pixels which are all opaque or transparent and leaves
+ * the division to the scalar code.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#   define PATH_PIXEL_SSE2
+#   include <emmintrin.h>
+#endif
+#if defined(PATH_PIXEL_SSE2) && defined(__GNUC__) && \
+	(defined(__x86_64__) || defined(__i386__))
+#   define PATH_PIXEL_AVX2
+#   include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#   define PATH_PIXEL_NEON
+#   include <arm_neon.h>
+#endif
+
+#ifdef PATH_PIXEL_SSE2
+
+static __m128i
+SwapRBSSE2(__m128i v)
+{
+    const __m128i ga = _mm_set1_epi32((int) 0xFF00FF00);
+    __m128i rb = _mm_andnot_si128(ga, v);
+
+    rb = _mm_or_si128(_mm_srli_epi32(rb, 16), _mm_slli_epi32(rb, 16));
+    return _mm_or_si128(_mm_and_si128(v, ga), rb);
+}
+
+static int
+AllOpaqueOrClearSSE2(__m128i v)
+{
+    const __m128i amask = _mm_set1_epi32((int) 0xFF000000);
+    __m128i a = _mm_and_si128(v, amask);
+
+    a = _mm_or_si128(_mm_cmpeq_epi32(a, amask),
+	    _mm_cmpeq_epi32(a, _mm_setzero_si128()));
+    return (_mm_movemask_epi8(a) == 0xFFFF);
+}
+
+/* Premultiplies two RGBA pixels in 16 bit lanes and swaps R and B. */
+static __m128i
+PremultiplySSE2(__m128i p)
+{
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    __m128i a, x;
+
+    a = _mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    x = _mm_mullo_epi16(p, a);
+    x = _mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)),
+	    _mm_srli_epi16(x, 8));
+    x = _mm_srli_epi16(x, 8);
+    x = _mm_or_si128(_mm_andnot_si128(alphaLanes, x),
+	    _mm_and_si128(alphaLanes, p));
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 0, 1, 2));
+    return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+static void
+SwapRBRowSSE2(const unsigned char *src, unsigned char *dst, int width)
+{
+    int j;
+
+    for (j = 0; j + 4 <= width; j += 4, src += 16, dst += 16) {
+	_mm_storeu_si128((__m128i *) dst,
+		SwapRBSSE2(_mm_loadu_si128((const __m128i *) src)));
+    }
+    SwapRBRowScalar(src, dst, width - j);
+}
+
+static void
+UnpremultiplyRGBARowSSE2(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    __m128i v;
+    int j;
+
+    for (j = 0; j + 4 <= width; j += 4, src += 16, dst += 16) {
+	v = _mm_loadu_si128((const __m128i *) src);
+	if (AllOpaqueOrClearSSE2(v)) {
+	    _mm_storeu_si128((__m128i *) dst, v);
+	} else {
+	    UnpremultiplyRGBARowScalar(src, dst, 4);
+	}
+    }
+    UnpremultiplyRGBARowScalar(src, dst, width - j);
+}
+
+static void
+UnpremultiplyBGRARowSSE2(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    __m128i v;
+    int j;
+
+    for (j = 0; j + 4 <= width; j += 4, src += 16, dst += 16) {
+	v = _mm_loadu_si128((const __m128i *) src);
+	if (AllOpaqueOrClearSSE2(v)) {
+	    _mm_storeu_si128((__m128i *) dst, SwapRBSSE2(v));
+	} else {
+	    UnpremultiplyBGRARowScalar(src, dst, 4);
+	}
+    }
+    UnpremultiplyBGRARowScalar(src, dst, width - j);
+}
+
+static void
+PremultiplyBGRARowSSE2(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v, lo, hi;
+    int j;
+
+    for (j = 0; j + 4 <= width; j += 4, src += 16, dst += 16) {
+	v = _mm_loadu_si128((const __m128i *) src);
+	lo = PremultiplySSE2(_mm_unpacklo_epi8(v, zero));
+	hi = PremultiplySSE2(_mm_unpackhi_epi8(v, zero));
+	_mm_storeu_si128((__m128i *) dst, _mm_packus_epi16(lo, hi));
+    }
+    PremultiplyBGRARowScalar(src, dst, width - j);
+}
+
+static const PathPixelKernels sse2Kernels = {
+    SwapRBRowSSE2, UnpremultiplyRGBARowSSE2,
+    UnpremultiplyBGRARowSSE2, PremultiplyBGRARowSSE2
+};
+#endif /* PATH_PIXEL_SSE2 */
+
+#ifdef PATH_PIXEL_AVX2
+#define AVX2_FUNC __attribute__((target("avx2")))
+
+AVX2_FUNC static __m256i
+SwapRBAVX2(__m256i v)
+{
+    const __m256i order = _mm256_setr_epi8(
+	    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+	    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    return _mm256_shuffle_epi8(v, order);
+}
+
+AVX2_FUNC static int
+AllOpaqueOrClearAVX2(__m256i v)
+{
+    const __m256i amask = _mm256_set1_epi32((int) 0xFF000000);
+    __m256i a = _mm256_and_si256(v, amask);
+
+    a = _mm256_or_si256(_mm256_cmpeq_epi32(a, amask),
+	    _mm256_cmpeq_epi32(a, _mm256_setzero_si256()));
+    return (_mm256_movemask_epi8(a) == -1);
+}
+
+AVX2_FUNC static __m256i
+PremultiplyAVX2(__m256i p)
+{
+    const __m256i alphaLanes = _mm256_set1_epi64x(
+	    (long long) 0xFFFF000000000000ULL);
+    __m256i a, x;
+
+    a = _mm256_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    x = _mm256_mullo_epi16(p, a);
+    x = _mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)),
+	    _mm256_srli_epi16(x, 8));
+    x = _mm256_srli_epi16(x, 8);
+    x = _mm256_blendv_epi8(x, p, alphaLanes);
+    x = _mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 0, 1, 2));
+    return _mm256_shufflehi_epi16(x, _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+AVX2_FUNC static void
+SwapRBRowAVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+    int j;
+
+    for (j = 0; j + 8 <= width; j += 8, src += 32, dst += 32) {
+	_mm256_storeu_si256((__m256i *) dst,
+		SwapRBAVX2(_mm256_loadu_si256((const __m256i *) src)));
+    }
+    SwapRBRowScalar(src, dst, width - j);
+}
+
+AVX2_FUNC static void
+UnpremultiplyRGBARowAVX2(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    __m256i v;
+    int j;
+
+    for (j = 0; j + 8 <= width; j += 8, src += 32, dst += 32) {
+	v = _mm256_loadu_si256((const __m256i *) src);
+	if (AllOpaqueOrClearAVX2(v)) {
+	    _mm256_storeu_si256((__m256i *) dst, v);
+	} else {
+	    UnpremultiplyRGBARowScalar(src, dst, 8);
+	}
+    }
+    UnpremultiplyRGBARowScalar(src, dst, width - j);
+}
+
+AVX2_FUNC static void
+UnpremultiplyBGRARowAVX2(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    __m256i v;
+    int j;
+
+    for (j = 0; j + 8 <= width; j += 8, src += 32, dst += 32) {
+	v = _mm256_loadu_si256((const __m256i *) src);
+	if (AllOpaqueOrClearAVX2(v)) {
+	    _mm256_storeu_si256((__m256i *) dst, SwapRBAVX2(v));
+	} else {
+	    UnpremultiplyBGRARowScalar(src, dst, 8);
+	}
+    }
+    UnpremultiplyBGRARowScalar(src, dst, width - j);
+}
+
+AVX2_FUNC static void
+PremultiplyBGRARowAVX2(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i v, lo, hi;
+    int j;
+
+    /* Unpack and pack work within 128 bit lanes so pixel order is kept. */
+    for (j = 0; j + 8 <= width; j += 8, src += 32, dst += 32) {
+	v = _mm256_loadu_si256((const __m256i *) src);
+	lo = PremultiplyAVX2(_mm256_unpacklo_epi8(v, zero));
+	hi = PremultiplyAVX2(_mm256_unpackhi_epi8(v, zero));
+	_mm256_storeu_si256((__m256i *) dst, _mm256_packus_epi16(lo, hi));
+    }
+    PremultiplyBGRARowScalar(src, dst, width - j);
+}
+
+static const PathPixelKernels avx2Kernels = {
+    SwapRBRowAVX2, UnpremultiplyRGBARowAVX2,
+    UnpremultiplyBGRARowAVX2, PremultiplyBGRARowAVX2
+};
+#endif /* PATH_PIXEL_AVX2 */
+
+#ifdef PATH_PIXEL_NEON
+
+static int
+AllOpaqueOrClearNEON(uint8x16_t a)
+{
+    return (vminvq_u8(vorrq_u8(vceqq_u8(a, vdupq_n_u8(0)),
+	    vceqq_u8(a, vdupq_n_u8(0xFF)))) == 0xFF);
+}
+
+static uint8x16_t
+PremultiplyNEON(uint8x16_t c, uint8x16_t a)
+{
+    const uint16x8_t one = vdupq_n_u16(1);
+    uint16x8_t lo = vmull_u8(vget_low_u8(c), vget_low_u8(a));
+    uint16x8_t hi = vmull_high_u8(c, a);
+
+    lo = vaddq_u16(vaddq_u16(lo, one), vshrq_n_u16(lo, 8));
+    hi = vaddq_u16(vaddq_u16(hi, one), vshrq_n_u16(hi, 8));
+    return vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+}
+
+static void
+SwapRBRowNEON(const unsigned char *src, unsigned char *dst, int width)
+{
+    uint8x16x4_t v;
+    uint8x16_t t;
+    int j;
+
+    for (j = 0; j + 16 <= width; j += 16, src += 64, dst += 64) {
+	v = vld4q_u8(src);
+	t = v.val[0], v.val[0] = v.val[2], v.val[2] = t;
+	vst4q_u8(dst, v);
+    }
+    SwapRBRowScalar(src, dst, width - j);
+}
+
+static void
+UnpremultiplyRGBARowNEON(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    int j;
+
+    for (j = 0; j + 16 <= width; j += 16, src += 64, dst += 64) {
+	if (AllOpaqueOrClearNEON(vld4q_u8(src).val[3])) {
+	    vst1q_u8(dst, vld1q_u8(src));
+	    vst1q_u8(dst + 16, vld1q_u8(src + 16));
+	    vst1q_u8(dst + 32, vld1q_u8(src + 32));
+	    vst1q_u8(dst + 48, vld1q_u8(src + 48));
+	} else {
+	    UnpremultiplyRGBARowScalar(src, dst, 16);
+	}
+    }
+    UnpremultiplyRGBARowScalar(src, dst, width - j);
+}
+
+static void
+UnpremultiplyBGRARowNEON(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    uint8x16x4_t v;
+    uint8x16_t t;
+    int j;
+
+    for (j = 0; j + 16 <= width; j += 16, src += 64, dst += 64) {
+	v = vld4q_u8(src);
+	if (AllOpaqueOrClearNEON(v.val[3])) {
+	    t = v.val[0], v.val[0] = v.val[2], v.val[2] = t;
+	    vst4q_u8(dst, v);
+	} else {
+	    UnpremultiplyBGRARowScalar(src, dst, 16);
+	}
+    }
+    UnpremultiplyBGRARowScalar(src, dst, width - j);
+}
+
+static void
+PremultiplyBGRARowNEON(const unsigned char *src, unsigned char *dst,
+    int width)
+{
+    uint8x16x4_t v, w;
+    int j;
+
+    for (j = 0; j + 16 <= width; j += 16, src += 64, dst += 64) {
+	v = vld4q_u8(src);
+	w.val[0] = PremultiplyNEON(v.val[2], v.val[3]);
+	w.val[1] = PremultiplyNEON(v.val[1], v.val[3]);
+	w.val[2] = PremultiplyNEON(v.val[0], v.val[3]);
+	w.val[3] = v.val[3];
+	vst4q_u8(dst, w);
+    }
+    PremultiplyBGRARowScalar(src, dst, width - j);
+}
+
+static const PathPixelKernels neonKernels = {
+    SwapRBRowNEON, UnpremultiplyRGBARowNEON,
+    UnpremultiplyBGRARowNEON, PremultiplyBGRARowNEON
+};
+#endif /* PATH_PIXEL_NEON */
+
+#ifdef TKPATH_TEST
+/*
+ * The kernels GetPixelKernels returns when a test forced them, else NULL.
+ */
+
+static const PathPixelKernels *forcedKernelsPtr = NULL;
+#endif
+
+/*
+ *--------------------------------------------------------------
+ *
+ * GetPixelKernels --
+ *
+ *	Picks the fastest row kernels this CPU can run. Threads racing
+ *	here all store the same pointer. Test builds can force other
+ *	kernels with ::tkp::pixelkernels.
+ *
+ * Results:
+ *	The kernels.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static const PathPixelKernels *
+GetPixelKernels(void)
+{
+    static const PathPixelKernels *kernelsPtr = NULL;
+
+#ifdef TKPATH_TEST
+    if (forcedKernelsPtr != NULL) {
+	return forcedKernelsPtr;
+    }
+#endif
+    if (kernelsPtr == NULL) {
+	const PathPixelKernels *bestPtr = &scalarKernels;
+
+#ifdef PATH_PIXEL_SSE2
+	bestPtr = &sse2Kernels;
+#endif
+#ifdef PATH_PIXEL_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+	    bestPtr = &avx2Kernels;
+	}
+#endif
+#ifdef PATH_PIXEL_NEON
+	bestPtr = &neonKernels;
+#endif
+	kernelsPtr = bestPtr;
+    }
+    return kernelsPtr;
+}
+
+#ifdef TKPATH_TEST
+/*
+ * The kernels by name, in the order ::tkp::pixelkernels lists them.
+ */
+
+static const char *const kernelNames[] = {
+    "scalar", "sse2", "avx2", "neon", NULL
+};
+
+/*
+ *--------------------------------------------------------------
+ *
+ * FindPixelKernels --
+ *
+ *	Looks up the kernels with the given index into kernelNames.
+ *
+ * Results:
+ *	The kernels, or NULL if they are not compiled in or this CPU
+ *	can't run them.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static const PathPixelKernels *
+FindPixelKernels(int index)
+{
+    switch (index) {
+	case 0:
+	    return &scalarKernels;
+#ifdef PATH_PIXEL_SSE2
+	case 1:
+	    return &sse2Kernels;
+#endif
+#ifdef PATH_PIXEL_AVX2
+	case 2:
+	    __builtin_cpu_init();
+	    return __builtin_cpu_supports("avx2") ? &avx2Kernels : NULL;
+#endif
+#ifdef PATH_PIXEL_NEON
+	case 3:
+	    return &neonKernels;
+#endif
+    }
+    return NULL;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ComparePixelKernels --
+ *
+ *	Runs every row proc of the kernels and of the scalar kernels over
+ *	pixels with all pairs of alpha and color value. The pixels are
+ *	cut into rows of each width from 1 to 3 times the widest vector,
+ *	so that all tails are hit, and the rows are written into buffers
+ *	with guard bytes after them.
+ *
+ * Results:
+ *	NULL if all output bytes are the same, else a message about the
+ *	first difference which the caller must free.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+#define PIXEL_TEST_COUNT (256*256)
+#define PIXEL_TEST_GUARD 64
+
+static char *
+ComparePixelKernels(const PathPixelKernels *kernelsPtr)
+{
+    static const char *const procNames[] = {
+	"swapRB", "unpremultiplyRGBA", "unpremultiplyBGRA", "premultiplyBGRA"
+    };
+    PathPixelRowProc *const scalarProcs[] = {
+	scalarKernels.swapRB, scalarKernels.unpremultiplyRGBA,
+	scalarKernels.unpremultiplyBGRA, scalarKernels.premultiplyBGRA
+    };
+    PathPixelRowProc *const procs[] = {
+	kernelsPtr->swapRB, kernelsPtr->unpremultiplyRGBA,
+	kernelsPtr->unpremultiplyBGRA, kernelsPtr->premultiplyBGRA
+    };
+    int size = 4*PIXEL_TEST_COUNT + PIXEL_TEST_GUARD;
+    unsigned char *src, *expected, *actual;
+    char *message = NULL;
+    int i, k, width, x, n;
+
+    src = (unsigned char *) ckalloc(4*PIXEL_TEST_COUNT);
+    expected = (unsigned char *) ckalloc(size);
+    actual = (unsigned char *) ckalloc(size);
+
+    /*
+     * Pixel i has alpha i/256 and each color channel sees every value.
+     */
+
+    for (i = 0; i < PIXEL_TEST_COUNT; i++) {
+	src[4*i] = i & 0xFF;
+	src[4*i+1] = (i + 85) & 0xFF;
+	src[4*i+2] = (i + 170) & 0xFF;
+	src[4*i+3] = i >> 8;
+    }
+    for (k = 0; (k < 4) && (message == NULL); k++) {
+	for (width = 1; (width <= 24) && (message == NULL); width++) {
+	    memset(expected, 0xA5, size);
+	    memset(actual, 0xA5, size);
+	    for (x = 0; x < PIXEL_TEST_COUNT; x += width) {
+		n = (x + width > PIXEL_TEST_COUNT) ? PIXEL_TEST_COUNT - x : width;
+		scalarProcs[k](src + 4*x, expected + 4*x, n);
+		procs[k](src + 4*x, actual + 4*x, n);
+	    }
+	    for (i = 0; i < size; i++) {
+		if (expected[i] != actual[i]) {
+		    message = ckalloc(200);
+		    sprintf(message, "%s width %d byte %d: expected %d got %d",
+			    procNames[k], width, i, expected[i], actual[i]);
+		    break;
+		}
+	    }
+	}
+    }
+    ckfree((char *) src);
+    ckfree((char *) expected);
+    ckfree((char *) actual);
+    return message;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PixelKernelsObjCmd --
+ *
+ *	Implements the ::tkp::pixelkernels command of test builds:
+ *
+ *	    ::tkp::pixelkernels
+ *		Lists the kernels this CPU can run, scalar first.
+ *	    ::tkp::pixelkernels force ?name?
+ *		Makes all pixel conversions use the named kernels, or
+ *		the fastest ones again without a name.
+ *	    ::tkp::pixelkernels compare name
+ *		Compares the named kernels byte for byte with the
+ *		scalar ones and returns the first difference, or an
+ *		empty string.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	force changes the kernels GetPixelKernels returns.
+ *
+ *--------------------------------------------------------------
+ */
+
+int
+PixelKernelsObjCmd(ClientData clientData, Tcl_Interp *interp,
+	int objc, Tcl_Obj *const objv[])
+{
+    static const char *const optionNames[] = {"compare", "force", NULL};
+    enum options {PIXEL_COMPARE, PIXEL_FORCE};
+    const PathPixelKernels *kernelsPtr = NULL;
+    int i, option, index;
+    char *message;
+
+    if (objc == 1) {
+	Tcl_Obj *listObj = Tcl_NewListObj(0, NULL);
+
+	for (i = 0; kernelNames[i] != NULL; i++) {
+	    if (FindPixelKernels(i) != NULL) {
+		Tcl_ListObjAppendElement(interp, listObj,
+			Tcl_NewStringObj(kernelNames[i], -1));
+	    }
+	}
+	Tcl_SetObjResult(interp, listObj);
+	return TCL_OK;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], optionNames, "option", 0,
+	    &option) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    if ((objc != 3) && !((option == PIXEL_FORCE) && (objc == 2))) {
+	Tcl_WrongNumArgs(interp, 2, objv,
+		(option == PIXEL_FORCE) ? "?name?" : "name");
+	return TCL_ERROR;
+    }
+    if (objc == 3) {
+	if (Tcl_GetIndexFromObj(interp, objv[2], kernelNames, "kernel", 0,
+		&index) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	kernelsPtr = FindPixelKernels(index);
+	if (kernelsPtr == NULL) {
+	    Tcl_SetObjResult(interp, Tcl_ObjPrintf(
+		    "kernel \"%s\" is not available", kernelNames[index]));
+	    return TCL_ERROR;
+	}
+    }
+    switch ((enum options) option) {
+	case PIXEL_COMPARE:
+	    message = ComparePixelKernels(kernelsPtr);
+	    if (message != NULL) {
+		Tcl_SetObjResult(interp, Tcl_NewStringObj(message, -1));
+		ckfree(message);
+	    }
+	    break;
+	case PIXEL_FORCE:
+	    forcedKernelsPtr = kernelsPtr;
+	    break;
+    }
+    return TCL_OK;
+}
+#endif /* TKPATH_TEST */
+
 /*
  *--------------------------------------------------------------
  *
@@ -336,23 +1175,12 @@ void
 PathCopyBitsBGRA(unsigned char *from, unsigned char *to,
         int width, int height, int bytesPerRow)
 {
-    unsigned char *src, *dst;
-    int i, j;
+    const PathPixelKernels *kernelsPtr = GetPixelKernels();
+    int i;
 
     /* Copy BGRA -> RGBA */
     for (i = 0; i < height; i++) {
-        src = from + i*bytesPerRow;
-        dst = to + i*bytesPerRow;
-        for (j = 0; j < width; j++, src += 4) {
-            /* RED */
-            *dst++ = *(src+2);
-            /* GREEN */
-            *dst++ = *(src+1);
-            /* BLUE */
-            *dst++ = *src;
-            /* ALPHA */
-            *dst++ = *(src+3);
-        }
+        kernelsPtr->swapRB(from + i*bytesPerRow, to + i*bytesPerRow, width);
     }
 }
 
@@ -378,28 +1206,13 @@ void
 PathCopyBitsPremultipliedAlphaRGBA(unsigned char *from, unsigned char *to,
         int width, int height, int bytesPerRow)
 {
-    unsigned char *src, *dst, alpha;
-    int i, j;
+    const PathPixelKernels *kernelsPtr = GetPixelKernels();
+    int i;
 
     /* Copy src RGBA with premulitplied alpha to "plain" RGBA. */
     for (i = 0; i < height; i++) {
-        src = from + i*bytesPerRow;
-        dst = to + i*bytesPerRow;
-        for (j = 0; j < width; j++) {
-            alpha = *(src+3);
-            if (alpha == 0xFF || alpha == 0x00) {
-                memcpy(dst, src, 4);
-                src += 4;
-                dst += 4;
-            } else {
-                /* dst = 255*src/alpha */
-                *dst++ = (*src++*255)/alpha;
-                *dst++ = (*src++*255)/alpha;
-                *dst++ = (*src++*255)/alpha;
-                *dst++ = alpha;
-                src++;
-            }
-        }
+        kernelsPtr->unpremultiplyRGBA(from + i*bytesPerRow,
+                to + i*bytesPerRow, width);
     }
 }
 
@@ -441,36 +1254,43 @@ void
 PathCopyBitsPremultipliedAlphaBGRA(unsigned char *from, unsigned char *to,
         int width, int height, int bytesPerRow)
 {
-    unsigned char *src, *dst, alpha;
-    int i, j;
+    const PathPixelKernels *kernelsPtr = GetPixelKernels();
+    int i;
 
     /* Copy src BGRA with premulitplied alpha to "plain" RGBA. */
     for (i = 0; i < height; i++) {
-        src = from + i*bytesPerRow;
-        dst = to + i*bytesPerRow;
-        for (j = 0; j < width; j++, src += 4) {
-            alpha = *(src+3);
-            if (alpha == 0xFF || alpha == 0x00) {
-                /* RED */
-                *dst++ = *(src+2);
-                /* GREEN */
-                *dst++ = *(src+1);
-                /* BLUE */
-                *dst++ = *src;
-                /* ALPHA */
-                *dst++ = *(src+3);
-            } else {
-                /* dst = 255*src/alpha */
-                /* RED */
-                *dst++ = (*(src+2)*255)/alpha;
-                /* GREEN */
-                *dst++ = (*(src+1)*255)/alpha;
-                /* BLUE */
-                *dst++ = (*(src+0)*255)/alpha;
-                /* ALPHA */
-                *dst++ = alpha;
-            }
-        }
+        kernelsPtr->unpremultiplyBGRA(from + i*bytesPerRow,
+                to + i*bytesPerRow, width);
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * PathCopyBitsToPremultipliedAlphaBGRA --
+ *
+ *	Copies RGBA bitmap data from a photo to BGRA with alpha
+ *	premultiplied, which is what cairo uses on little endian machines.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+void
+PathCopyBitsToPremultipliedAlphaBGRA(unsigned char *from, unsigned char *to,
+        int width, int height, int bytesPerRow)
+{
+    const PathPixelKernels *kernelsPtr = GetPixelKernels();
+    int i;
+
+    for (i = 0; i < height; i++) {
+        kernelsPtr->premultiplyBGRA(from + i*bytesPerRow,
+                to + i*bytesPerRow, width);
     }
 }
 
@@ -151,6 +151,17 @@ typedef struct Tk_PathItem {
 #define TK_ITEM_STATE_DEPENDANT		1
 #define TK_ITEM_DONT_REDRAW		2
 
+/*
+ * Flag bits for item types (alwaysRedraw), besides bit 0 which means that
+ * displayProc must be called even when the item is off-screen:
+ *
+ * TK_PATH_DRAWS_IN_CONTEXT -	1 means that displayProc only draws through
+ *				the context from TkPathCanvasBeginDraw and
+ *				never directly into the drawable.
+ */
+
+#define TK_PATH_DRAWS_IN_CONTEXT	2
+
 /*
  * Records of the following type are used to describe a type of item (e.g.
  * lines, circles, etc.) that can form part of a canvas widget.
@@ -977,6 +977,8 @@ ImageChangedProc(
 		imgPtr->header.y1, imgPtr->header.x2, imgPtr->header.y2);
     }
     ComputeImageBbox(imgPtr->canvas, imgPtr);
+    TkPathCanvasIndexUpdate((TkPathCanvas *) imgPtr->canvas,
+	    (Tk_PathItem *) imgPtr);
     Tk_PathCanvasEventuallyRedraw(imgPtr->canvas, imgPtr->header.x1 + x,
 	    imgPtr->header.y1 + y, (int) (imgPtr->header.x1 + x + width),
 	    (int) (imgPtr->header.y1 + y + height));
@@ -0,0 +1,796 @@
+/*
+ * tkpCanvIndex.c --
+ *
+ *	This file implements a spatial index of the items of a canvas.
+ *	The index is a uniform grid of square cells, each of which lists
+ *	the items whose bounding box overlaps it. It is used to quickly
+ *	find the items which may overlap a given area, in stacking order,
+ *	when redisplaying, searching areas and picking the current item.
+ *
+ * See the file "license.terms" for information on usage and redistribution of
+ * this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include "tkInt.h"
+#include "tkpCanvas.h"
+#include "tkIntPath.h"
+
+/*
+ * Size of the grid cells as a power of two, in canvas units.
+ */
+
+#define INDEX_CELL_SHIFT	7
+
+/*
+ * Items covering more cells than this are not put in the grid but kept
+ * in a separate list which is part of every search result.
+ */
+
+#define INDEX_MAX_ITEM_CELLS	256
+
+/*
+ * Canvases with fewer items than this are always searched linearly.
+ */
+
+#define INDEX_MIN_ITEMS		32
+
+/*
+ * One entry for every item in the canvas. The item points to it with its
+ * reserved1 field, which keeps the public item record unchanged.
+ */
+
+#define ItemIndexEntry(itemPtr) \
+	((TkPathIndexEntry *) (itemPtr)->reserved1)
+#define SetItemIndexEntry(itemPtr, entryPtr) \
+	((itemPtr)->reserved1 = (char *) (entryPtr))
+
+struct TkPathIndexEntry {
+    Tk_PathItem *itemPtr;	/* The item this entry is for. */
+    int where;			/* One of the ENTRY_* values below. */
+    int cx1, cy1, cx2, cy2;	/* Range of cells, inclusive, the item is
+				 * registered in if where is ENTRY_IN_GRID. */
+    int overflowIndex;		/* Position in the overflow list if where is
+				 * ENTRY_IN_OVERFLOW. */
+    int order;			/* Position of the item in the stacking
+				 * order. Only valid if the index orderValid
+				 * flag is set. */
+    unsigned stamp;		/* Number of the last search which collected
+				 * this entry, to avoid duplicates. */
+};
+
+enum {
+    ENTRY_NOWHERE,
+    ENTRY_IN_GRID,
+    ENTRY_IN_OVERFLOW
+};
+
+/*
+ * The entries in a single grid cell.
+ */
+
+typedef struct IndexCell {
+    TkPathIndexEntry **entries;	/* Array of entries, in no particular
+				 * order. */
+    int numEntries;		/* Number of used slots in entries. */
+    int size;			/* Number of allocated slots in entries. */
+} IndexCell;
+
+struct TkPathItemIndex {
+    Tcl_HashTable cellTable;	/* Maps cell coordinates, two ints, to
+				 * IndexCell structs. Only non-empty cells
+				 * are present. */
+    TkPathIndexEntry **overflow;/* Entries for items which are not in the
+				 * grid: groups, items which are always
+				 * redrawn, and very large or empty items. */
+    int numOverflow;		/* Number of used slots in overflow. */
+    int overflowSize;		/* Number of allocated slots in overflow. */
+    int numEntries;		/* Total number of entries in the index. */
+    unsigned stamp;		/* Incremented for every search. */
+    int orderValid;		/* 0 means that the stacking order of items
+				 * has changed since the entries were last
+				 * numbered. */
+};
+
+/*
+ * Prototypes for functions defined in this file:
+ */
+
+static void		AddToArray(TkPathIndexEntry ***arrayPtr,
+			    int *numPtr, int *sizePtr,
+			    TkPathIndexEntry *entryPtr);
+static int		CellCoord(int x);
+static int		CompareOrder(const void *p1, const void *p2);
+static void		IndexRegister(TkPathItemIndex *indexPtr,
+			    TkPathIndexEntry *entryPtr);
+static void		IndexUnregister(TkPathItemIndex *indexPtr,
+			    TkPathIndexEntry *entryPtr);
+static void		NumberEntries(TkPathCanvas *canvasPtr);
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasIndexCreate --
+ *
+ *	Allocates an empty spatial index for a canvas.
+ *
+ * Results:
+ *	A pointer to the new index.
+ *
+ * Side effects:
+ *	Memory allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TkPathItemIndex *
+TkPathCanvasIndexCreate(void)
+{
+    TkPathItemIndex *indexPtr;
+
+    indexPtr = (TkPathItemIndex *) ckalloc(sizeof(TkPathItemIndex));
+    Tcl_InitHashTable(&indexPtr->cellTable, 2);
+    indexPtr->overflow = NULL;
+    indexPtr->numOverflow = 0;
+    indexPtr->overflowSize = 0;
+    indexPtr->numEntries = 0;
+    indexPtr->stamp = 0;
+    indexPtr->orderValid = 0;
+    return indexPtr;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasIndexFree --
+ *
+ *	Frees a spatial index. The entries of any items still in the index
+ *	are freed as well, and the index entries of their items reset.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Memory freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasIndexFree(
+    TkPathCanvas *canvasPtr)	/* Canvas whose index shall be freed. */
+{
+    TkPathItemIndex *indexPtr = canvasPtr->itemIndexPtr;
+    Tk_PathItem *itemPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    IndexCell *cellPtr;
+
+    if (indexPtr == NULL) {
+	return;
+    }
+    for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
+	    itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+	if (ItemIndexEntry(itemPtr) != NULL) {
+	    ckfree((char *) ItemIndexEntry(itemPtr));
+	    SetItemIndexEntry(itemPtr, NULL);
+	}
+    }
+    for (hPtr = Tcl_FirstHashEntry(&indexPtr->cellTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+	ckfree((char *) cellPtr->entries);
+	ckfree((char *) cellPtr);
+    }
+    Tcl_DeleteHashTable(&indexPtr->cellTable);
+    if (indexPtr->overflow != NULL) {
+	ckfree((char *) indexPtr->overflow);
+    }
+    ckfree((char *) indexPtr);
+    canvasPtr->itemIndexPtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasIndexUpdate --
+ *
+ *	Registers an item in the index with its current bounding box. It
+ *	must be called every time the bounding box of an item has changed,
+ *	and once when the item has been created.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The item's entry is created if needed and moved to the cells its
+ *	bounding box overlaps.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasIndexUpdate(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_PathItem *itemPtr)	/* Item whose bbox may have changed. */
+{
+    TkPathItemIndex *indexPtr = canvasPtr->itemIndexPtr;
+    TkPathIndexEntry *entryPtr = ItemIndexEntry(itemPtr);
+    int where, cx1 = 0, cy1 = 0, cx2 = 0, cy2 = 0;
+
+    if (indexPtr == NULL) {
+	return;
+    }
+    if (entryPtr == NULL) {
+	entryPtr = (TkPathIndexEntry *) ckalloc(sizeof(TkPathIndexEntry));
+	entryPtr->itemPtr = itemPtr;
+	entryPtr->where = ENTRY_NOWHERE;
+	entryPtr->overflowIndex = -1;
+	entryPtr->order = 0;
+	entryPtr->stamp = indexPtr->stamp;
+	SetItemIndexEntry(itemPtr, entryPtr);
+	indexPtr->numEntries++;
+	indexPtr->orderValid = 0;
+    }
+
+    /*
+     * Groups get their bbox from their children and are always visited
+     * anyway, and items which are always redrawn must be found even when
+     * they are far away. Items with an inverted bbox are kept out of the
+     * grid too, since the display code may still consider them.
+     */
+
+    if ((itemPtr->typePtr == &tkGroupType)
+	    || (itemPtr->typePtr->alwaysRedraw & 1)
+	    || (itemPtr->x1 > itemPtr->x2) || (itemPtr->y1 > itemPtr->y2)) {
+	where = ENTRY_IN_OVERFLOW;
+    } else {
+	cx1 = CellCoord(itemPtr->x1);
+	cy1 = CellCoord(itemPtr->y1);
+	cx2 = CellCoord(itemPtr->x2);
+	cy2 = CellCoord(itemPtr->y2);
+	if (((double) cx2 - cx1 + 1.0) * ((double) cy2 - cy1 + 1.0)
+		> INDEX_MAX_ITEM_CELLS) {
+	    where = ENTRY_IN_OVERFLOW;
+	} else {
+	    where = ENTRY_IN_GRID;
+	}
+    }
+    if (where == entryPtr->where) {
+	if ((where == ENTRY_IN_OVERFLOW)
+		|| ((cx1 == entryPtr->cx1) && (cy1 == entryPtr->cy1)
+		&& (cx2 == entryPtr->cx2) && (cy2 == entryPtr->cy2))) {
+	    return;
+	}
+    }
+    IndexUnregister(indexPtr, entryPtr);
+    entryPtr->where = where;
+    entryPtr->cx1 = cx1;
+    entryPtr->cy1 = cy1;
+    entryPtr->cx2 = cx2;
+    entryPtr->cy2 = cy2;
+    IndexRegister(indexPtr, entryPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasIndexRemove --
+ *
+ *	Removes an item from the index. Called when the item is deleted.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The item's entry is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasIndexRemove(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_PathItem *itemPtr)	/* Item being deleted. */
+{
+    TkPathItemIndex *indexPtr = canvasPtr->itemIndexPtr;
+    TkPathIndexEntry *entryPtr = ItemIndexEntry(itemPtr);
+
+    if ((indexPtr == NULL) || (entryPtr == NULL)) {
+	return;
+    }
+    IndexUnregister(indexPtr, entryPtr);
+    indexPtr->numEntries--;
+    ckfree((char *) entryPtr);
+    SetItemIndexEntry(itemPtr, NULL);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasIndexOrderChanged --
+ *
+ *	Must be called when items are inserted in, or moved within, the
+ *	display list so that the stacking order gets renumbered before the
+ *	next search.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasIndexOrderChanged(
+    TkPathCanvas *canvasPtr)	/* Canvas whose display list changed. */
+{
+    if (canvasPtr->itemIndexPtr != NULL) {
+	canvasPtr->itemIndexPtr->orderValid = 0;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasAreaSearchFirst, TkPathCanvasAreaSearchNext,
+ * TkPathCanvasAreaSearchDone --
+ *
+ *	These functions visit, in stacking order, the items of a canvas
+ *	whose bounding box may overlap the area x1,y1 - x2,y2 (inclusive,
+ *	canvas coordinates). Any item overlapping the area is returned,
+ *	but also items which don't, so callers must still check the
+ *	bounding box themselves. Items are looked up in the spatial index
+ *	when that pays off, else all the items of the canvas are visited,
+ *	starting with the root item.
+ *
+ * Results:
+ *	The first or next item, or NULL when there are no more items.
+ *
+ * Side effects:
+ *	TkPathCanvasAreaSearchFirst may allocate memory which is freed by
+ *	TkPathCanvasAreaSearchDone which must always be called when done.
+ *
+ *----------------------------------------------------------------------
+ */
+
+Tk_PathItem *
+TkPathCanvasAreaSearchFirst(
+    TkPathCanvas *canvasPtr,	/* Canvas to search. */
+    int x1, int y1, int x2, int y2,
+				/* Area of interest. */
+    TkPathAreaSearch *searchPtr)/* Search state, filled in here. */
+{
+    TkPathItemIndex *indexPtr = canvasPtr->itemIndexPtr;
+    TkPathIndexEntry **found = NULL;
+    TkPathIndexEntry *entryPtr;
+    IndexCell *cellPtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    int numFound = 0, foundSize = 0;
+    int cx1, cy1, cx2, cy2, cx, cy, i, key[2];
+    double numCells;
+
+    searchPtr->canvasPtr = canvasPtr;
+    searchPtr->items = NULL;
+    searchPtr->numItems = 0;
+    searchPtr->index = 0;
+    searchPtr->itemPtr = canvasPtr->rootItemPtr;
+    searchPtr->linear = 1;
+
+    if ((indexPtr == NULL) || (indexPtr->numEntries < INDEX_MIN_ITEMS)
+	    || (x1 > x2) || (y1 > y2)) {
+	return searchPtr->itemPtr;
+    }
+    indexPtr->stamp++;
+    for (i = 0; i < indexPtr->numOverflow; i++) {
+	entryPtr = indexPtr->overflow[i];
+	entryPtr->stamp = indexPtr->stamp;
+	AddToArray(&found, &numFound, &foundSize, entryPtr);
+    }
+
+    /*
+     * Look up the cells covered by the area one by one, unless there are
+     * fewer non-empty cells than that in which case all cells are
+     * checked for being inside the area.
+     */
+
+    cx1 = CellCoord(x1);
+    cy1 = CellCoord(y1);
+    cx2 = CellCoord(x2);
+    cy2 = CellCoord(y2);
+    numCells = ((double) cx2 - cx1 + 1.0) * ((double) cy2 - cy1 + 1.0);
+    if (numCells <= indexPtr->cellTable.numEntries) {
+	hPtr = NULL;
+	for (cy = cy1; ; cy++) {
+	    for (cx = cx1; ; cx++) {
+		key[0] = cx;
+		key[1] = cy;
+		hPtr = Tcl_FindHashEntry(&indexPtr->cellTable, (char *) key);
+		if (hPtr != NULL) {
+		    cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+		    for (i = 0; i < cellPtr->numEntries; i++) {
+			entryPtr = cellPtr->entries[i];
+			if (entryPtr->stamp != indexPtr->stamp) {
+			    entryPtr->stamp = indexPtr->stamp;
+			    AddToArray(&found, &numFound, &foundSize, entryPtr);
+			}
+		    }
+		}
+		if (cx == cx2) {
+		    break;
+		}
+	    }
+	    if (cy == cy2) {
+		break;
+	    }
+	}
+    } else {
+	for (hPtr = Tcl_FirstHashEntry(&indexPtr->cellTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    int *keyPtr = (int *) Tcl_GetHashKey(&indexPtr->cellTable, hPtr);
+
+	    if ((keyPtr[0] < cx1) || (keyPtr[0] > cx2)
+		    || (keyPtr[1] < cy1) || (keyPtr[1] > cy2)) {
+		continue;
+	    }
+	    cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+	    for (i = 0; i < cellPtr->numEntries; i++) {
+		entryPtr = cellPtr->entries[i];
+		if (entryPtr->stamp != indexPtr->stamp) {
+		    entryPtr->stamp = indexPtr->stamp;
+		    AddToArray(&found, &numFound, &foundSize, entryPtr);
+		}
+	    }
+	}
+    }
+
+    /*
+     * If the area covers much of the canvas, walking the display list is
+     * cheaper than sorting.
+     */
+
+    if (numFound > indexPtr->numEntries / 2) {
+	if (found != NULL) {
+	    ckfree((char *) found);
+	}
+	return searchPtr->itemPtr;
+    }
+    searchPtr->itemPtr = NULL;
+    searchPtr->linear = 0;
+    if (numFound == 0) {
+	return NULL;
+    }
+    if (!indexPtr->orderValid) {
+	NumberEntries(canvasPtr);
+    }
+    qsort(found, (size_t) numFound, sizeof(TkPathIndexEntry *), CompareOrder);
+    searchPtr->items = (Tk_PathItem **) found;
+    for (i = 0; i < numFound; i++) {
+	searchPtr->items[i] = found[i]->itemPtr;
+    }
+    searchPtr->numItems = numFound;
+    searchPtr->index = 1;
+    return searchPtr->items[0];
+}
+
+Tk_PathItem *
+TkPathCanvasAreaSearchNext(
+    TkPathAreaSearch *searchPtr)/* Search state from
+				 * TkPathCanvasAreaSearchFirst. */
+{
+    if (searchPtr->linear) {
+	if (searchPtr->itemPtr != NULL) {
+	    searchPtr->itemPtr =
+		    TkPathCanvasItemIteratorNext(searchPtr->itemPtr);
+	}
+	return searchPtr->itemPtr;
+    }
+    if (searchPtr->index >= searchPtr->numItems) {
+	return NULL;
+    }
+    return searchPtr->items[searchPtr->index++];
+}
+
+void
+TkPathCanvasAreaSearchDone(
+    TkPathAreaSearch *searchPtr)/* Search state from
+				 * TkPathCanvasAreaSearchFirst. */
+{
+    if (searchPtr->items != NULL) {
+	ckfree((char *) searchPtr->items);
+	searchPtr->items = NULL;
+    }
+    searchPtr->itemPtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasAreaSearchIsLinear --
+ *
+ *	Tells whether a search started by TkPathCanvasAreaSearchFirst
+ *	visits all items of the canvas rather than index candidates.
+ *
+ * Results:
+ *	1 if all items are visited, else 0.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkPathCanvasAreaSearchIsLinear(
+    TkPathAreaSearch *searchPtr)/* Search state from
+				 * TkPathCanvasAreaSearchFirst. */
+{
+    return searchPtr->linear;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasIndexSortItems --
+ *
+ *	Sorts an array of items of a canvas into stacking order, bottom
+ *	first.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The array is reordered. Stacking order is renumbered if needed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasIndexSortItems(
+    TkPathCanvas *canvasPtr,	/* Canvas containing the items. */
+    Tk_PathItem **items,	/* Items to sort, all with an index
+				 * entry. */
+    int numItems)		/* Number of items. */
+{
+    TkPathIndexEntry **entries;
+    int i;
+
+    if ((canvasPtr->itemIndexPtr == NULL) || (numItems < 2)) {
+	return;
+    }
+    if (!canvasPtr->itemIndexPtr->orderValid) {
+	NumberEntries(canvasPtr);
+    }
+    entries = (TkPathIndexEntry **) items;
+    for (i = 0; i < numItems; i++) {
+	entries[i] = ItemIndexEntry(items[i]);
+    }
+    qsort(entries, (size_t) numItems, sizeof(TkPathIndexEntry *),
+	    CompareOrder);
+    for (i = 0; i < numItems; i++) {
+	items[i] = entries[i]->itemPtr;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * IndexRegister, IndexUnregister --
+ *
+ *	Add an entry to, or remove it from, the cells or the overflow list
+ *	given by its where and cell range fields.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Cells are created or freed as needed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+IndexRegister(
+    TkPathItemIndex *indexPtr,
+    TkPathIndexEntry *entryPtr)
+{
+    Tcl_HashEntry *hPtr;
+    IndexCell *cellPtr;
+    int cx, cy, key[2], isNew;
+
+    if (entryPtr->where == ENTRY_IN_OVERFLOW) {
+	entryPtr->overflowIndex = indexPtr->numOverflow;
+	AddToArray(&indexPtr->overflow, &indexPtr->numOverflow,
+		&indexPtr->overflowSize, entryPtr);
+	return;
+    }
+    if (entryPtr->where != ENTRY_IN_GRID) {
+	return;
+    }
+    for (cy = entryPtr->cy1; ; cy++) {
+	for (cx = entryPtr->cx1; ; cx++) {
+	    key[0] = cx;
+	    key[1] = cy;
+	    hPtr = Tcl_CreateHashEntry(&indexPtr->cellTable, (char *) key,
+		    &isNew);
+	    if (isNew) {
+		cellPtr = (IndexCell *) ckalloc(sizeof(IndexCell));
+		cellPtr->entries = NULL;
+		cellPtr->numEntries = 0;
+		cellPtr->size = 0;
+		Tcl_SetHashValue(hPtr, cellPtr);
+	    } else {
+		cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+	    }
+	    AddToArray(&cellPtr->entries, &cellPtr->numEntries,
+		    &cellPtr->size, entryPtr);
+	    if (cx == entryPtr->cx2) {
+		break;
+	    }
+	}
+	if (cy == entryPtr->cy2) {
+	    break;
+	}
+    }
+}
+
+static void
+IndexUnregister(
+    TkPathItemIndex *indexPtr,
+    TkPathIndexEntry *entryPtr)
+{
+    Tcl_HashEntry *hPtr;
+    IndexCell *cellPtr;
+    int cx, cy, i, key[2];
+
+    if (entryPtr->where == ENTRY_IN_OVERFLOW) {
+	i = entryPtr->overflowIndex;
+	indexPtr->numOverflow--;
+	if (i < indexPtr->numOverflow) {
+	    indexPtr->overflow[i] = indexPtr->overflow[indexPtr->numOverflow];
+	    indexPtr->overflow[i]->overflowIndex = i;
+	}
+	entryPtr->overflowIndex = -1;
+    } else if (entryPtr->where == ENTRY_IN_GRID) {
+	for (cy = entryPtr->cy1; ; cy++) {
+	    for (cx = entryPtr->cx1; ; cx++) {
+		key[0] = cx;
+		key[1] = cy;
+		hPtr = Tcl_FindHashEntry(&indexPtr->cellTable, (char *) key);
+		if (hPtr != NULL) {
+		    cellPtr = (IndexCell *) Tcl_GetHashValue(hPtr);
+		    for (i = 0; i < cellPtr->numEntries; i++) {
+			if (cellPtr->entries[i] == entryPtr) {
+			    cellPtr->numEntries--;
+			    cellPtr->entries[i] =
+				    cellPtr->entries[cellPtr->numEntries];
+			    break;
+			}
+		    }
+		    if (cellPtr->numEntries == 0) {
+			ckfree((char *) cellPtr->entries);
+			ckfree((char *) cellPtr);
+			Tcl_DeleteHashEntry(hPtr);
+		    }
+		}
+		if (cx == entryPtr->cx2) {
+		    break;
+		}
+	    }
+	    if (cy == entryPtr->cy2) {
+		break;
+	    }
+	}
+    }
+    entryPtr->where = ENTRY_NOWHERE;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * NumberEntries --
+ *
+ *	Walks the display list and records the stacking order of every
+ *	item in its index entry.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The order fields of all entries are set.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+NumberEntries(
+    TkPathCanvas *canvasPtr)
+{
+    Tk_PathItem *itemPtr;
+    int order = 0;
+
+    for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
+	    itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+	if (ItemIndexEntry(itemPtr) != NULL) {
+	    ItemIndexEntry(itemPtr)->order = order++;
+	}
+    }
+    canvasPtr->itemIndexPtr->orderValid = 1;
+}
+
+static int
+CompareOrder(
+    const void *p1,
+    const void *p2)
+{
+    const TkPathIndexEntry *e1 = *(const TkPathIndexEntry **) p1;
+    const TkPathIndexEntry *e2 = *(const TkPathIndexEntry **) p2;
+
+    return (e1->order > e2->order) - (e1->order < e2->order);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * CellCoord --
+ *
+ *	Maps a canvas coordinate to a cell coordinate, rounding towards
+ *	negative infinity.
+ *
+ * Results:
+ *	The cell coordinate.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+CellCoord(
+    int x)
+{
+    if (x >= 0) {
+	return x >> INDEX_CELL_SHIFT;
+    }
+    return -1 - ((-1 - x) >> INDEX_CELL_SHIFT);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * AddToArray --
+ *
+ *	Appends an entry pointer to a growable array.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The array may be reallocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+AddToArray(
+    TkPathIndexEntry ***arrayPtr,
+    int *numPtr,
+    int *sizePtr,
+    TkPathIndexEntry *entryPtr)
+{
+    if (*numPtr >= *sizePtr) {
+	*sizePtr = (*sizePtr == 0) ? 4 : 2 * *sizePtr;
+	if (*arrayPtr == NULL) {
+	    *arrayPtr = (TkPathIndexEntry **) ckalloc(
+		    (unsigned) (*sizePtr * sizeof(TkPathIndexEntry *)));
+	} else {
+	    *arrayPtr = (TkPathIndexEntry **) ckrealloc((char *) *arrayPtr,
+		    (unsigned) (*sizePtr * sizeof(TkPathIndexEntry *)));
+	}
+    }
+    (*arrayPtr)[(*numPtr)++] = entryPtr;
+}
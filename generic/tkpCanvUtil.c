@@ -15,6 +15,7 @@
 #include "tkpCanvas.h"
 #include "tkIntPath.h"
 #include "tkPathStyle.h"
+#include "tkCanvPathUtil.h"
 #include <assert.h>
 
 /*
@@ -61,6 +62,13 @@ static void		    TranslateAndAppendCoords(TkPathCanvas *canvPtr,
 
 static Tk_Dash *	    TkDashNew(Tcl_Interp *interp, Tcl_Obj *dashObj);
 static void		    TkDashFree(Tk_Dash *dashPtr);
+static void		    ResolveStyle(Tk_PathItemEx *itemExPtr, long flags);
+static void		    InheritTMatrix(Tk_PathItem *itemPtr,
+				TMatrix *matrixPtr);
+static void		    GetFrameContext(TkPathCanvas *canvasPtr);
+static int		    SameBatchStyle(Tk_PathStyle *style1Ptr,
+				TMatrix *m1Ptr, Tk_PathStyle *style2Ptr,
+				TMatrix *m2Ptr);
 
 #ifndef ABS
 #	define ABS(a)    	(((a) >= 0)  ? (a) : -1*(a))
@@ -400,13 +408,16 @@ TkPathCanvasGetDepth(Tk_PathItem *itemPtr)
  *
  *	This function returns the style which is inherited from the
  *      parents of the itemPtr using cascading from the root item.
+ *	The result is cached in the item and only remade after the item,
+ *	or any group, has changed its style; see TkPathCanvasStyleChanged.
  *	Must use TkPathCanvasFreeInheritedStyle when done.
  *
  * Results:
- *	Tk_PathStyle.
+ *	Tk_PathStyle. Its matrixPtr, if any, points into the item and is
+ *	valid until the item is configured again.
  *
  * Side effects:
- *	May allocate memory for matrix.
+ *	May remake the cached styles of the item and its parents.
  *
  *----------------------------------------------------------------------
  */
@@ -414,55 +425,65 @@ TkPathCanvasGetDepth(Tk_PathItem *itemPtr)
 Tk_PathStyle
 TkPathCanvasInheritStyle(Tk_PathItem *itemPtr, long flags)
 {
-    int depth, i, anyMatrix = 0;
-    Tk_PathItem *walkPtr;
-    Tk_PathItemEx *itemExPtr;
-    Tk_PathItemEx **parents;
-    Tk_PathStyle style;
-    TMatrix matrix = kPathUnitTMatrix;
-
-    depth = TkPathCanvasGetDepth(itemPtr);
-    parents = (Tk_PathItemEx **) ckalloc(depth*sizeof(Tk_PathItemEx *));
+    Tk_PathItemEx *itemExPtr = (Tk_PathItemEx *) itemPtr;
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) itemExPtr->canvas;
 
-    walkPtr = itemPtr, i = 0;
-    while (walkPtr->parentPtr != NULL) {
-	parents[i] = (Tk_PathItemEx *) walkPtr->parentPtr;
-	walkPtr = walkPtr->parentPtr, i++;
+    if ((itemExPtr->styleGen != canvasPtr->styleGeneration)
+	    || (itemExPtr->resolvedFlags != flags)) {
+	ResolveStyle(itemExPtr, flags);
+	itemExPtr->resolvedFlags = flags;
+	itemExPtr->styleGen = canvasPtr->styleGeneration;
     }
+    return itemExPtr->resolvedStyle;
+}
 
-    /*
-     * Cascade the style from the root item to the closest parent.
-     * Start by just making a copy of the root's style.
-     */
-    itemExPtr = parents[depth-1];
-    style = itemExPtr->style;
+/*
+ *----------------------------------------------------------------------
+ *
+ * ResolveStyle --
+ *
+ *	Cascades the style from the root item down to itemExPtr and stores
+ *	it in the item's cache. The parent's cached style is used as the
+ *	starting point, so a group is resolved only once for all its
+ *	children.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Sets resolvedStyle and resolvedMatrix of the item.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    for (i = depth-1; i >= 0; i--) {
-	itemExPtr = parents[i];
+static void
+ResolveStyle(Tk_PathItemEx *itemExPtr, long flags)
+{
+    Tk_PathItem *parentPtr = itemExPtr->header.parentPtr;
+    Tk_PathStyle style;
+    TMatrix matrix = kPathUnitTMatrix;
+    int anyMatrix = 0;
 
-	/* The order of these two merges decides which take precedence. */
-	if (i < depth-1) {
-	    TkPathStyleMergeStyles(&itemExPtr->style, &style, flags);
-	}
-	if (itemExPtr->styleInst != NULL) {
-	    TkPathStyleMergeStyles(itemExPtr->styleInst->masterPtr, &style, flags);
-	}
+    if (parentPtr == NULL) {
+	/*
+	 * The root item starts the cascade with a copy of its own style.
+	 */
+	style = itemExPtr->style;
+    } else {
+	style = TkPathCanvasInheritStyle(parentPtr, flags);
 	if (style.matrixPtr != NULL) {
 	    anyMatrix = 1;
-	    MMulTMatrix(style.matrixPtr, &matrix);
+	    matrix = *style.matrixPtr;
 	}
+
 	/*
-	 * We set matrix to NULL to detect if set in group.
+	 * We set matrix to NULL to detect if set in the item.
 	 */
 	style.matrixPtr = NULL;
+	TkPathStyleMergeStyles(&itemExPtr->style, &style, flags);
     }
 
-    /*
-     * Merge the parents style with the actual items style.
-     * The order of these two merges decides which take precedence.
-     */
-    itemExPtr = (Tk_PathItemEx *) itemPtr;
-    TkPathStyleMergeStyles(&itemExPtr->style, &style, flags);
+    /* The order of these two merges decides which take precedence. */
     if (itemExPtr->styleInst != NULL) {
 	TkPathStyleMergeStyles(itemExPtr->styleInst->masterPtr, &style, flags);
     }
@@ -470,20 +491,58 @@ TkPathCanvasInheritStyle(Tk_PathItem *itemPtr, long flags)
 	anyMatrix = 1;
 	MMulTMatrix(style.matrixPtr, &matrix);
     }
-    if (anyMatrix) {
-        style.matrixPtr = (TMatrix *) ckalloc(sizeof(TMatrix));
-	memcpy(style.matrixPtr, &matrix, sizeof(TMatrix));
-    }
-    ckfree((char *) parents);
-    return style;
+    itemExPtr->resolvedMatrix = matrix;
+    style.matrixPtr = anyMatrix ? &itemExPtr->resolvedMatrix : NULL;
+    itemExPtr->resolvedStyle = style;
 }
 
 void
 TkPathCanvasFreeInheritedStyle(Tk_PathStyle *stylePtr)
 {
-    if (stylePtr->matrixPtr != NULL) {
-	ckfree((char *) stylePtr->matrixPtr);
+    /*
+     * Nothing to free since the matrix is owned by the item's cache.
+     */
+    stylePtr->matrixPtr = NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasStyleChanged --
+ *
+ *	Must be called whenever the style of an item may have changed,
+ *	including its -style, -matrix, fill and parent. For a group this
+ *	invalidates the cached styles of all items in the canvas since any
+ *	descendant may inherit from it. Any cached groups above the item
+ *	must render again.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The next TkPathCanvasInheritStyle remakes the style.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasStyleChanged(Tk_PathItem *itemPtr)
+{
+    Tk_PathItemEx *itemExPtr = (Tk_PathItemEx *) itemPtr;
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) itemExPtr->canvas;
+    Tk_PathItem *walkPtr;
+
+    for (walkPtr = itemPtr->parentPtr; walkPtr != NULL;
+	    walkPtr = walkPtr->parentPtr) {
+	TkPathCanvasSetGroupDirtyCache(walkPtr);
     }
+    if (itemPtr->typePtr == &tkGroupType) {
+	canvasPtr->styleGeneration++;
+	if (canvasPtr->styleGeneration == 0) {
+	    canvasPtr->styleGeneration = 1;
+	}
+    }
+    itemExPtr->styleGen = 0;
 }
 
 /*
@@ -508,39 +567,39 @@ TkPathCanvasFreeInheritedStyle(Tk_PathStyle *stylePtr)
 TMatrix
 TkPathCanvasInheritTMatrix(Tk_PathItem *itemPtr)
 {
-    int depth, i;
-    Tk_PathItem *walkPtr;
-    Tk_PathItemEx *itemExPtr;
-    Tk_PathItemEx **parents;
-    Tk_PathStyle *stylePtr;
-    TMatrix matrix = kPathUnitTMatrix, *matrixPtr = NULL;
+    TMatrix matrix = kPathUnitTMatrix;
 
-    depth = TkPathCanvasGetDepth(itemPtr);
-    parents = (Tk_PathItemEx **) ckalloc(depth*sizeof(Tk_PathItemEx *));
+    InheritTMatrix(itemPtr->parentPtr, &matrix);
+    return matrix;
+}
 
-    walkPtr = itemPtr, i = 0;
-    while (walkPtr->parentPtr != NULL) {
-	parents[i] = (Tk_PathItemEx *) walkPtr->parentPtr;
-	walkPtr = walkPtr->parentPtr, i++;
+static void
+InheritTMatrix(Tk_PathItem *itemPtr, TMatrix *matrixPtr)
+{
+    Tk_PathItemEx *itemExPtr = (Tk_PathItemEx *) itemPtr;
+    Tk_PathStyle *stylePtr;
+    TMatrix *mPtr;
+
+    if (itemPtr == NULL) {
+	return;
     }
 
-    for (i = depth-1; i >= 0; i--) {
-	itemExPtr = parents[i];
+    /*
+     * Concatenate from the root item and down.
+     */
+    InheritTMatrix(itemPtr->parentPtr, matrixPtr);
 
-	/* The order of these two merges decides which take precedence. */
-	matrixPtr = itemExPtr->style.matrixPtr;
-	if (itemExPtr->styleInst != NULL) {
-	    stylePtr = itemExPtr->styleInst->masterPtr;
-	    if (stylePtr->mask & PATH_STYLE_OPTION_MATRIX) {
-		matrixPtr = stylePtr->matrixPtr;
-	    }
-	}
-	if (matrixPtr != NULL) {
-	    MMulTMatrix(matrixPtr, &matrix);
+    /* The order of these two merges decides which take precedence. */
+    mPtr = itemExPtr->style.matrixPtr;
+    if (itemExPtr->styleInst != NULL) {
+	stylePtr = itemExPtr->styleInst->masterPtr;
+	if (stylePtr->mask & PATH_STYLE_OPTION_MATRIX) {
+	    mPtr = stylePtr->matrixPtr;
 	}
     }
-    ckfree((char *) parents);
-    return matrix;
+    if (mPtr != NULL) {
+	MMulTMatrix(mPtr, matrixPtr);
+    }
 }
 
 /* TkPathCanvasGradientTable etc.: this is just accessor functions to hide
@@ -564,12 +623,371 @@ TkPathCanvasState(Tk_PathCanvas canvas)
     return ((TkPathCanvas *)canvas)->canvas_state;
 }
 
+double
+TkPathCanvasTolerance(Tk_PathCanvas canvas)
+{
+    return ((TkPathCanvas *)canvas)->tolerance;
+}
+
+Tcl_HashTable *
+TkPathCanvasPathTable(Tk_PathCanvas canvas)
+{
+    return &((TkPathCanvas *)canvas)->pathTable;
+}
+
 Tk_PathItem *
 TkPathCanvasCurrentItem(Tk_PathCanvas canvas)
 {
     return ((TkPathCanvas *)canvas)->currentItemPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasBeginDraw --
+ *
+ *	Returns a drawing context for an item's display proc. While the
+ *	canvas is redisplaying into 'drawable' all items share one context
+ *	which is created on first use and clipped to the redraw area, and
+ *	each item gets its own saved graphics state within it. Otherwise a
+ *	new context is made. Either way the context flattens curves using
+ *	the canvas -tolerance. With -rendermode image the shared context
+ *	renders into a client side image if the platform supports it.
+ *
+ * Results:
+ *	A TkPathContext which must be released with TkPathCanvasEndDraw.
+ *
+ * Side effects:
+ *	May create the canvas frame context.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TkPathContext
+TkPathCanvasBeginDraw(
+    Tk_PathCanvas canvas,	/* Canvas being drawn. */
+    Drawable drawable)		/* Pixmap or window to draw into. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+
+    TkPathContext context;
+
+    /*
+     * Anything collected so far lies below what is drawn now.
+     */
+
+    TkPathCanvasFlushBatch(canvas);
+    if ((canvasPtr->frameDrawable == None)
+	    || (drawable != canvasPtr->frameDrawable)) {
+	context = TkPathInit(canvasPtr->tkwin, drawable);
+	TkPathSetTolerance(context, canvasPtr->tolerance);
+	return context;
+    }
+    GetFrameContext(canvasPtr);
+    TkPathSaveState(canvasPtr->frameCtx);
+    return canvasPtr->frameCtx;
+}
+
+/*
+ * Creates the frame context of a redisplay if not yet done.
+ */
+
+static void
+GetFrameContext(
+    TkPathCanvas *canvasPtr)
+{
+    Drawable drawable = canvasPtr->frameDrawable;
+
+    if ((canvasPtr->frameCtx == 0)
+	    && (canvasPtr->renderMode == PATH_RENDER_IMAGE)) {
+	canvasPtr->frameCtx = TkPathInitImage(canvasPtr->tkwin, drawable,
+		&canvasPtr->frameClip);
+	if (canvasPtr->frameCtx != 0) {
+	    TkPathSetTolerance(canvasPtr->frameCtx, canvasPtr->tolerance);
+	}
+    }
+    if (canvasPtr->frameCtx == 0) {
+	canvasPtr->frameCtx = TkPathInit(canvasPtr->tkwin, drawable);
+	TkPathSetTolerance(canvasPtr->frameCtx, canvasPtr->tolerance);
+	TkPathClipToRect(canvasPtr->frameCtx, &canvasPtr->frameClip);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasEndDraw --
+ *
+ *	Releases a context obtained from TkPathCanvasBeginDraw.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The frame context gets its graphics state restored; any other
+ *	context is freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasEndDraw(
+    Tk_PathCanvas canvas,	/* Canvas being drawn. */
+    TkPathContext context)	/* Context from TkPathCanvasBeginDraw. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+
+    if (context == canvasPtr->frameCtx) {
+	TkPathRestoreState(context);
+    } else {
+	TkPathFree(context);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasBeginBatch --
+ *
+ *	Used instead of TkPathCanvasBeginDraw by path items that only fill
+ *	and stroke a path. If the item can be painted together with the
+ *	items collected before it, or start a new collection, the frame
+ *	context is returned for the caller to add its path to, but without
+ *	painting it. This is the case if the style is solid, without dash
+ *	or gradient, and the item doesn't share any pixel with the items
+ *	collected so far, so that painting them all at once gives the same
+ *	result as painting them one by one.
+ *
+ * Results:
+ *	The context to make the path in, which must be released with
+ *	TkPathCanvasEndBatch, or 0 if the item must be drawn as usual.
+ *
+ * Side effects:
+ *	Collected items may be painted.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TkPathContext
+TkPathCanvasBeginBatch(
+    Tk_PathCanvas canvas,	/* Canvas being drawn. */
+    Drawable drawable,		/* Pixmap or window to draw into. */
+    Tk_PathStyle *stylePtr,	/* Style to paint the path with. */
+    TMatrix *mPtr,		/* Canvas offsets, or NULL. */
+    PathRect *bboxPtr)		/* Bare bbox of the path. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    TkPathBatch *batchPtr = &canvasPtr->batch;
+    TMatrix matrix = kPathUnitTMatrix;
+    PathRect area;
+    double x[4], y[4], margin, scale;
+    int i;
+
+    if ((canvasPtr->frameDrawable == None)
+	    || (drawable != canvasPtr->frameDrawable)
+	    || ((stylePtr->fill != NULL)
+		&& (stylePtr->fill->gradientInstPtr != NULL))
+	    || ((stylePtr->dashPtr != NULL) && (stylePtr->dashPtr->number != 0))
+	    || ((GetColorFromPathColor(stylePtr->fill) == NULL)
+		&& (stylePtr->strokeColor == NULL))) {
+	return 0;
+    }
+
+    /*
+     * Find the area the item may paint, in drawable coordinates, with
+     * some room for miters, caps and antialiasing.
+     */
+
+    if (mPtr != NULL) {
+	matrix = *mPtr;
+    }
+    MMulTMatrix(stylePtr->matrixPtr, &matrix);
+    x[0] = x[3] = bboxPtr->x1;
+    x[1] = x[2] = bboxPtr->x2;
+    y[0] = y[1] = bboxPtr->y1;
+    y[2] = y[3] = bboxPtr->y2;
+    area = NewEmptyPathRect();
+    for (i = 0; i < 4; i++) {
+	PathApplyTMatrix(&matrix, &x[i], &y[i]);
+	IncludePointInRect(&area, x[i], y[i]);
+    }
+    margin = 1.0;
+    if (stylePtr->strokeColor != NULL) {
+	scale = MAX(fabs(matrix.a) + fabs(matrix.c),
+		fabs(matrix.b) + fabs(matrix.d));
+	margin += 0.5 * stylePtr->strokeWidth * scale
+		* MAX(stylePtr->miterLimit, 1.5);
+    }
+    area.x1 = floor(area.x1 - margin);
+    area.y1 = floor(area.y1 - margin);
+    area.x2 = ceil(area.x2 + margin);
+    area.y2 = ceil(area.y2 + margin);
+
+    if (batchPtr->ctx != 0) {
+	if ((batchPtr->numItems < PATH_MAX_BATCH)
+		&& (batchPtr->ctx == canvasPtr->frameCtx)
+		&& SameBatchStyle(&batchPtr->style, &batchPtr->matrix,
+		    stylePtr, &matrix)) {
+	    for (i = 0; i < batchPtr->numItems; i++) {
+		if ((area.x1 < batchPtr->areas[i].x2)
+			&& (area.x2 > batchPtr->areas[i].x1)
+			&& (area.y1 < batchPtr->areas[i].y2)
+			&& (area.y2 > batchPtr->areas[i].y1)) {
+		    break;
+		}
+	    }
+	    if (i == batchPtr->numItems) {
+		batchPtr->areas[batchPtr->numItems++] = area;
+		TkPathSaveState(batchPtr->ctx);
+		return batchPtr->ctx;
+	    }
+	}
+	TkPathCanvasFlushBatch(canvas);
+    }
+    GetFrameContext(canvasPtr);
+    if (!TkPathKeepPath(canvasPtr->frameCtx, 1)) {
+	return 0;
+    }
+    batchPtr->ctx = canvasPtr->frameCtx;
+    batchPtr->style = *stylePtr;
+    batchPtr->style.matrixPtr = NULL;
+    batchPtr->style.dashPtr = NULL;
+    batchPtr->style.fillObj = NULL;
+    batchPtr->style.instancePtr = NULL;
+    batchPtr->style.fill = NULL;
+    if (GetColorFromPathColor(stylePtr->fill) != NULL) {
+	batchPtr->fillColor = *stylePtr->fill->color;
+	batchPtr->fill.color = &batchPtr->fillColor;
+	batchPtr->fill.gradientInstPtr = NULL;
+	batchPtr->style.fill = &batchPtr->fill;
+    }
+    if (stylePtr->strokeColor != NULL) {
+	batchPtr->strokeColor = *stylePtr->strokeColor;
+	batchPtr->style.strokeColor = &batchPtr->strokeColor;
+    }
+    batchPtr->matrix = matrix;
+    batchPtr->areas[0] = area;
+    batchPtr->numItems = 1;
+    TkPathSaveState(batchPtr->ctx);
+    return batchPtr->ctx;
+}
+
+/*
+ * Two styles can be painted together if they give the same fill and, when
+ * stroking, the same stroke with the same matrix.
+ */
+
+static int
+SameBatchStyle(
+    Tk_PathStyle *style1Ptr,
+    TMatrix *m1Ptr,
+    Tk_PathStyle *style2Ptr,
+    TMatrix *m2Ptr)
+{
+    XColor *fill1 = GetColorFromPathColor(style1Ptr->fill);
+    XColor *fill2 = GetColorFromPathColor(style2Ptr->fill);
+    XColor *stroke1 = style1Ptr->strokeColor;
+    XColor *stroke2 = style2Ptr->strokeColor;
+
+    if ((fill1 == NULL) != (fill2 == NULL)) {
+	return 0;
+    }
+    if ((fill1 != NULL) && ((fill1->red != fill2->red)
+	    || (fill1->green != fill2->green) || (fill1->blue != fill2->blue)
+	    || (style1Ptr->fillOpacity != style2Ptr->fillOpacity)
+	    || (style1Ptr->fillRule != style2Ptr->fillRule))) {
+	return 0;
+    }
+    if ((stroke1 == NULL) != (stroke2 == NULL)) {
+	return 0;
+    }
+    if ((stroke1 != NULL) && ((stroke1->red != stroke2->red)
+	    || (stroke1->green != stroke2->green)
+	    || (stroke1->blue != stroke2->blue)
+	    || (style1Ptr->strokeOpacity != style2Ptr->strokeOpacity)
+	    || (style1Ptr->strokeWidth != style2Ptr->strokeWidth)
+	    || (style1Ptr->capStyle != style2Ptr->capStyle)
+	    || (style1Ptr->joinStyle != style2Ptr->joinStyle)
+	    || (style1Ptr->miterLimit != style2Ptr->miterLimit)
+	    || (m1Ptr->a != m2Ptr->a) || (m1Ptr->b != m2Ptr->b)
+	    || (m1Ptr->c != m2Ptr->c) || (m1Ptr->d != m2Ptr->d)
+	    || (m1Ptr->tx != m2Ptr->tx) || (m1Ptr->ty != m2Ptr->ty))) {
+	return 0;
+    }
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasEndBatch --
+ *
+ *	Releases a context obtained from TkPathCanvasBeginBatch. The path
+ *	made in it stays there until TkPathCanvasFlushBatch.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The graphics state of the context is restored.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasEndBatch(
+    Tk_PathCanvas canvas,	/* Canvas being drawn. */
+    TkPathContext context)	/* Context from TkPathCanvasBeginBatch. */
+{
+    TkPathRestoreState(context);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathCanvasFlushBatch --
+ *
+ *	Paints the items collected by TkPathCanvasBeginBatch. Must be
+ *	called before anything else is drawn into the drawable and before
+ *	the frame context is freed or replaced.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Drawing.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathCanvasFlushBatch(
+    Tk_PathCanvas canvas)	/* Canvas being drawn. */
+{
+    TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+    TkPathBatch *batchPtr = &canvasPtr->batch;
+    TkPathContext context = batchPtr->ctx;
+    Tk_PathStyle *stylePtr = &batchPtr->style;
+
+    if (context == 0) {
+	return;
+    }
+    batchPtr->ctx = 0;
+    batchPtr->numItems = 0;
+    TkPathKeepPath(context, 0);
+    TkPathSaveState(context);
+    TkPathPushTMatrix(context, &batchPtr->matrix);
+    if ((GetColorFromPathColor(stylePtr->fill) != NULL)
+	    && (stylePtr->strokeColor != NULL)) {
+	TkPathFillAndStroke(context, stylePtr);
+    } else if (GetColorFromPathColor(stylePtr->fill) != NULL) {
+	TkPathFill(context, stylePtr);
+    } else {
+	TkPathStroke(context, stylePtr);
+    }
+    TkPathRestoreState(context);
+}
+
 #ifdef NOWHERE_USED
 Tk_PathItem *
 TkPathCanvasParentItem(Tk_PathItem *itemPtr)
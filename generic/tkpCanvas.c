@@ -21,6 +21,12 @@
 #define TK_PATH_NO_DOUBLE_BUFFERING
 #endif
 
+/* The snapshot test hook reports photo allocation failures. */
+#if defined(TKPATH_TEST) && defined(USE_PANIC_ON_PHOTO_ALLOC_FAILURE)
+#undef USE_PANIC_ON_PHOTO_ALLOC_FAILURE
+#endif
+
+#include <float.h>
 #include "default.h"
 #include "tkInt.h"
 #include "tkIntPath.h"
@@ -90,6 +96,15 @@ typedef struct TagSearch {
     unsigned int rewritebufferAllocated;
 				/* Available space for rewrites. */
     TagSearchExpr *expr;	/* Compiled tag expression. */
+    int useIds;			/* Non-zero means a simple tag search visits
+				 * the items in ids rather than the display
+				 * list. */
+    int *ids;			/* Ids of the items having the tag, in
+				 * stacking order, from the canvas
+				 * tagTable. */
+    int numIds;			/* Number of ids. */
+    int idSpace;		/* Allocated size of ids. */
+    int idIndex;		/* Next position in ids. */
 } TagSearch;
 
 /*
@@ -103,6 +118,28 @@ typedef struct TagSearch {
 #define SEARCH_TYPE_EXPR	4	/* Compound search */
 #define SEARCH_TYPE_ROOT	5	/* Looking for the root item */
 
+/*
+ * An entry in the canvas exprCache. Widget commands given the same tag
+ * expression again copy the compiled uids from here instead of parsing
+ * the expression.
+ */
+
+typedef struct TagExprCacheEntry {
+    Tk_Uid *uids;		/* Compiled expression. */
+    int length;			/* Number of uids. */
+    Tcl_HashEntry *hPtr;	/* Entry in exprCache. */
+    struct TagExprCacheEntry *prevPtr;
+				/* More recently used entry. */
+    struct TagExprCacheEntry *nextPtr;
+				/* Less recently used entry. */
+} TagExprCacheEntry;
+
+/*
+ * Maximum number of compiled expressions kept per canvas.
+ */
+
+#define TAG_EXPR_CACHE_SIZE	64
+
 #endif /* USE_OLD_TAG_SEARCH */
 
 #define PATH_DEF_STATE "normal"
@@ -117,6 +154,10 @@ static const char *tagStyleStrings[] = {
     "exact", "expr", "glob", NULL
 };
 
+static const char *renderModeStrings[] = {
+    "native", "image", NULL
+};
+
 static Tk_ObjCustomOption offsetCO = {
     "offset",
     TkPathOffsetOptionSetProc,
@@ -182,6 +223,9 @@ static Tk_OptionSpec optionSpecs[] = {
     {TK_OPTION_RELIEF, "-relief", "relief", "Relief",
 	DEF_CANVAS_RELIEF, -1, offsetof(TkPathCanvas, relief),
 	0, 0, 0},
+    {TK_OPTION_STRING_TABLE, "-rendermode", "renderMode", "RenderMode",
+	"native", -1, offsetof(TkPathCanvas, renderMode),
+	0, (ClientData) renderModeStrings, 0},
     {TK_OPTION_STRING, "-scrollregion", "scrollRegion", "ScrollRegion",
 	DEF_CANVAS_SCROLL_REGION, -1, offsetof(TkPathCanvas, regionString),
 	TK_OPTION_NULL_OK, 0, 0},
@@ -201,6 +245,9 @@ static Tk_OptionSpec optionSpecs[] = {
     {TK_OPTION_STRING_TABLE, "-tagstyle", NULL, NULL,
         "expr", -1, offsetof(TkPathCanvas, tagStyle),
         0, (ClientData) tagStyleStrings, 0},
+    {TK_OPTION_DOUBLE, "-tolerance", "tolerance", "Tolerance",
+	"0.1", -1, offsetof(TkPathCanvas, tolerance),
+	0, 0, 0},
     {TK_OPTION_STRING, "-takefocus", "takeFocus", "TakeFocus",
 	DEF_CANVAS_TAKE_FOCUS, -1, offsetof(TkPathCanvas, takeFocus),
 	TK_OPTION_NULL_OK, 0, 0},
@@ -271,6 +318,8 @@ static void		CanvasEventProc(ClientData clientData,
 			    XEvent *eventPtr);
 static Tcl_Size		CanvasFetchSelection(ClientData clientData, Tcl_Size offset,
 			    char *buffer, Tcl_Size maxBytes);
+static Tk_PathItem *	FindClosestItem(TkPathCanvas *canvasPtr,
+			    double coords[2], double halo);
 static Tk_PathItem *	CanvasFindClosest(TkPathCanvas *canvasPtr,
 			    double coords[2]);
 static void		CanvasFocusProc(TkPathCanvas *canvasPtr, int gotFocus);
@@ -290,10 +339,21 @@ static int		ConfigureCanvas(Tcl_Interp *interp,
 			    Tcl_Obj *const *objv, int flags);
 static void		DestroyCanvas(char *memPtr);
 static void		DisplayCanvas(ClientData clientData);
-static void		DoItem(Tcl_Interp *interp,
+static Pixmap		GetBackBuffer(TkPathCanvas *canvasPtr);
+static void		FreeFrameContext(TkPathCanvas *canvasPtr);
+static void		DoItem(TkPathCanvas *canvasPtr, Tcl_Interp *interp,
 			    Tk_PathItem *itemPtr, Tk_Uid tag);
+static void		AddDamage(TkPathCanvas *canvasPtr,
+			    int x1, int y1, int x2, int y2);
+static void		AddRedrawBox(TkPathCanvas *canvasPtr,
+			    int x1, int y1, int x2, int y2);
+static void		ScrollWindowContents(TkPathCanvas *canvasPtr);
+static void		RedrawItemBbox(Tk_PathCanvas canvas,
+			    Tk_PathItem *itemPtr);
 static void		EventuallyRedrawItem(Tk_PathCanvas canvas,
 			    Tk_PathItem *itemPtr);
+static void		SetForceRedraw(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr);
 static void		EventuallyRedrawItemAndChildren(Tk_PathCanvas canvas,
 			    Tk_PathItem *itemPtr);
 
@@ -307,9 +367,27 @@ static int		ItemCreate(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
 				Tk_PathItemType *typePtr, int isRoot, Tk_PathItem **itemPtrPtr,
 				int objc, Tcl_Obj *const objv[]);
 static int		ItemGetNumTags(Tk_PathItem *itemPtr);
-static void		SetAncestorsDirtyBbox(Tk_PathItem *itemPtr);
+static int		ItemHasTag(Tk_PathItem *itemPtr, Tk_Uid tag);
+static void		TagIndexAdd(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr, Tk_Uid tag);
+static void		TagIndexAddItem(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr);
+static void		TagIndexRemove(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr, Tk_Uid tag);
+static void		TagIndexRemoveItem(TkPathCanvas *canvasPtr,
+			    Tk_PathItem *itemPtr);
+static void		TagIndexFree(TkPathCanvas *canvasPtr);
+static void		SetAncestorsDirtyBbox(Tk_PathItem *itemPtr,
+			    int dirtyCache);
 
 static void		DebugGetItemInfo(Tk_PathItem *itemPtr, char *s);
+#ifdef TKPATH_TEST
+static int		CanvasSnapshot(Tcl_Interp *interp,
+			    TkPathCanvas *canvasPtr, Tk_PhotoHandle photo);
+static int		SnapshotShift(unsigned long mask, int *bitsPtr);
+static int		SnapshotChannel(unsigned long pixel,
+			    unsigned long mask, int shift, int bits);
+#endif
 
 #ifdef USE_OLD_TAG_SEARCH
 static int		FindItems(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
@@ -343,6 +421,17 @@ static int		RelinkItems(TkPathCanvas *canvasPtr, Tcl_Obj *tag,
 static void 		TagSearchExprInit(TagSearchExpr **exprPtrPtr);
 static void		TagSearchExprDestroy(TagSearchExpr *expr);
 static void		TagSearchDestroy(TagSearch *searchPtr);
+static int		TagExprCacheGet(TkPathCanvas *canvasPtr,
+			    TagSearchExpr *expr);
+static void		TagExprCachePut(TkPathCanvas *canvasPtr,
+			    TagSearchExpr *expr);
+static void		TagExprCacheFree(TkPathCanvas *canvasPtr);
+static void		TagExprCacheLinkFirst(TkPathCanvas *canvasPtr,
+			    TagExprCacheEntry *entryPtr);
+static void		TagExprCacheUnlink(TkPathCanvas *canvasPtr,
+			    TagExprCacheEntry *entryPtr);
+static int		TagSearchCollect(TagSearch *searchPtr, Tk_Uid uid);
+static Tk_PathItem *	TagSearchNextId(TagSearch *searchPtr);
 static int		TagSearchScan(TkPathCanvas *canvasPtr,
 			    Tcl_Obj *tag, TagSearch **searchPtrPtr);
 static int		TagSearchScanExpr(Tcl_Interp *interp,
@@ -470,9 +559,11 @@ Tk_PathCanvasObjCmd(
     canvasPtr->highlightColorPtr = NULL;
     canvasPtr->inset = 0;
     canvasPtr->pixmapGC = NULL;
+    canvasPtr->scrollGC = NULL;
     canvasPtr->width = (Tcl_Size) NULL;
     canvasPtr->height = (Tcl_Size) NULL;
     canvasPtr->confine = 0;
+    canvasPtr->numDamage = 0;
     canvasPtr->textInfo.selBorder = NULL;
     canvasPtr->textInfo.selBorderWidth = 0;
     canvasPtr->textInfo.selFgColorPtr = NULL;
@@ -496,6 +587,7 @@ Tk_PathCanvasObjCmd(
     canvasPtr->currentItemPtr = NULL;
     canvasPtr->newCurrentPtr = NULL;
     canvasPtr->closeEnough = 0.0;
+    canvasPtr->tolerance = kPathDefaultTolerance;
     canvasPtr->pickEvent.type = LeaveNotify;
     canvasPtr->pickEvent.xcrossing.x = 0;
     canvasPtr->pickEvent.xcrossing.y = 0;
@@ -542,7 +634,25 @@ Tk_PathCanvasObjCmd(
     canvasPtr->gradientUid = 0;
 #ifndef USE_OLD_TAG_SEARCH
     canvasPtr->bindTagExprs = NULL;
+    Tcl_InitHashTable(&canvasPtr->exprCache, TCL_ONE_WORD_KEYS);
+    canvasPtr->exprCacheHead = NULL;
+    canvasPtr->exprCacheTail = NULL;
+#endif
+    canvasPtr->frameDrawable = None;
+    canvasPtr->frameCtx = 0;
+    canvasPtr->batch.ctx = 0;
+    canvasPtr->batch.numItems = 0;
+    canvasPtr->backBuffer = None;
+    canvasPtr->backWidth = canvasPtr->backHeight = 0;
+    canvasPtr->renderMode = PATH_RENDER_NATIVE;
+#ifdef TKPATH_TEST
+    canvasPtr->numCacheRenders = 0;
 #endif
+    canvasPtr->itemIndexPtr = TkPathCanvasIndexCreate();
+    Tcl_InitHashTable(&canvasPtr->forcedTable, TCL_ONE_WORD_KEYS);
+    Tcl_InitHashTable(&canvasPtr->tagTable, TCL_ONE_WORD_KEYS);
+    Tcl_InitHashTable(&canvasPtr->pathTable, TCL_STRING_KEYS);
+    canvasPtr->styleGeneration = 1;
 
     Tcl_InitHashTable(&canvasPtr->idTable, TCL_ONE_WORD_KEYS);
     Tcl_InitHashTable(&canvasPtr->styleTable, TCL_STRING_KEYS);
@@ -577,6 +687,7 @@ Tk_PathCanvasObjCmd(
     ItemCreate(interp, canvasPtr, &tkGroupType, 1, &rootItemPtr, 0, NULL);
     rootItemPtr->pathTagsPtr = TkPathAllocTagsFromObj(NULL,
 	    Tcl_NewStringObj("root", -1));
+    TagIndexAddItem(canvasPtr, rootItemPtr);
     canvasPtr->rootItemPtr = rootItemPtr;
 
     Tcl_SetResult(interp, Tk_PathName(canvasPtr->tkwin), TCL_STATIC);
@@ -640,6 +751,9 @@ CanvasWidgetCmd(
 	"types",	"xview",	"yview",
 #if 1
 	"debugtree",
+#endif
+#ifdef TKPATH_TEST
+	"cacherenders",	"pathtable",	"snapshot",
 #endif
 	NULL
     };
@@ -658,6 +772,9 @@ CanvasWidgetCmd(
 	CANV_TYPES,	 CANV_XVIEW,	    CANV_YVIEW,
 #if 1
 	CANV_DEBUGTREE,
+#endif
+#ifdef TKPATH_TEST
+	CANV_CACHERENDERS, CANV_PATHTABLE,  CANV_SNAPSHOT,
 #endif
     };
 
@@ -1192,11 +1309,68 @@ CanvasWidgetCmd(
 		Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
 			x1, y1, x2, y2);
 		EventuallyRedrawItem((Tk_PathCanvas) canvasPtr, itemPtr);
+	    } else {
+		TkPathCanvasIndexUpdate(canvasPtr, itemPtr);
 	    }
 	    itemPtr->redraw_flags &= ~TK_ITEM_DONT_REDRAW;
 	}
 	break;
     }
+#ifdef TKPATH_TEST
+    case CANV_CACHERENDERS:
+	if (objc != 2) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "");
+	    result = TCL_ERROR;
+	    goto done;
+	}
+	Tcl_SetObjResult(interp, Tcl_NewIntObj(canvasPtr->numCacheRenders));
+	break;
+    case CANV_PATHTABLE: {
+	Tcl_Obj *resultObj;
+	Tcl_HashEntry *hPtr;
+	Tcl_HashSearch search;
+	TkPathSharedData *sharedPtr;
+
+	/*
+	 * The interned paths and how many Tcl_Obj's and items use each.
+	 */
+
+	if (objc != 2) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "");
+	    result = TCL_ERROR;
+	    goto done;
+	}
+	resultObj = Tcl_NewListObj(0, NULL);
+	for (hPtr = Tcl_FirstHashEntry(&canvasPtr->pathTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    sharedPtr = (TkPathSharedData *) Tcl_GetHashValue(hPtr);
+	    Tcl_ListObjAppendElement(interp, resultObj, Tcl_NewStringObj(
+		    (char *) Tcl_GetHashKey(&canvasPtr->pathTable, hPtr), -1));
+	    Tcl_ListObjAppendElement(interp, resultObj,
+		    Tcl_NewWideIntObj((Tcl_WideInt) sharedPtr->refCount));
+	}
+	Tcl_SetObjResult(interp, resultObj);
+	break;
+    }
+    case CANV_SNAPSHOT: {
+	Tk_PhotoHandle photo;
+
+	if (objc != 3) {
+	    Tcl_WrongNumArgs(interp, 2, objv, "photo");
+	    result = TCL_ERROR;
+	    goto done;
+	}
+	photo = Tk_FindPhoto(interp, Tcl_GetString(objv[2]));
+	if (photo == NULL) {
+	    Tcl_AppendResult(interp, "image \"", Tcl_GetString(objv[2]),
+		    "\" doesn't exist or is not a photo image", NULL);
+	    result = TCL_ERROR;
+	    goto done;
+	}
+	result = CanvasSnapshot(interp, canvasPtr, photo);
+	break;
+    }
+#endif
     case CANV_DEBUGTREE: {
 	Tk_PathItem *walkPtr, *tmpPtr;
 	char tmp[512], info[256];
@@ -1320,6 +1494,7 @@ CanvasWidgetCmd(
 		    }
 		}
 	    }
+	    TagIndexRemove(canvasPtr, itemPtr, tag);
 	}
 	break;
     }
@@ -1520,6 +1695,8 @@ CanvasWidgetCmd(
 		Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
 			x1, y1, x2, y2);
 		EventuallyRedrawItem((Tk_PathCanvas) canvasPtr, itemPtr);
+	    } else {
+		TkPathCanvasIndexUpdate(canvasPtr, itemPtr);
 	    }
 	    itemPtr->redraw_flags &= ~TK_ITEM_DONT_REDRAW;
 	}
@@ -1566,6 +1743,7 @@ CanvasWidgetCmd(
 		result = (*itemPtr->typePtr->configProc)(interp,
 			(Tk_PathCanvas) canvasPtr, itemPtr, objc-3, objv+3,
 			TK_CONFIG_ARGV_ONLY);
+		TagIndexAddItem(canvasPtr, itemPtr);
 		EventuallyRedrawItem((Tk_PathCanvas) canvasPtr, itemPtr);
 		canvasPtr->flags |= REPICK_NEEDED;
 	    }
@@ -2142,6 +2320,8 @@ DestroyCanvas(
     TagSearchExpr *expr, *next;
 #endif
 
+    TkPathCanvasIndexFree(canvasPtr);
+
     /*
      * Free up all of the items in the canvas.
      * NB: We need to traverse the tree from the last item
@@ -2166,6 +2346,9 @@ DestroyCanvas(
      */
 
     Tcl_DeleteHashTable(&canvasPtr->idTable);
+    Tcl_DeleteHashTable(&canvasPtr->forcedTable);
+    TagIndexFree(canvasPtr);
+    TkPathInternTableFree(&canvasPtr->pathTable);
 
     /* @@@ TODO: tkwin = NULL! */
     PathStylesFree(canvasPtr->tkwin, &canvasPtr->styleTable);
@@ -2177,6 +2360,12 @@ DestroyCanvas(
     if (canvasPtr->pixmapGC != NULL) {
 	Tk_FreeGC(canvasPtr->display, canvasPtr->pixmapGC);
     }
+    if (canvasPtr->scrollGC != NULL) {
+	Tk_FreeGC(canvasPtr->display, canvasPtr->scrollGC);
+    }
+    if (canvasPtr->backBuffer != None) {
+	Tk_FreePixmap(canvasPtr->display, canvasPtr->backBuffer);
+    }
 #ifndef USE_OLD_TAG_SEARCH
     expr = canvasPtr->bindTagExprs;
     while (expr) {
@@ -2184,6 +2373,7 @@ DestroyCanvas(
 	TagSearchExprDestroy(expr);
 	expr = next;
     }
+    TagExprCacheFree(canvasPtr);
 #endif /* USE_OLD_TAG_SEARCH */
     Tcl_DeleteTimerHandler(canvasPtr->insertBlinkHandler);
     if (canvasPtr->bindingTable != NULL) {
@@ -2228,6 +2418,7 @@ ConfigureCanvas(
     GC newGC;
     Tk_SavedOptions savedOptions;
     Tcl_Obj *errorResult = NULL;
+    Tk_PathItem *itemPtr;
     int error;
 
     /*
@@ -2313,6 +2504,20 @@ ConfigureCanvas(
 	if (canvasPtr->highlightWidth < 0) {
 	    canvasPtr->highlightWidth = 0;
 	}
+	if (canvasPtr->tolerance < kPathMinTolerance) {
+	    canvasPtr->tolerance = kPathMinTolerance;
+	}
+
+	/*
+	 * The -cache surfaces of groups depend on -tolerance and -state.
+	 */
+
+	for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
+		itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+	    if (itemPtr->typePtr == &tkGroupType) {
+		TkPathCanvasSetGroupDirtyCache(itemPtr);
+	    }
+	}
 	canvasPtr->inset = canvasPtr->borderWidth + canvasPtr->highlightWidth;
 
 	gcValues.function = GXcopy;
@@ -2426,6 +2631,7 @@ PathCanvasWorldChanged(
 	if (result != TCL_OK) {
 	    Tcl_ResetResult(canvasPtr->interp);
 	}
+	TkPathCanvasIndexUpdate(canvasPtr, itemPtr);
     }
     canvasPtr->flags |= REPICK_NEEDED;
     Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
@@ -2434,6 +2640,370 @@ PathCanvasWorldChanged(
 	    canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * GetBackBuffer --
+ *
+ *	Returns the pixmap DisplayCanvas draws into. It has the size of the
+ *	window and is kept between redisplays, so it is only allocated anew
+ *	when the size of the window has changed.
+ *
+ * Results:
+ *	The back buffer of the canvas.
+ *
+ * Side effects:
+ *	May free the old back buffer and allocate a new one.
+ *
+ *--------------------------------------------------------------
+ */
+
+static Pixmap
+GetBackBuffer(
+    TkPathCanvas *canvasPtr)	/* Canvas being redisplayed. */
+{
+    Tk_Window tkwin = canvasPtr->tkwin;
+    int width = Tk_Width(tkwin), height = Tk_Height(tkwin);
+
+    if ((canvasPtr->backBuffer != None)
+	    && (canvasPtr->backWidth == width)
+	    && (canvasPtr->backHeight == height)) {
+	return canvasPtr->backBuffer;
+    }
+    if (canvasPtr->backBuffer != None) {
+	Tk_FreePixmap(Tk_Display(tkwin), canvasPtr->backBuffer);
+    }
+#ifdef PLATFORM_SDL
+    canvasPtr->backBuffer = Tk_GetPixmap(Tk_Display(tkwin),
+	    Tk_WindowId(tkwin), width, height, (unsigned) -32);
+#else
+    canvasPtr->backBuffer = Tk_GetPixmap(Tk_Display(tkwin),
+	    Tk_WindowId(tkwin), width, height, Tk_Depth(tkwin));
+#endif
+    canvasPtr->backWidth = width;
+    canvasPtr->backHeight = height;
+    return canvasPtr->backBuffer;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * FreeFrameContext --
+ *
+ *	Frees the rendering context shared by the items during a redisplay.
+ *	Items collected to be painted at once are painted, and if it
+ *	renders into a client side image (-rendermode image) the image is
+ *	put to the drawable first.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The next path item drawn makes a new frame context.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+FreeFrameContext(
+    TkPathCanvas *canvasPtr)	/* Canvas being redisplayed. */
+{
+    TkPathCanvasFlushBatch((Tk_PathCanvas) canvasPtr);
+    TkPathFlushImage(canvasPtr->frameCtx, NULL);
+    TkPathFree(canvasPtr->frameCtx);
+    canvasPtr->frameCtx = 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * RedrawArea --
+ *
+ *	Redraws one damaged rectangle of the canvas: the part of it that is
+ *	visible is cleared and redrawn in the back buffer and copied to the
+ *	window.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Items overlapping the rectangle get displayed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+RedrawArea(
+    TkPathCanvas *canvasPtr,	/* Canvas being redisplayed. */
+    int x1, int y1,		/* Upper left corner of damaged area, in
+				 * canvas coordinates. */
+    int x2, int y2)		/* Lower right corner of damaged area. */
+{
+    Tk_Window tkwin = canvasPtr->tkwin;
+    Tk_PathItem *itemPtr, *walkPtr;
+    TkPathAreaSearch areaSearch;
+    Pixmap pixmap;
+    int screenX1, screenX2, screenY1, screenY2, width, height;
+    int reload;
+    PathRect itemArea;
+
+    /*
+     * Compute the intersection between the area that needs redrawing and the
+     * area that's visible on the screen.
+     */
+
+    screenX1 = canvasPtr->xOrigin + canvasPtr->inset;
+    screenY1 = canvasPtr->yOrigin + canvasPtr->inset;
+    screenX2 = canvasPtr->xOrigin + Tk_Width(tkwin) - canvasPtr->inset;
+    screenY2 = canvasPtr->yOrigin + Tk_Height(tkwin) - canvasPtr->inset;
+    if (x1 > screenX1) {
+	screenX1 = x1;
+    }
+    if (y1 > screenY1) {
+	screenY1 = y1;
+    }
+    if (x2 < screenX2) {
+	screenX2 = x2;
+    }
+    if (y2 < screenY2) {
+	screenY2 = y2;
+    }
+    if ((screenX1 >= screenX2) || (screenY1 >= screenY2)) {
+	return;
+    }
+
+    width = screenX2 - screenX1;
+    height = screenY2 - screenY1;
+
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+    /*
+     * Redrawing is done in a window sized pixmap that is kept from one
+     * redisplay to the next. Only the damaged area is cleared and redrawn
+     * into it and only that area is copied to the screen at the end of
+     * the function. The pixmap serves two purposes:
+     *
+     * 1. It provides a smoother visual effect (no clearing and gradual
+     *    redraw will be visible to users).
+     * 2. It allows us to redraw only the objects that overlap the redraw
+     *    area. Otherwise incorrect results could occur from redrawing
+     *    things that stick outside of the redraw area (we'd have to
+     *    redraw everything in order to make the overlaps look right).
+     *
+     * Keeping the pixmap saves allocating and freeing one in the X
+     * server for every frame of an animation. Its origin is the one of
+     * the window. Path items are clipped to the damaged area by the
+     * rendering context, but the Tk items draw with plain GCs and may
+     * leave stale pixels around it. That does no harm since only areas
+     * that were just cleared and redrawn are ever copied to the screen.
+     */
+
+    pixmap = GetBackBuffer(canvasPtr);
+    canvasPtr->drawableXOrigin = canvasPtr->xOrigin;
+    canvasPtr->drawableYOrigin = canvasPtr->yOrigin;
+#else
+    canvasPtr->drawableXOrigin = canvasPtr->xOrigin;
+    canvasPtr->drawableYOrigin = canvasPtr->yOrigin;
+    pixmap = Tk_WindowId(tkwin);
+    TkpClipDrawableToRect(Tk_Display(tkwin), pixmap,
+	    screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin,
+	    width, height);
+#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
+
+    /*
+     * Clear the area to be redrawn.
+     */
+
+    XFillRectangle(Tk_Display(tkwin), pixmap, canvasPtr->pixmapGC,
+	    screenX1 - canvasPtr->drawableXOrigin,
+	    screenY1 - canvasPtr->drawableYOrigin, (unsigned int) width,
+	    (unsigned int) height);
+
+    /*
+     * Scan through the item list, redrawing those items that need it. An
+     * item must be redraw if either (a) it intersects the smaller
+     * on-screen area or (b) it intersects the full canvas area and its
+     * type requests that it be redrawn always (e.g. so subwindows can be
+     * unmapped when they move off-screen).
+     *
+     * All path based items share a single rendering context for the
+     * drawable which is created the first time one of them asks for it.
+     * It is clipped to the redraw area so that nothing outside of it
+     * gets rasterized.
+     */
+
+    canvasPtr->frameDrawable = pixmap;
+    canvasPtr->frameClip.x1 = screenX1 - canvasPtr->drawableXOrigin;
+    canvasPtr->frameClip.y1 = screenY1 - canvasPtr->drawableYOrigin;
+    canvasPtr->frameClip.x2 = canvasPtr->frameClip.x1 + width;
+    canvasPtr->frameClip.y2 = canvasPtr->frameClip.y1 + height;
+    for (itemPtr = TkPathCanvasAreaSearchFirst(canvasPtr,
+	    screenX1, screenY1, screenX2, screenY2, &areaSearch);
+	    itemPtr != NULL;
+	    itemPtr = TkPathCanvasAreaSearchNext(&areaSearch)) {
+	/*
+	 * Items below a group with -cache are drawn by the group. Asking
+	 * a group itself also brings its bbox up to date.
+	 */
+
+	for (walkPtr = itemPtr->parentPtr; walkPtr != NULL;
+		walkPtr = walkPtr->parentPtr) {
+	    if (TkPathCanvasGroupCached((Tk_PathCanvas) canvasPtr, walkPtr)) {
+		break;
+	    }
+	}
+	if (walkPtr != NULL) {
+	    continue;
+	}
+	if (itemPtr->typePtr == &tkGroupType) {
+	    TkPathCanvasGroupCached((Tk_PathCanvas) canvasPtr, itemPtr);
+	}
+	if ((itemPtr->x1 >= screenX2)
+		|| (itemPtr->y1 >= screenY2)
+		|| (itemPtr->x2 < screenX1)
+		|| (itemPtr->y2 < screenY1)) {
+	    if (!(itemPtr->typePtr->alwaysRedraw & 1)
+		    || (itemPtr->x1 >= canvasPtr->redrawX2)
+		    || (itemPtr->y1 >= canvasPtr->redrawY2)
+		    || (itemPtr->x2 < canvasPtr->redrawX1)
+		    || (itemPtr->y2 < canvasPtr->redrawY1)) {
+		continue;
+	    }
+	}
+	if (itemPtr->state == TK_PATHSTATE_HIDDEN ||
+	    (itemPtr->state == TK_PATHSTATE_NULL &&
+	     canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
+	    continue;
+	}
+	reload = 0;
+	if ((canvasPtr->frameCtx != 0)
+		&& !(itemPtr->typePtr->alwaysRedraw
+		    & TK_PATH_DRAWS_IN_CONTEXT)) {
+	    /*
+	     * The item draws into the drawable by itself, so what the
+	     * frame context has rendered so far must be there first. A
+	     * client side image is only put where the item draws and read
+	     * back from there afterwards, so that it can be kept.
+	     */
+
+	    TkPathCanvasFlushBatch((Tk_PathCanvas) canvasPtr);
+	    if (canvasPtr->renderMode == PATH_RENDER_IMAGE) {
+		itemArea.x1 = itemPtr->x1 - canvasPtr->drawableXOrigin;
+		itemArea.y1 = itemPtr->y1 - canvasPtr->drawableYOrigin;
+		itemArea.x2 = itemPtr->x2 + 1 - canvasPtr->drawableXOrigin;
+		itemArea.y2 = itemPtr->y2 + 1 - canvasPtr->drawableYOrigin;
+		TkPathFlushImage(canvasPtr->frameCtx, &itemArea);
+		reload = 1;
+	    }
+	}
+	(*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr, itemPtr,
+		canvasPtr->display, pixmap, screenX1, screenY1, width,
+		height);
+	if (reload && !TkPathReloadImage(canvasPtr->frameCtx, &itemArea)) {
+	    /*
+	     * The image still has what was put before the item, so
+	     * putting all of it and drawing the item again is right.
+	     */
+
+	    FreeFrameContext(canvasPtr);
+	    (*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, canvasPtr->display, pixmap, screenX1, screenY1,
+		    width, height);
+	}
+    }
+    TkPathCanvasAreaSearchDone(&areaSearch);
+    if (canvasPtr->frameCtx != 0) {
+	FreeFrameContext(canvasPtr);
+    }
+    canvasPtr->frameDrawable = None;
+
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+    /*
+     * Copy the redrawn area from the back buffer to the screen.
+     */
+
+    XCopyArea(Tk_Display(tkwin), pixmap, Tk_WindowId(tkwin),
+	    canvasPtr->pixmapGC,
+	    screenX1 - canvasPtr->drawableXOrigin,
+	    screenY1 - canvasPtr->drawableYOrigin,
+	    (unsigned int) width, (unsigned int) height,
+	    screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
+#else
+    TkpClipDrawableToRect(Tk_Display(tkwin), pixmap, 0, 0, -1, -1);
+#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * ScrollWindowContents --
+ *
+ *	Scrolls the window contents when the origin of the canvas has
+ *	changed since the last redisplay, so that only the uncovered parts
+ *	need to be redrawn instead of the whole window.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Pixels are copied within the window. The uncovered strips and any
+ *	parts that could not be copied, e.g. since they were obscured, are
+ *	added to the damaged area.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+ScrollWindowContents(
+    TkPathCanvas *canvasPtr)	/* Canvas being redisplayed. */
+{
+    Tk_Window tkwin = canvasPtr->tkwin;
+    int inset = canvasPtr->inset;
+    int dx = canvasPtr->shownXOrigin - canvasPtr->xOrigin;
+    int dy = canvasPtr->shownYOrigin - canvasPtr->yOrigin;
+    int width = Tk_Width(tkwin) - 2*inset;
+    int height = Tk_Height(tkwin) - 2*inset;
+    int x1 = canvasPtr->xOrigin + inset, y1 = canvasPtr->yOrigin + inset;
+    int x2 = x1 + width, y2 = y1 + height;
+    TkRegion damageRgn;
+    XRectangle rect;
+    XGCValues gcValues;
+
+    if (!(canvasPtr->flags & ORIGIN_SHOWN)) {
+	return;
+    }
+    if (((dx == 0) && (dy == 0)) || (width <= 0) || (height <= 0)) {
+	return;
+    }
+    if ((abs(dx) >= width) || (abs(dy) >= height)) {
+	AddDamage(canvasPtr, x1, y1, x2, y2);
+	return;
+    }
+    if (canvasPtr->scrollGC == NULL) {
+	gcValues.graphics_exposures = True;
+	canvasPtr->scrollGC = Tk_GetGC(tkwin, GCGraphicsExposures, &gcValues);
+    }
+    damageRgn = TkCreateRegion();
+    if (TkScrollWindow(tkwin, canvasPtr->scrollGC, inset, inset,
+	    width, height, dx, dy, damageRgn)) {
+	TkClipBox(damageRgn, &rect);
+	AddDamage(canvasPtr, canvasPtr->xOrigin + rect.x,
+		canvasPtr->yOrigin + rect.y,
+		canvasPtr->xOrigin + rect.x + rect.width,
+		canvasPtr->yOrigin + rect.y + rect.height);
+    }
+    TkDestroyRegion(damageRgn);
+    if (dx > 0) {
+	AddDamage(canvasPtr, x1, y1, x1 + dx, y2);
+    } else if (dx < 0) {
+	AddDamage(canvasPtr, x2 + dx, y1, x2, y2);
+    }
+    if (dy > 0) {
+	AddDamage(canvasPtr, x1, y1, x2, y1 + dy);
+    } else if (dy < 0) {
+	AddDamage(canvasPtr, x1, y2 + dy, x2, y2);
+    }
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -2459,14 +3029,13 @@ DisplayCanvas(
     TkPathCanvas *canvasPtr = (TkPathCanvas *) clientData;
     Tk_Window tkwin = canvasPtr->tkwin;
     Tk_PathItem *itemPtr;
-    Pixmap pixmap;
-    int screenX1, screenX2, screenY1, screenY2, width, height;
-    int flags;
+    int i, flags;
 
     if (canvasPtr->flags & CANVAS_DELETED) {
 	return;
     }
     if (!Tk_IsMapped(tkwin)) {
+	canvasPtr->flags &= ~ORIGIN_SHOWN;
 	goto done;
     }
 
@@ -2487,165 +3056,56 @@ DisplayCanvas(
     }
 
     /*
-     * Scan through the item list, registering the bounding box for all items
-     * that didn't do that for the final coordinates yet. This can be
-     * determined by the FORCE_REDRAW flag.
+     * Register the bounding box for all items that didn't do that for the
+     * final coordinates yet. These have the FORCE_REDRAW flag set and are
+     * kept in the forcedTable.
      */
 
-    for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-	    itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
-	if (itemPtr->redraw_flags & FORCE_REDRAW) {
+    if (canvasPtr->forcedTable.numEntries > 0) {
+	Tk_PathItem **forced;
+	Tcl_HashEntry *hPtr;
+	Tcl_HashSearch search;
+	int numForced = 0;
+
+	forced = (Tk_PathItem **) ckalloc((unsigned)
+		(canvasPtr->forcedTable.numEntries * sizeof(Tk_PathItem *)));
+	for (hPtr = Tcl_FirstHashEntry(&canvasPtr->forcedTable, &search);
+		hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	    forced[numForced++] = (Tk_PathItem *) Tcl_GetHashValue(hPtr);
+	}
+	for (i = 0; i < numForced; i++) {
+	    itemPtr = forced[i];
 	    itemPtr->redraw_flags &= ~FORCE_REDRAW;
-	    EventuallyRedrawItem((Tk_PathCanvas)canvasPtr, itemPtr);
+	    SetAncestorsDirtyBbox(itemPtr, 0);
+	    RedrawItemBbox((Tk_PathCanvas)canvasPtr, itemPtr);
 	    itemPtr->redraw_flags &= ~FORCE_REDRAW;
 	}
+	ckfree((char *) forced);
+	Tcl_DeleteHashTable(&canvasPtr->forcedTable);
+	Tcl_InitHashTable(&canvasPtr->forcedTable, TCL_ONE_WORD_KEYS);
     }
 
     /*
-     * Compute the intersection between the area that needs redrawing and the
-     * area that's visible on the screen.
+     * Move what is still valid of the window contents to where it belongs
+     * for the current origin, then redraw each damaged rectangle by
+     * itself, so that changes far apart don't redraw everything between
+     * them.
      */
 
-    if ((canvasPtr->redrawX1 < canvasPtr->redrawX2)
-	    && (canvasPtr->redrawY1 < canvasPtr->redrawY2)) {
-	screenX1 = canvasPtr->xOrigin + canvasPtr->inset;
-	screenY1 = canvasPtr->yOrigin + canvasPtr->inset;
-	screenX2 = canvasPtr->xOrigin + Tk_Width(tkwin) - canvasPtr->inset;
-	screenY2 = canvasPtr->yOrigin + Tk_Height(tkwin) - canvasPtr->inset;
-	if (canvasPtr->redrawX1 > screenX1) {
-	    screenX1 = canvasPtr->redrawX1;
-	}
-	if (canvasPtr->redrawY1 > screenY1) {
-	    screenY1 = canvasPtr->redrawY1;
-	}
-	if (canvasPtr->redrawX2 < screenX2) {
-	    screenX2 = canvasPtr->redrawX2;
-	}
-	if (canvasPtr->redrawY2 < screenY2) {
-	    screenY2 = canvasPtr->redrawY2;
-	}
-	if ((screenX1 >= screenX2) || (screenY1 >= screenY2)) {
-	    goto borders;
-	}
-
-	width = screenX2 - screenX1;
-	height = screenY2 - screenY1;
-
-#ifndef TK_PATH_NO_DOUBLE_BUFFERING
-	/*
-	 * Redrawing is done in a temporary pixmap that is allocated here and
-	 * freed at the end of the function. All drawing is done to the
-	 * pixmap, and the pixmap is copied to the screen at the end of the
-	 * function. The temporary pixmap serves two purposes:
-	 *
-	 * 1. It provides a smoother visual effect (no clearing and gradual
-	 *    redraw will be visible to users).
-	 * 2. It allows us to redraw only the objects that overlap the redraw
-	 *    area. Otherwise incorrect results could occur from redrawing
-	 *    things that stick outside of the redraw area (we'd have to
-	 *    redraw everything in order to make the overlaps look right).
-	 *
-	 * Some tricky points about the pixmap:
-	 *
-	 * 1. We only allocate a large enough pixmap to hold the area that has
-	 *    to be redisplayed. This saves time in in the X server for large
-	 *    objects that cover much more than the area being redisplayed:
-	 *    only the area of the pixmap will actually have to be redrawn.
-	 * 2. Some X servers (e.g. the one for DECstations) have troubles with
-	 *    with characters that overlap an edge of the pixmap (on the DEC
-	 *    servers, as of 8/18/92, such characters are drawn one pixel too
-	 *    far to the right). To handle this problem, make the pixmap a bit
-	 *    larger than is absolutely needed so that for normal-sized fonts
-	 *    the characters that overlap the edge of the pixmap will be
-	 *    outside the area we care about.
-	 */
-
-#ifdef PLATFORM_SDL
-	canvasPtr->drawableXOrigin = screenX1;
-	canvasPtr->drawableYOrigin = screenY1;
-	pixmap = Tk_GetPixmap(Tk_Display(tkwin), Tk_WindowId(tkwin),
-	    width, height, (unsigned) -32);
-#else
-	canvasPtr->drawableXOrigin = screenX1 - 30;
-	canvasPtr->drawableYOrigin = screenY1 - 30;
-	pixmap = Tk_GetPixmap(Tk_Display(tkwin), Tk_WindowId(tkwin),
-	    (screenX2 + 30 - canvasPtr->drawableXOrigin),
-	    (screenY2 + 30 - canvasPtr->drawableYOrigin),
-	    Tk_Depth(tkwin));
-#endif
-#else
-	canvasPtr->drawableXOrigin = canvasPtr->xOrigin;
-	canvasPtr->drawableYOrigin = canvasPtr->yOrigin;
-	pixmap = Tk_WindowId(tkwin);
-	TkpClipDrawableToRect(Tk_Display(tkwin), pixmap,
-		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin,
-		width, height);
-#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
-
-	/*
-	 * Clear the area to be redrawn.
-	 */
-
-	XFillRectangle(Tk_Display(tkwin), pixmap, canvasPtr->pixmapGC,
-		screenX1 - canvasPtr->drawableXOrigin,
-		screenY1 - canvasPtr->drawableYOrigin, (unsigned int) width,
-		(unsigned int) height);
-
-	/*
-	 * Scan through the item list, redrawing those items that need it. An
-	 * item must be redraw if either (a) it intersects the smaller
-	 * on-screen area or (b) it intersects the full canvas area and its
-	 * type requests that it be redrawn always (e.g. so subwindows can be
-	 * unmapped when they move off-screen).
-	 */
-
-	for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-		itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
-	    if ((itemPtr->x1 >= screenX2)
-		    || (itemPtr->y1 >= screenY2)
-		    || (itemPtr->x2 < screenX1)
-		    || (itemPtr->y2 < screenY1)) {
-		if (!(itemPtr->typePtr->alwaysRedraw & 1)
-			|| (itemPtr->x1 >= canvasPtr->redrawX2)
-			|| (itemPtr->y1 >= canvasPtr->redrawY2)
-			|| (itemPtr->x2 < canvasPtr->redrawX1)
-			|| (itemPtr->y2 < canvasPtr->redrawY1)) {
-		    continue;
-		}
-	    }
-	    if (itemPtr->state == TK_PATHSTATE_HIDDEN ||
-		(itemPtr->state == TK_PATHSTATE_NULL &&
-		 canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
-		continue;
-	    }
-	    (*itemPtr->typePtr->displayProc)((Tk_PathCanvas) canvasPtr, itemPtr,
-		    canvasPtr->display, pixmap, screenX1, screenY1, width,
-		    height);
-	}
-
-#ifndef TK_PATH_NO_DOUBLE_BUFFERING
-	/*
-	 * Copy from the temporary pixmap to the screen, then free up the
-	 * temporary pixmap.
-	 */
-
-	XCopyArea(Tk_Display(tkwin), pixmap, Tk_WindowId(tkwin),
-		canvasPtr->pixmapGC,
-		screenX1 - canvasPtr->drawableXOrigin,
-		screenY1 - canvasPtr->drawableYOrigin,
-		(unsigned int) width, (unsigned int) height,
-		screenX1 - canvasPtr->xOrigin, screenY1 - canvasPtr->yOrigin);
-	Tk_FreePixmap(Tk_Display(tkwin), pixmap);
-#else
-	TkpClipDrawableToRect(Tk_Display(tkwin), pixmap, 0, 0, -1, -1);
-#endif /* TK_PATH_NO_DOUBLE_BUFFERING */
+    ScrollWindowContents(canvasPtr);
+    for (i = 0; i < canvasPtr->numDamage; i++) {
+	RedrawArea(canvasPtr, canvasPtr->damage[i].x1,
+		canvasPtr->damage[i].y1, canvasPtr->damage[i].x2,
+		canvasPtr->damage[i].y2);
     }
+    canvasPtr->shownXOrigin = canvasPtr->xOrigin;
+    canvasPtr->shownYOrigin = canvasPtr->yOrigin;
+    canvasPtr->flags |= ORIGIN_SHOWN;
 
     /*
      * Draw the window borders, if needed.
      */
 
-  borders:
     if (canvasPtr->flags & REDRAW_BORDERS) {
 	canvasPtr->flags &= ~REDRAW_BORDERS;
 	if (canvasPtr->borderWidth > 0) {
@@ -2677,6 +3137,7 @@ DisplayCanvas(
     canvasPtr->flags &= ~(REDRAW_PENDING|BBOX_NOT_EMPTY);
     canvasPtr->redrawX1 = canvasPtr->redrawX2 = 0;
     canvasPtr->redrawY1 = canvasPtr->redrawY2 = 0;
+    canvasPtr->numDamage = 0;
     if (canvasPtr->flags & UPDATE_SCROLLBARS) {
 	CanvasUpdateScrollbars(canvasPtr);
     }
@@ -2710,8 +3171,19 @@ CanvasEventProc(
     if (eventPtr->type == Expose) {
 	int x, y;
 
-	x = eventPtr->xexpose.x + canvasPtr->xOrigin;
-	y = eventPtr->xexpose.y + canvasPtr->yOrigin;
+	/*
+	 * The window still shows the items at shownXOrigin, shownYOrigin
+	 * if a scroll is pending; ScrollWindowContents moves the exposed
+	 * pixels along with the rest, so the damage belongs there.
+	 */
+
+	if (canvasPtr->flags & ORIGIN_SHOWN) {
+	    x = eventPtr->xexpose.x + canvasPtr->shownXOrigin;
+	    y = eventPtr->xexpose.y + canvasPtr->shownYOrigin;
+	} else {
+	    x = eventPtr->xexpose.x + canvasPtr->xOrigin;
+	    y = eventPtr->xexpose.y + canvasPtr->yOrigin;
+	}
 	Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr, x, y,
 		x + eventPtr->xexpose.width,
 		y + eventPtr->xexpose.height);
@@ -2848,6 +3320,37 @@ Tk_PathCanvasEventuallyRedraw(
 	    (y1 >= canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin))) {
 	return;
     }
+    AddDamage(canvasPtr, x1, y1, x2, y2);
+    if (!(canvasPtr->flags & REDRAW_PENDING)) {
+	Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
+	canvasPtr->flags |= REDRAW_PENDING;
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * AddRedrawBox --
+ *
+ *	Grows the bounding box of the area to redraw, redrawX1 etc. Items
+ *	that must always be redrawn are displayed if they overlap it, even
+ *	if they are outside of every damaged rectangle.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The redraw bounding box is updated.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+AddRedrawBox(
+    TkPathCanvas *canvasPtr,	/* Canvas to redraw. */
+    int x1, int y1,		/* Upper left corner of area to redraw. */
+    int x2, int y2)		/* Lower right corner of area to redraw. */
+{
     if (canvasPtr->flags & BBOX_NOT_EMPTY) {
 	if (x1 <= canvasPtr->redrawX1) {
 	    canvasPtr->redrawX1 = x1;
@@ -2867,10 +3370,97 @@ Tk_PathCanvasEventuallyRedraw(
 	canvasPtr->redrawX2 = x2;
 	canvasPtr->redrawY2 = y2;
 	canvasPtr->flags |= BBOX_NOT_EMPTY;
+	canvasPtr->numDamage = 0;
     }
-    if (!(canvasPtr->flags & REDRAW_PENDING)) {
-	Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
-	canvasPtr->flags |= REDRAW_PENDING;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * AddDamage --
+ *
+ *	Adds a rectangle to the area of the canvas that must be redrawn.
+ *	The area is kept as a short list of rectangles, so that changes far
+ *	apart are redrawn separately. A rectangle is merged with one it
+ *	overlaps or nearly touches, and when the list is full with the one
+ *	that grows least. The union of all is kept in redrawX1 etc.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The damage list and the redraw bounding box are updated.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+AddDamage(
+    TkPathCanvas *canvasPtr,	/* Canvas to redraw. */
+    int x1, int y1,		/* Upper left corner of area to redraw. */
+    int x2, int y2)		/* Lower right corner of area to redraw. */
+{
+    TkPathDamage *dPtr, *bestPtr;
+    double area, merged, growth, bestGrowth;
+    int i, j;
+
+    AddRedrawBox(canvasPtr, x1, y1, x2, y2);
+
+    /*
+     * Find the rectangle that grows least when the new one is merged into
+     * it. The growth is what gets redrawn in excess of both.
+     */
+
+    bestPtr = NULL;
+    bestGrowth = 0.0;
+    area = (double) (x2 - x1) * (y2 - y1);
+    for (i = 0; i < canvasPtr->numDamage; i++) {
+	dPtr = &canvasPtr->damage[i];
+	merged = (double) (MAX(x2, dPtr->x2) - MIN(x1, dPtr->x1))
+		* (MAX(y2, dPtr->y2) - MIN(y1, dPtr->y1));
+	growth = merged - area
+		- (double) (dPtr->x2 - dPtr->x1) * (dPtr->y2 - dPtr->y1);
+	if ((bestPtr == NULL) || (growth < bestGrowth)) {
+	    bestPtr = dPtr;
+	    bestGrowth = growth;
+	}
+    }
+    if ((bestPtr == NULL) || ((bestGrowth > PATH_DAMAGE_SLACK)
+	    && (canvasPtr->numDamage < PATH_MAX_DAMAGE))) {
+	dPtr = &canvasPtr->damage[canvasPtr->numDamage++];
+	dPtr->x1 = x1;
+	dPtr->y1 = y1;
+	dPtr->x2 = x2;
+	dPtr->y2 = y2;
+	return;
+    }
+
+    /*
+     * Merge, then absorb the rectangles the grown one now overlaps.
+     */
+
+    bestPtr->x1 = MIN(x1, bestPtr->x1);
+    bestPtr->y1 = MIN(y1, bestPtr->y1);
+    bestPtr->x2 = MAX(x2, bestPtr->x2);
+    bestPtr->y2 = MAX(y2, bestPtr->y2);
+    for (j = 0; j < canvasPtr->numDamage; ) {
+	dPtr = &canvasPtr->damage[j];
+	if ((dPtr == bestPtr) || (dPtr->x1 >= bestPtr->x2)
+		|| (dPtr->x2 <= bestPtr->x1) || (dPtr->y1 >= bestPtr->y2)
+		|| (dPtr->y2 <= bestPtr->y1)) {
+	    j++;
+	    continue;
+	}
+	bestPtr->x1 = MIN(dPtr->x1, bestPtr->x1);
+	bestPtr->y1 = MIN(dPtr->y1, bestPtr->y1);
+	bestPtr->x2 = MAX(dPtr->x2, bestPtr->x2);
+	bestPtr->y2 = MAX(dPtr->y2, bestPtr->y2);
+	canvasPtr->numDamage--;
+	if (bestPtr == &canvasPtr->damage[canvasPtr->numDamage]) {
+	    bestPtr = dPtr;
+	}
+	*dPtr = canvasPtr->damage[canvasPtr->numDamage];
+	j = 0;
     }
 }
 
@@ -2895,8 +3485,48 @@ static void
 EventuallyRedrawItem(
     Tk_PathCanvas canvas,		/* Information about widget. */
     Tk_PathItem *itemPtr)		/* Item to be redrawn. */
+{
+    /*
+     * Whatever the item is redrawn for may change its pixels, so the
+     * -cache surfaces of the groups above it are stale.
+     */
+
+    SetAncestorsDirtyBbox(itemPtr, 1);
+    RedrawItemBbox(canvas, itemPtr);
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * RedrawItemBbox --
+ *
+ *	The part of EventuallyRedrawItem that registers the current bbox
+ *	of the item for redisplay. DisplayCanvas calls it alone for items
+ *	that only need their final bbox registered, which must not throw
+ *	away any group caches.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The screen will eventually be refreshed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+RedrawItemBbox(
+    Tk_PathCanvas canvas,		/* Information about widget. */
+    Tk_PathItem *itemPtr)		/* Item to be redrawn. */
 {
     TkPathCanvas *canvasPtr = (TkPathCanvas *) canvas;
+
+    /*
+     * Items are redrawn whenever their bbox changes, so this is where
+     * the spatial index is kept up to date.
+     */
+
+    TkPathCanvasIndexUpdate(canvasPtr, itemPtr);
     if ((itemPtr->x1 >= itemPtr->x2) || (itemPtr->y1 >= itemPtr->y2) ||
  	    (itemPtr->x2 < canvasPtr->xOrigin) ||
 	    (itemPtr->y2 < canvasPtr->yOrigin) ||
@@ -2907,35 +3537,47 @@ EventuallyRedrawItem(
 	}
     }
     if (!(itemPtr->redraw_flags & FORCE_REDRAW)) {
-	if (canvasPtr->flags & BBOX_NOT_EMPTY) {
-	    if (itemPtr->x1 <= canvasPtr->redrawX1) {
-		canvasPtr->redrawX1 = itemPtr->x1;
-	    }
-	    if (itemPtr->y1 <= canvasPtr->redrawY1) {
-		canvasPtr->redrawY1 = itemPtr->y1;
-	    }
-	    if (itemPtr->x2 >= canvasPtr->redrawX2) {
-		canvasPtr->redrawX2 = itemPtr->x2;
-	    }
-	    if (itemPtr->y2 >= canvasPtr->redrawY2) {
-		canvasPtr->redrawY2 = itemPtr->y2;
-	    }
-	} else {
-	    canvasPtr->redrawX1 = itemPtr->x1;
-	    canvasPtr->redrawY1 = itemPtr->y1;
-	    canvasPtr->redrawX2 = itemPtr->x2;
-	    canvasPtr->redrawY2 = itemPtr->y2;
-	    canvasPtr->flags |= BBOX_NOT_EMPTY;
-	}
-	itemPtr->redraw_flags |= FORCE_REDRAW;
+	AddDamage(canvasPtr, itemPtr->x1, itemPtr->y1, itemPtr->x2,
+		itemPtr->y2);
+	SetForceRedraw(canvasPtr, itemPtr);
     }
-    SetAncestorsDirtyBbox(itemPtr);
     if (!(canvasPtr->flags & REDRAW_PENDING)) {
 	Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
 	canvasPtr->flags |= REDRAW_PENDING;
     }
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * SetForceRedraw --
+ *
+ *	Sets the FORCE_REDRAW flag of an item and records it in the
+ *	canvas's forcedTable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The item's bbox is registered again by the next DisplayCanvas.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+SetForceRedraw(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_PathItem *itemPtr)	/* Item to flag. */
+{
+    Tcl_HashEntry *hPtr;
+    int isNew;
+
+    itemPtr->redraw_flags |= FORCE_REDRAW;
+    hPtr = Tcl_CreateHashEntry(&canvasPtr->forcedTable, (char *) itemPtr,
+	    &isNew);
+    Tcl_SetHashValue(hPtr, itemPtr);
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -3236,7 +3878,8 @@ CanvasScaleGroup(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
  *
  *	Used by items when they need a redisplay for some reason
  *	so that its ancestor groups know that they need to compute
- *	a new bbox when requested.
+ *	a new bbox when requested. With dirtyCache they also render
+ *	their -cache surface again.
  *
  * Results:
  *	None.
@@ -3248,13 +3891,17 @@ CanvasScaleGroup(Tk_PathCanvas canvas, Tk_PathItem *itemPtr, int compensate,
  */
 
 static void
-SetAncestorsDirtyBbox(Tk_PathItem *itemPtr)
+SetAncestorsDirtyBbox(Tk_PathItem *itemPtr, int dirtyCache)
 {
     Tk_PathItem *walkPtr;
 
     walkPtr = itemPtr->parentPtr;
     while (walkPtr != NULL) {
-	TkPathCanvasSetGroupDirtyBbox(walkPtr);
+	if (dirtyCache) {
+	    TkPathCanvasSetGroupDirtyCache(walkPtr);
+	} else {
+	    TkPathCanvasSetGroupDirtyBbox(walkPtr);
+	}
 	walkPtr = walkPtr->parentPtr;
     }
 }
@@ -3397,6 +4044,7 @@ ItemCreate(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
     itemPtr->prevPtr = NULL;
     itemPtr->firstChildPtr = NULL;
     itemPtr->lastChildPtr = NULL;
+    itemPtr->reserved1 = NULL;
 
     /*
      * This is just to be able to detect if createProc processes
@@ -3425,7 +4073,9 @@ ItemCreate(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
     if (!isRoot && (itemPtr->parentPtr == NULL)) {
 	ItemAddToParent(canvasPtr->rootItemPtr, itemPtr);
     }
-    itemPtr->redraw_flags |= FORCE_REDRAW;
+    TkPathCanvasIndexUpdate(canvasPtr, itemPtr);
+    TagIndexAddItem(canvasPtr, itemPtr);
+    SetForceRedraw(canvasPtr, itemPtr);
     *itemPtrPtr = itemPtr;
 
     return TCL_OK;
@@ -3542,6 +4192,138 @@ ItemGetNumTags(Tk_PathItem *itemPtr)
     }
 }
 
+static int
+ItemHasTag(Tk_PathItem *itemPtr, Tk_Uid tag)
+{
+    Tk_PathTags *ptagsPtr = itemPtr->pathTagsPtr;
+    int i;
+
+    if (ptagsPtr != NULL) {
+	for (i = 0; i < ptagsPtr->numTags; i++) {
+	    if (ptagsPtr->tagPtr[i] == tag) {
+		return 1;
+	    }
+	}
+    }
+    return 0;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TagIndexAdd, TagIndexAddItem, TagIndexRemove, TagIndexRemoveItem,
+ * TagIndexFree --
+ *
+ *	Maintain the canvas tagTable which maps each tag to the ids of the
+ *	items carrying it, so that simple tag searches needn't look at all
+ *	items. Tags are added whenever an item may have got new ones: on
+ *	creation, itemconfigure and addtag. Entries of items which have lost
+ *	a tag through -tags are not removed here but when a search finds
+ *	them stale, see TagSearchCollect. Item ids are never reused, so a
+ *	stale entry can't match a new item.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The tagTable is updated.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+TagIndexAdd(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_PathItem *itemPtr,	/* Item which has tag. */
+    Tk_Uid tag)			/* Tag to record. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashTable *setPtr;
+    int isNew;
+
+    hPtr = Tcl_CreateHashEntry(&canvasPtr->tagTable, (char *) tag, &isNew);
+    if (isNew) {
+	setPtr = (Tcl_HashTable *) ckalloc(sizeof(Tcl_HashTable));
+	Tcl_InitHashTable(setPtr, TCL_ONE_WORD_KEYS);
+	Tcl_SetHashValue(hPtr, setPtr);
+    } else {
+	setPtr = (Tcl_HashTable *) Tcl_GetHashValue(hPtr);
+    }
+    Tcl_CreateHashEntry(setPtr, (char *) INT2PTR(itemPtr->id), &isNew);
+}
+
+static void
+TagIndexAddItem(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_PathItem *itemPtr)	/* Item whose tags may have changed. */
+{
+    Tk_PathTags *ptagsPtr = itemPtr->pathTagsPtr;
+    int i;
+
+    if (ptagsPtr != NULL) {
+	for (i = 0; i < ptagsPtr->numTags; i++) {
+	    TagIndexAdd(canvasPtr, itemPtr, ptagsPtr->tagPtr[i]);
+	}
+    }
+}
+
+static void
+TagIndexRemove(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_PathItem *itemPtr,	/* Item which lost tag. */
+    Tk_Uid tag)			/* Tag to forget. */
+{
+    Tcl_HashEntry *hPtr, *idPtr;
+    Tcl_HashTable *setPtr;
+
+    hPtr = Tcl_FindHashEntry(&canvasPtr->tagTable, (char *) tag);
+    if (hPtr == NULL) {
+	return;
+    }
+    setPtr = (Tcl_HashTable *) Tcl_GetHashValue(hPtr);
+    idPtr = Tcl_FindHashEntry(setPtr, (char *) INT2PTR(itemPtr->id));
+    if (idPtr != NULL) {
+	Tcl_DeleteHashEntry(idPtr);
+    }
+    if (setPtr->numEntries == 0) {
+	Tcl_DeleteHashTable(setPtr);
+	ckfree((char *) setPtr);
+	Tcl_DeleteHashEntry(hPtr);
+    }
+}
+
+static void
+TagIndexRemoveItem(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
+    Tk_PathItem *itemPtr)	/* Item being deleted. */
+{
+    Tk_PathTags *ptagsPtr = itemPtr->pathTagsPtr;
+    int i;
+
+    if (ptagsPtr != NULL) {
+	for (i = 0; i < ptagsPtr->numTags; i++) {
+	    TagIndexRemove(canvasPtr, itemPtr, ptagsPtr->tagPtr[i]);
+	}
+    }
+}
+
+static void
+TagIndexFree(
+    TkPathCanvas *canvasPtr)	/* Canvas being destroyed. */
+{
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    Tcl_HashTable *setPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&canvasPtr->tagTable, &search);
+	    hPtr != NULL; hPtr = Tcl_NextHashEntry(&search)) {
+	setPtr = (Tcl_HashTable *) Tcl_GetHashValue(hPtr);
+	Tcl_DeleteHashTable(setPtr);
+	ckfree((char *) setPtr);
+    }
+    Tcl_DeleteHashTable(&canvasPtr->tagTable);
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -3563,6 +4345,7 @@ TkPathCanvasItemDetach(Tk_PathItem *itemPtr)
 {
     Tk_PathItem *parentPtr;
 
+    SetAncestorsDirtyBbox(itemPtr, 1);
     if (itemPtr->prevPtr != NULL) {
 	itemPtr->prevPtr->nextPtr = itemPtr->nextPtr;
     }
@@ -3615,6 +4398,14 @@ ItemAddToParent(Tk_PathItem *parentPtr, Tk_PathItem *itemPtr)
     }
     parentPtr->lastChildPtr = itemPtr;
     itemPtr->parentPtr = parentPtr;
+    SetAncestorsDirtyBbox(itemPtr, 1);
+
+    /*
+     * Parents are always groups which know their canvas.
+     */
+
+    TkPathCanvasIndexOrderChanged(
+	    (TkPathCanvas *) ((Tk_PathItemEx *) parentPtr)->canvas);
 }
 
 /*
@@ -3650,11 +4441,20 @@ ItemDelete(TkPathCanvas *canvasPtr, Tk_PathItem *itemPtr)
     }
 
     EventuallyRedrawItem((Tk_PathCanvas) canvasPtr, itemPtr);
+    if (itemPtr->redraw_flags & FORCE_REDRAW) {
+	entryPtr = Tcl_FindHashEntry(&canvasPtr->forcedTable,
+				     (char *) itemPtr);
+	if (entryPtr != NULL) {
+	    Tcl_DeleteHashEntry(entryPtr);
+	}
+    }
     if (canvasPtr->bindingTable != NULL) {
 	Tk_DeleteAllBindings(canvasPtr->bindingTable,
 			     (ClientData) itemPtr);
     }
 
+    TagIndexRemoveItem(canvasPtr, itemPtr);
+
     /*
      * The item type deleteProc is responsible for calling
      * Tk_FreeConfigOptions which will implicitly also clean up
@@ -3666,6 +4466,7 @@ ItemDelete(TkPathCanvas *canvasPtr, Tk_PathItem *itemPtr)
     entryPtr = Tcl_FindHashEntry(&canvasPtr->idTable,
 				 (char *) INT2PTR(itemPtr->id));
     Tcl_DeleteHashEntry(entryPtr);
+    TkPathCanvasIndexRemove(canvasPtr, itemPtr);
     TkPathCanvasItemDetach(itemPtr);
 
     if (itemPtr == canvasPtr->currentItemPtr) {
@@ -3707,6 +4508,191 @@ DebugGetItemInfo(Tk_PathItem *itemPtr, char *s)
     strcat(s, tmp);
 }
 
+#ifdef TKPATH_TEST
+/*
+ *--------------------------------------------------------------
+ *
+ * SnapshotShift --
+ *
+ *	Helper for CanvasSnapshot; finds the shift and the number of
+ *	bits of a TrueColor channel mask.
+ *
+ * Results:
+ *	The shift; the number of bits is left in *bitsPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+SnapshotShift(unsigned long mask, int *bitsPtr)
+{
+    int shift = 0, bits = 0;
+
+    if (mask == 0) {
+	*bitsPtr = 0;
+	return 0;
+    }
+    while ((mask & 1) == 0) {
+	shift++;
+	mask >>= 1;
+    }
+    while (mask & 1) {
+	bits++;
+	mask >>= 1;
+    }
+    *bitsPtr = bits;
+    return shift;
+}
+
+/*
+ * Scales a TrueColor channel to 8 bits.
+ */
+
+static int
+SnapshotChannel(unsigned long pixel, unsigned long mask, int shift, int bits)
+{
+    unsigned long value = (pixel & mask) >> shift;
+
+    if (bits == 0) {
+	return 0;
+    } else if (bits >= 8) {
+	return (int) (value >> (bits - 8));
+    } else {
+	return (int) (value * 255 / ((1UL << bits) - 1));
+    }
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * CanvasSnapshot --
+ *
+ *	Redraws the whole visible area of the canvas and copies the pixels
+ *	drawn into a photo image. It is a test hook, which lets the test
+ *	suite check what was actually drawn. The pixels are read from the
+ *	back buffer, so that it doesn't matter if the window is covered.
+ *
+ * Results:
+ *	A standard Tcl result.
+ *
+ * Side effects:
+ *	A pending redisplay is done at once. The photo is resized to the
+ *	window without its borders and its pixels are replaced.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+CanvasSnapshot(Tcl_Interp *interp, TkPathCanvas *canvasPtr,
+	Tk_PhotoHandle photo)
+{
+    Tk_Window tkwin = canvasPtr->tkwin;
+    Display *display = Tk_Display(tkwin);
+    Visual *visual = Tk_Visual(tkwin);
+    XImage *ximage;
+    XColor *xcolors = NULL;
+    Tk_PhotoImageBlock block;
+    unsigned char *pixelPtr;
+    Drawable drawable;
+    int inset = canvasPtr->inset;
+    int width = Tk_Width(tkwin) - 2*inset;
+    int height = Tk_Height(tkwin) - 2*inset;
+    int x, y, trueColor, result;
+    int rShift = 0, gShift = 0, bShift = 0, rBits, gBits, bBits;
+
+    if (!Tk_IsMapped(tkwin) || (width <= 0) || (height <= 0)) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"canvas must be mapped to take a snapshot", -1));
+	return TCL_ERROR;
+    }
+    if (canvasPtr->flags & REDRAW_PENDING) {
+	Tcl_CancelIdleCall(DisplayCanvas, (ClientData) canvasPtr);
+	DisplayCanvas((ClientData) canvasPtr);
+	if (canvasPtr->flags & CANVAS_DELETED) {
+	    Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		    "canvas was deleted while redrawing", -1));
+	    return TCL_ERROR;
+	}
+    }
+    RedrawArea(canvasPtr, canvasPtr->xOrigin + inset,
+	    canvasPtr->yOrigin + inset, canvasPtr->xOrigin + inset + width,
+	    canvasPtr->yOrigin + inset + height);
+#ifndef TK_PATH_NO_DOUBLE_BUFFERING
+    drawable = canvasPtr->backBuffer;
+#else
+    drawable = Tk_WindowId(tkwin);
+#endif
+    ximage = XGetImage(display, drawable, inset, inset,
+	    (unsigned int) width, (unsigned int) height, AllPlanes, ZPixmap);
+    if (ximage == NULL) {
+	Tcl_SetObjResult(interp, Tcl_NewStringObj(
+		"could not read the canvas pixels", -1));
+	return TCL_ERROR;
+    }
+
+    trueColor = (visual->class == TrueColor) || (visual->class == DirectColor);
+    if (trueColor) {
+	rShift = SnapshotShift(visual->red_mask, &rBits);
+	gShift = SnapshotShift(visual->green_mask, &gBits);
+	bShift = SnapshotShift(visual->blue_mask, &bBits);
+    } else {
+	xcolors = (XColor *) ckalloc(width * sizeof(XColor));
+    }
+    block.pixelPtr = (unsigned char *) ckalloc(width * height * 4);
+    block.width = width;
+    block.height = height;
+    block.pitch = width * 4;
+    block.pixelSize = 4;
+    block.offset[0] = 0;
+    block.offset[1] = 1;
+    block.offset[2] = 2;
+    block.offset[3] = 3;
+
+    for (y = 0; y < height; y++) {
+	pixelPtr = block.pixelPtr + y * block.pitch;
+	if (!trueColor) {
+	    for (x = 0; x < width; x++) {
+		xcolors[x].pixel = XGetPixel(ximage, x, y);
+	    }
+	    XQueryColors(display, Tk_Colormap(tkwin), xcolors, width);
+	}
+	for (x = 0; x < width; x++, pixelPtr += 4) {
+	    if (trueColor) {
+		unsigned long pixel = XGetPixel(ximage, x, y);
+
+		pixelPtr[0] = SnapshotChannel(pixel, visual->red_mask,
+			rShift, rBits);
+		pixelPtr[1] = SnapshotChannel(pixel, visual->green_mask,
+			gShift, gBits);
+		pixelPtr[2] = SnapshotChannel(pixel, visual->blue_mask,
+			bShift, bBits);
+	    } else {
+		pixelPtr[0] = xcolors[x].red >> 8;
+		pixelPtr[1] = xcolors[x].green >> 8;
+		pixelPtr[2] = xcolors[x].blue >> 8;
+	    }
+	    pixelPtr[3] = 255;
+	}
+    }
+    XDestroyImage(ximage);
+    if (xcolors != NULL) {
+	ckfree((char *) xcolors);
+    }
+
+    result = Tk_PhotoSetSize(interp, photo, width, height);
+    if (result == TCL_OK) {
+	result = Tk_PhotoPutBlock(interp, photo, &block, 0, 0, width, height,
+		TK_PHOTO_COMPOSITE_SET);
+    }
+    ckfree((char *) block.pixelPtr);
+    return result;
+}
+
+#endif /* TKPATH_TEST */
+
 #ifdef USE_OLD_TAG_SEARCH
 /*
  *--------------------------------------------------------------
@@ -4073,6 +5059,8 @@ TagSearchScan(
 
 	*searchPtrPtr = searchPtr = (TagSearch *) ckalloc(sizeof(TagSearch));
 	searchPtr->expr = NULL;
+	searchPtr->ids = NULL;
+	searchPtr->idSpace = 0;
 
 	/*
 	 * Allocate buffer for rewritten tags (after de-escaping).
@@ -4109,6 +5097,7 @@ TagSearchScan(
     searchPtr->canvasPtr = canvasPtr;
     searchPtr->searchOver = 0;
     searchPtr->type = SEARCH_TYPE_EMPTY;
+    searchPtr->useIds = 0;
 
     /*
      * Find the first matching item in one of several ways. If the tag is a
@@ -4142,6 +5131,17 @@ TagSearchScan(
 	return TCL_OK;
     }
 
+    /*
+     * Expressions compiled recently by this canvas need no parsing.
+     */
+
+    searchPtr->string = tag;
+    searchPtr->stringIndex = 0;
+    if (TagExprCacheGet(canvasPtr, searchPtr->expr)) {
+	searchPtr->type = SEARCH_TYPE_EXPR;
+	return TCL_OK;
+    }
+
     /*
      * Pre-scan tag for at least one unquoted "&&" "||" "^" "!"
      *   if not found then use string as simple tag
@@ -4186,6 +5186,7 @@ TagSearchScan(
 	    return TCL_ERROR;
 	}
 	searchPtr->expr->length = searchPtr->expr->index;
+	TagExprCachePut(canvasPtr, searchPtr->expr);
     } else if (searchPtr->expr->uid == GetStaticUids()->allUid) {
 	/*
 	 * All items match.
@@ -4228,10 +5229,144 @@ TagSearchDestroy(
     if (searchPtr) {
 	TagSearchExprDestroy(searchPtr->expr);
 	ckfree((char *)searchPtr->rewritebuffer);
+	if (searchPtr->ids != NULL) {
+	    ckfree((char *)searchPtr->ids);
+	}
 	ckfree((char *)searchPtr);
     }
 }
 
+/*
+ *--------------------------------------------------------------
+ *
+ * TagExprCacheGet, TagExprCachePut, TagExprCacheFree --
+ *
+ *	Maintain the canvas cache of compiled tag expressions. It is a
+ *	hash table on the expression uid whose entries are also kept on a
+ *	list in order of use, so that the least recently used one can be
+ *	dropped when the cache is full.
+ *
+ * Results:
+ *	TagExprCacheGet returns 1 and fills in the uids and length of expr
+ *	if the expression given by expr->uid was found, else 0.
+ *
+ * Side effects:
+ *	Cache entries are created, reordered or freed.
+ *
+ *--------------------------------------------------------------
+ */
+
+static void
+TagExprCacheUnlink(
+    TkPathCanvas *canvasPtr,
+    TagExprCacheEntry *entryPtr)
+{
+    if (entryPtr->prevPtr != NULL) {
+	entryPtr->prevPtr->nextPtr = entryPtr->nextPtr;
+    } else {
+	canvasPtr->exprCacheHead = entryPtr->nextPtr;
+    }
+    if (entryPtr->nextPtr != NULL) {
+	entryPtr->nextPtr->prevPtr = entryPtr->prevPtr;
+    } else {
+	canvasPtr->exprCacheTail = entryPtr->prevPtr;
+    }
+}
+
+static void
+TagExprCacheLinkFirst(
+    TkPathCanvas *canvasPtr,
+    TagExprCacheEntry *entryPtr)
+{
+    entryPtr->prevPtr = NULL;
+    entryPtr->nextPtr = canvasPtr->exprCacheHead;
+    if (canvasPtr->exprCacheHead != NULL) {
+	canvasPtr->exprCacheHead->prevPtr = entryPtr;
+    } else {
+	canvasPtr->exprCacheTail = entryPtr;
+    }
+    canvasPtr->exprCacheHead = entryPtr;
+}
+
+static int
+TagExprCacheGet(
+    TkPathCanvas *canvasPtr,	/* Canvas being searched. */
+    TagSearchExpr *expr)	/* Expression to fill in; its uid is set. */
+{
+    Tcl_HashEntry *hPtr;
+    TagExprCacheEntry *entryPtr;
+
+    hPtr = Tcl_FindHashEntry(&canvasPtr->exprCache, (char *) expr->uid);
+    if (hPtr == NULL) {
+	return 0;
+    }
+    entryPtr = (TagExprCacheEntry *) Tcl_GetHashValue(hPtr);
+    if (entryPtr != canvasPtr->exprCacheHead) {
+	TagExprCacheUnlink(canvasPtr, entryPtr);
+	TagExprCacheLinkFirst(canvasPtr, entryPtr);
+    }
+    if (expr->allocated < entryPtr->length + 1) {
+	expr->allocated = entryPtr->length + 1;
+	if (expr->uids) {
+	    expr->uids = (Tk_Uid *) ckrealloc((char *) expr->uids,
+		    expr->allocated * sizeof(Tk_Uid));
+	} else {
+	    expr->uids = (Tk_Uid *) ckalloc(expr->allocated * sizeof(Tk_Uid));
+	}
+    }
+    memcpy(expr->uids, entryPtr->uids, entryPtr->length * sizeof(Tk_Uid));
+    expr->length = entryPtr->length;
+    expr->index = 0;
+    return 1;
+}
+
+static void
+TagExprCachePut(
+    TkPathCanvas *canvasPtr,	/* Canvas being searched. */
+    TagSearchExpr *expr)	/* Freshly compiled expression. */
+{
+    Tcl_HashEntry *hPtr;
+    TagExprCacheEntry *entryPtr;
+    int isNew;
+
+    hPtr = Tcl_CreateHashEntry(&canvasPtr->exprCache, (char *) expr->uid,
+	    &isNew);
+    if (!isNew) {
+	return;
+    }
+    if (canvasPtr->exprCache.numEntries > TAG_EXPR_CACHE_SIZE) {
+	entryPtr = canvasPtr->exprCacheTail;
+	TagExprCacheUnlink(canvasPtr, entryPtr);
+	Tcl_DeleteHashEntry(entryPtr->hPtr);
+	ckfree((char *) entryPtr->uids);
+	ckfree((char *) entryPtr);
+    }
+    entryPtr = (TagExprCacheEntry *) ckalloc(sizeof(TagExprCacheEntry));
+    entryPtr->length = expr->length;
+    entryPtr->uids = (Tk_Uid *)
+	    ckalloc((unsigned) ((expr->length + 1) * sizeof(Tk_Uid)));
+    memcpy(entryPtr->uids, expr->uids, expr->length * sizeof(Tk_Uid));
+    entryPtr->hPtr = hPtr;
+    Tcl_SetHashValue(hPtr, entryPtr);
+    TagExprCacheLinkFirst(canvasPtr, entryPtr);
+}
+
+static void
+TagExprCacheFree(
+    TkPathCanvas *canvasPtr)	/* Canvas being destroyed. */
+{
+    TagExprCacheEntry *entryPtr, *nextPtr;
+
+    for (entryPtr = canvasPtr->exprCacheHead; entryPtr != NULL;
+	    entryPtr = nextPtr) {
+	nextPtr = entryPtr->nextPtr;
+	ckfree((char *) entryPtr->uids);
+	ckfree((char *) entryPtr);
+    }
+    canvasPtr->exprCacheHead = canvasPtr->exprCacheTail = NULL;
+    Tcl_DeleteHashTable(&canvasPtr->exprCache);
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -4734,10 +5869,15 @@ TagSearchFirst(
 
     if (searchPtr->type == SEARCH_TYPE_TAG) {
 	/*
-	 * Optimized single-tag search
+	 * Optimized single-tag search. Look the items up in the tag index
+	 * unless the tag is so common that walking the display list is
+	 * as cheap.
 	 */
 
 	uid = searchPtr->expr->uid;
+	if (TagSearchCollect(searchPtr, uid)) {
+	    return TagSearchNextId(searchPtr);
+	}
 	for (lastPtr = NULL, itemPtr = searchPtr->canvasPtr->rootItemPtr;
 		itemPtr != NULL; lastPtr = itemPtr, itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
 	    ptagsPtr = itemPtr->pathTagsPtr;
@@ -4803,6 +5943,10 @@ TagSearchNext(
     Tk_Uid uid, *tagPtr;
     int count;
 
+    if (searchPtr->useIds) {
+	return TagSearchNextId(searchPtr);
+    }
+
     /*
      * Find next item in list (this may not actually be a suitable one to
      * return), and return if there are no items left.
@@ -4880,6 +6024,129 @@ TagSearchNext(
     searchPtr->searchOver = 1;
     return NULL;
 }
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TagSearchCollect --
+ *
+ *	Looks up the items having a simple tag in the canvas tagTable and
+ *	stores their ids in stacking order in the search record. Stale
+ *	entries, of items that were deleted or lost the tag, are removed
+ *	from the tagTable first, so that only live items count below.
+ *
+ * Results:
+ *	1 if the search shall use the collected ids, 0 if more than half
+ *	of all items have the tag and the display list should be searched
+ *	instead.
+ *
+ * Side effects:
+ *	The ids fields of searchPtr are set.
+ *
+ *--------------------------------------------------------------
+ */
+
+static int
+TagSearchCollect(
+    TagSearch *searchPtr,	/* Record describing tag search. */
+    Tk_Uid uid)			/* Tag to look up. */
+{
+    TkPathCanvas *canvasPtr = searchPtr->canvasPtr;
+    Tcl_HashEntry *hPtr, *idPtr, *entryPtr;
+    Tcl_HashSearch search;
+    Tcl_HashTable *setPtr;
+    Tk_PathItem **items, *itemPtr;
+    int i, numItems = 0;
+
+    searchPtr->numIds = 0;
+    searchPtr->idIndex = 0;
+    hPtr = Tcl_FindHashEntry(&canvasPtr->tagTable, (char *) uid);
+    if (hPtr == NULL) {
+	searchPtr->useIds = 1;
+	return 1;
+    }
+    setPtr = (Tcl_HashTable *) Tcl_GetHashValue(hPtr);
+    items = (Tk_PathItem **)
+	    ckalloc((unsigned) (setPtr->numEntries * sizeof(Tk_PathItem *)));
+    for (idPtr = Tcl_FirstHashEntry(setPtr, &search); idPtr != NULL;
+	    idPtr = Tcl_NextHashEntry(&search)) {
+	entryPtr = Tcl_FindHashEntry(&canvasPtr->idTable,
+		Tcl_GetHashKey(setPtr, idPtr));
+	if (entryPtr != NULL) {
+	    itemPtr = (Tk_PathItem *) Tcl_GetHashValue(entryPtr);
+	    if (ItemHasTag(itemPtr, uid)) {
+		items[numItems++] = itemPtr;
+		continue;
+	    }
+	}
+	Tcl_DeleteHashEntry(idPtr);
+    }
+    if (setPtr->numEntries == 0) {
+	Tcl_DeleteHashTable(setPtr);
+	ckfree((char *) setPtr);
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    if (numItems > canvasPtr->idTable.numEntries / 2) {
+	ckfree((char *) items);
+	return 0;
+    }
+    TkPathCanvasIndexSortItems(canvasPtr, items, numItems);
+    if (numItems > searchPtr->idSpace) {
+	if (searchPtr->ids != NULL) {
+	    ckfree((char *) searchPtr->ids);
+	}
+	searchPtr->idSpace = numItems + 16;
+	searchPtr->ids = (int *)
+		ckalloc((unsigned) (searchPtr->idSpace * sizeof(int)));
+    }
+    for (i = 0; i < numItems; i++) {
+	searchPtr->ids[i] = items[i]->id;
+    }
+    ckfree((char *) items);
+    searchPtr->numIds = numItems;
+    searchPtr->useIds = 1;
+    return 1;
+}
+
+/*
+ *--------------------------------------------------------------
+ *
+ * TagSearchNextId --
+ *
+ *	Returns the next item collected by TagSearchCollect. Items deleted,
+ *	or which lost the tag, since the search started are skipped.
+ *
+ * Results:
+ *	The next matching item, or NULL.
+ *
+ * Side effects:
+ *	None.
+ *
+ *--------------------------------------------------------------
+ */
+
+static Tk_PathItem *
+TagSearchNextId(
+    TagSearch *searchPtr)	/* Record describing tag search. */
+{
+    Tcl_HashEntry *entryPtr;
+    Tk_PathItem *itemPtr;
+
+    while (!searchPtr->searchOver
+	    && (searchPtr->idIndex < searchPtr->numIds)) {
+	entryPtr = Tcl_FindHashEntry(&searchPtr->canvasPtr->idTable,
+		(char *) INT2PTR(searchPtr->ids[searchPtr->idIndex++]));
+	if (entryPtr != NULL) {
+	    itemPtr = (Tk_PathItem *) Tcl_GetHashValue(entryPtr);
+	    if (ItemHasTag(itemPtr, searchPtr->expr->uid)) {
+		searchPtr->currentPtr = itemPtr;
+		return itemPtr;
+	    }
+	}
+    }
+    searchPtr->searchOver = 1;
+    return NULL;
+}
 #endif /* USE_OLD_TAG_SEARCH */
 
 /*
@@ -4903,6 +6170,7 @@ TagSearchNext(
 
 static void
 DoItem(
+    TkPathCanvas *canvasPtr,	/* Canvas containing item. */
     Tcl_Interp *interp,		/* Interpreter in which to (possibly) record
 				 * item id. */
     Tk_PathItem *itemPtr,	/* Item to (possibly) modify. */
@@ -4971,6 +6239,7 @@ DoItem(
 
     *tagPtr = tag;
     ptagsPtr->numTags++;
+    TagIndexAdd(canvasPtr, itemPtr, tag);
 }
 
 /*
@@ -5056,7 +6325,7 @@ FindItems(
 
 	/* We constrain this to siblings. */
 	if ((lastPtr != NULL) && (lastPtr->nextPtr != NULL)) {
-	    DoItem(interp, lastPtr->nextPtr, uid);
+	    DoItem(canvasPtr, interp, lastPtr->nextPtr, uid);
 	}
 	break;
     }
@@ -5067,7 +6336,7 @@ FindItems(
 	}
 	for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
 		itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
-	    DoItem(interp, itemPtr, uid);
+	    DoItem(canvasPtr, interp, itemPtr, uid);
 	}
 	break;
 
@@ -5082,7 +6351,7 @@ FindItems(
 
 	    /* We constrain this to siblings. */
 	    if (itemPtr->prevPtr != NULL) {
-		DoItem(interp, itemPtr->prevPtr, uid);
+		DoItem(canvasPtr, interp, itemPtr->prevPtr, uid);
 	    }
 	}
 	break;
@@ -5127,6 +6396,13 @@ FindItems(
 		startPtr = itemPtr;
 	    }
 	}
+	if (startPtr == canvasPtr->rootItemPtr) {
+	    closestPtr = FindClosestItem(canvasPtr, coords, halo);
+	    if (closestPtr != NULL) {
+		DoItem(canvasPtr, interp, closestPtr, uid);
+	    }
+	    return TCL_OK;
+	}
 
 	/*
 	 * The code below is optimized so that it can eliminate most items
@@ -5176,7 +6452,7 @@ FindItems(
 		    itemPtr = canvasPtr->rootItemPtr;
 		}
 		if (itemPtr == startPtr) {
-		    DoItem(interp, closestPtr, uid);
+		    DoItem(canvasPtr, interp, closestPtr, uid);
 		    return TCL_OK;
 		}
 		if (itemPtr->state == TK_PATHSTATE_HIDDEN ||
@@ -5220,7 +6496,7 @@ FindItems(
 	}
 	FOR_EVERY_CANVAS_ITEM_MATCHING(objv[first+1], searchPtrPtr,
 		return TCL_ERROR) {
-	    DoItem(interp, itemPtr, uid);
+	    DoItem(canvasPtr, interp, itemPtr, uid);
 	}
     }
     return TCL_OK;
@@ -5266,6 +6542,7 @@ FindArea(
     double rect[4], tmp;
     int x1, y1, x2, y2;
     Tk_PathItem *itemPtr;
+    TkPathAreaSearch search;
 
     if ((Tk_PathCanvasGetCoordFromObj(interp, (Tk_PathCanvas) canvasPtr, objv[0],
 		&rect[0]) != TCL_OK)
@@ -5293,8 +6570,9 @@ FindArea(
     y1 = (int) (rect[1]-1.0);
     x2 = (int) (rect[2]+1.0);
     y2 = (int) (rect[3]+1.0);
-    for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-	    itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+    for (itemPtr = TkPathCanvasAreaSearchFirst(canvasPtr, x1, y1, x2, y2,
+	    &search); itemPtr != NULL;
+	    itemPtr = TkPathCanvasAreaSearchNext(&search)) {
 	if (itemPtr->state == TK_PATHSTATE_HIDDEN || (itemPtr->state == TK_PATHSTATE_NULL &&
 		canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
 	    continue;
@@ -5305,9 +6583,10 @@ FindArea(
 	}
 	if ((*itemPtr->typePtr->areaProc)((Tk_PathCanvas) canvasPtr, itemPtr, rect)
 		>= enclosed) {
-	    DoItem(interp, itemPtr, uid);
+	    DoItem(canvasPtr, interp, itemPtr, uid);
 	}
     }
+    TkPathCanvasAreaSearchDone(&search);
     return TCL_OK;
 }
 
@@ -5470,6 +6749,7 @@ RelinkItems(
     if (parentPtr->lastChildPtr == prevPtr) {
 	parentPtr->lastChildPtr = lastMovePtr;
     }
+    TkPathCanvasIndexOrderChanged(canvasPtr);
 
 #ifndef USE_OLD_TAG_SEARCH
     return TCL_OK;
@@ -5749,6 +7029,7 @@ PickCurrentItem(
 		if (ptagsPtr->tagPtr[i] == searchUids->currentUid)
 #endif /* USE_OLD_TAG_SEARCH */
 		    /* then */ {
+		    TagIndexRemove(canvasPtr, itemPtr, ptagsPtr->tagPtr[i]);
 		    ptagsPtr->tagPtr[i] = ptagsPtr->tagPtr[ptagsPtr->numTags-1];
 		    ptagsPtr->numTags--;
 		    break;
@@ -5787,9 +7068,9 @@ PickCurrentItem(
 	XEvent event;
 
 #ifdef USE_OLD_TAG_SEARCH
-	DoItem(NULL, canvasPtr->currentItemPtr, Tk_GetUid("current"));
+	DoItem(canvasPtr, NULL, canvasPtr->currentItemPtr, Tk_GetUid("current"));
 #else /* USE_OLD_TAG_SEARCH */
-	DoItem(NULL, canvasPtr->currentItemPtr, searchUids->currentUid);
+	DoItem(canvasPtr, NULL, canvasPtr->currentItemPtr, searchUids->currentUid);
 #endif /* USE_OLD_TAG_SEA */
 	if ((canvasPtr->currentItemPtr->redraw_flags & TK_ITEM_STATE_DEPENDANT &&
 		prevItemPtr != canvasPtr->currentItemPtr)) {
@@ -5833,6 +7114,7 @@ CanvasFindClosest(
 {
     Tk_PathItem *itemPtr;
     Tk_PathItem *bestPtr;
+    TkPathAreaSearch search;
     int x1, y1, x2, y2;
 
     x1 = (int) (coords[0] - canvasPtr->closeEnough);
@@ -5841,8 +7123,9 @@ CanvasFindClosest(
     y2 = (int) (coords[1] + canvasPtr->closeEnough);
 
     bestPtr = NULL;
-    for (itemPtr = canvasPtr->rootItemPtr; itemPtr != NULL;
-	    itemPtr = TkPathCanvasItemIteratorNext(itemPtr)) {
+    for (itemPtr = TkPathCanvasAreaSearchFirst(canvasPtr, x1, y1, x2, y2,
+	    &search); itemPtr != NULL;
+	    itemPtr = TkPathCanvasAreaSearchNext(&search)) {
 	if ((itemPtr->state == TK_PATHSTATE_HIDDEN) ||
 	    (itemPtr->state == TK_PATHSTATE_DISABLED) ||
 		((itemPtr->state == TK_PATHSTATE_NULL) &&
@@ -5859,9 +7142,98 @@ CanvasFindClosest(
 	    bestPtr = itemPtr;
 	}
     }
+    TkPathCanvasAreaSearchDone(&search);
     return bestPtr;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * FindClosestItem --
+ *
+ *	Implements "find closest" when no start item is given. Items are
+ *	looked for in a square around the point which is grown until the
+ *	closest item found so far is known to be closer than anything
+ *	outside of it. If several items are equally close the topmost of
+ *	them is chosen.
+ *
+ * Results:
+ *	The closest visible item, or NULL if there is none.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Tk_PathItem *
+FindClosestItem(
+    TkPathCanvas *canvasPtr,	/* Canvas widget to search. */
+    double coords[2],		/* Point in canvas coordinates. */
+    double halo)		/* Items closer than this count as touching
+				 * the point. */
+{
+    Tk_PathItem *itemPtr, *closestPtr;
+    TkPathAreaSearch search;
+    double radius, closestDist, newDist, limit = (double) (INT_MAX / 2);
+    int last;
+
+    for (radius = halo + 64.0; ; radius *= 8.0) {
+	closestPtr = NULL;
+	closestDist = DBL_MAX;
+	last = (coords[0] - radius <= -limit) || (coords[0] + radius >= limit)
+		|| (coords[1] - radius <= -limit)
+		|| (coords[1] + radius >= limit);
+	if (last) {
+	    itemPtr = TkPathCanvasAreaSearchFirst(canvasPtr,
+		    -INT_MAX/2, -INT_MAX/2, INT_MAX/2, INT_MAX/2, &search);
+	} else {
+	    itemPtr = TkPathCanvasAreaSearchFirst(canvasPtr,
+		    (int) floor(coords[0] - radius),
+		    (int) floor(coords[1] - radius),
+		    (int) ceil(coords[0] + radius),
+		    (int) ceil(coords[1] + radius), &search);
+	}
+	if (TkPathCanvasAreaSearchIsLinear(&search)) {
+	    last = 1;
+	}
+	for ( ; itemPtr != NULL; itemPtr = TkPathCanvasAreaSearchNext(&search)) {
+	    if (itemPtr->state == TK_PATHSTATE_HIDDEN ||
+		    (itemPtr->state == TK_PATHSTATE_NULL &&
+		    canvasPtr->canvas_state == TK_PATHSTATE_HIDDEN)) {
+		continue;
+	    }
+	    newDist = (*itemPtr->typePtr->pointProc)((Tk_PathCanvas) canvasPtr,
+		    itemPtr, coords);
+	    if (newDist >= DBL_MAX) {
+		/*
+		 * Groups are nowhere.
+		 */
+
+		continue;
+	    }
+	    newDist -= halo;
+	    if (newDist < 0.0) {
+		newDist = 0.0;
+	    }
+	    if (newDist <= closestDist) {
+		closestDist = newDist;
+		closestPtr = itemPtr;
+	    }
+	}
+	TkPathCanvasAreaSearchDone(&search);
+
+	/*
+	 * Any item at most radius away has its bbox inside the square and
+	 * has been seen, which includes all items as close as the closest.
+	 */
+
+	if (last || ((closestPtr != NULL) && (closestDist + halo <= radius))) {
+	    return closestPtr;
+	}
+    }
+}
+
 /*
  *--------------------------------------------------------------
  *
@@ -6512,24 +7884,33 @@ CanvasSetOrigin(
     }
 
     /*
-     * Tricky point: must redisplay not only everything that's visible in the
-     * window's final configuration, but also everything that was visible in
-     * the initial configuration. This is needed because some item types, like
-     * windows, need to know when they move off-screen so they can explicitly
-     * undisplay themselves.
+     * The pixels that stay visible are scrolled by DisplayCanvas, which
+     * then redraws only the uncovered area. Tricky point: items like
+     * windows must still be redisplayed if they are visible in either the
+     * initial or the final configuration, so that they can move or
+     * explicitly undisplay themselves. Both areas therefore go into the
+     * redraw bounding box, though not into the damaged rectangles.
      */
 
-    Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
-	    canvasPtr->xOrigin, canvasPtr->yOrigin,
+    canvasPtr->flags |= UPDATE_SCROLLBARS;
+    if ((canvasPtr->flags & CANVAS_DELETED)
+	    || !Tk_IsMapped(canvasPtr->tkwin)) {
+	canvasPtr->xOrigin = xOrigin;
+	canvasPtr->yOrigin = yOrigin;
+	return;
+    }
+    AddRedrawBox(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin,
 	    canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin),
 	    canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
     canvasPtr->xOrigin = xOrigin;
     canvasPtr->yOrigin = yOrigin;
-    canvasPtr->flags |= UPDATE_SCROLLBARS;
-    Tk_PathCanvasEventuallyRedraw((Tk_PathCanvas) canvasPtr,
-	    canvasPtr->xOrigin, canvasPtr->yOrigin,
+    AddRedrawBox(canvasPtr, canvasPtr->xOrigin, canvasPtr->yOrigin,
 	    canvasPtr->xOrigin + Tk_Width(canvasPtr->tkwin),
 	    canvasPtr->yOrigin + Tk_Height(canvasPtr->tkwin));
+    if (!(canvasPtr->flags & REDRAW_PENDING)) {
+	Tcl_DoWhenIdle(DisplayCanvas, (ClientData) canvasPtr);
+	canvasPtr->flags |= REDRAW_PENDING;
+    }
 }
 
 /*
@@ -39,6 +39,53 @@ struct TagSearchExpr_s {
 };
 #endif /* not USE_OLD_TAG_SEARCH */
 
+/*
+ * Opaque types of the spatial item index, defined in tkpCanvIndex.c.
+ */
+
+typedef struct TkPathItemIndex TkPathItemIndex;
+typedef struct TkPathIndexEntry TkPathIndexEntry;
+
+/*
+ * A rectangle of the canvas that must be redrawn, in canvas coordinates.
+ * A canvas keeps up to PATH_MAX_DAMAGE of them; rectangles whose merging
+ * would redraw fewer than PATH_DAMAGE_SLACK extra pixels are merged.
+ */
+
+#define PATH_MAX_DAMAGE		8
+#define PATH_DAMAGE_SLACK	4096.0
+
+typedef struct TkPathDamage {
+    int x1, y1, x2, y2;
+} TkPathDamage;
+
+/*
+ * Path items with the same solid style that are drawn one after the other
+ * into the frame context are collected into one path and painted at once.
+ * This is only done for items whose areas don't share any pixel, since
+ * the result is then the same as painting them one by one. At most
+ * PATH_MAX_BATCH items are collected.
+ */
+
+#define PATH_MAX_BATCH		64
+
+typedef struct TkPathBatch {
+    TkPathContext ctx;		/* Context holding the collected path, or 0
+				 * if nothing is collected. */
+    Tk_PathStyle style;		/* Style to paint the path with. Its colors
+				 * point to the copies below, since the
+				 * style of the first item may be gone when
+				 * the batch is painted. */
+    TkPathColor fill;		/* Fill of style. */
+    XColor fillColor;		/* Copy of the fill color. */
+    XColor strokeColor;		/* Copy of the stroke color. */
+    TMatrix matrix;		/* Matrix the items were stroked with. */
+    int numItems;		/* Number of items in the path. */
+    PathRect areas[PATH_MAX_BATCH];
+				/* Areas the items may paint, in drawable
+				 * coordinates. */
+} TkPathBatch;
+
 /*
  * The record below describes a canvas widget. It is made available to the
  * item functions so they can access certain shared fields such as the overall
@@ -88,6 +135,8 @@ typedef struct TkPathCanvas {
 				 * borders. */
     GC pixmapGC;		/* Used to copy bits from a pixmap to the
 				 * screen and also to clear the pixmap. */
+    GC scrollGC;		/* Used to scroll the window contents, with
+				 * graphics exposures. NULL until needed. */
     int width, height;		/* Dimensions to request for canvas window,
 				 * specified in pixels. */
     int redrawX1, redrawY1;	/* Upper left corner of area to redraw, in
@@ -97,6 +146,17 @@ typedef struct TkPathCanvas {
     int redrawX2, redrawY2;	/* Lower right corner of area to redraw, in
 				 * integer canvas coordinates. Border pixels
 				 * will *not* be redrawn. */
+    TkPathDamage damage[PATH_MAX_DAMAGE];
+				/* Rectangles covering the area to redraw,
+				 * each redrawn by itself. They may overlap,
+				 * then the overlap is redrawn more than once.
+				 * See AddDamage. */
+    int numDamage;		/* Number of valid entries in damage. */
+    int shownXOrigin, shownYOrigin;
+				/* Origin the window contents were drawn for
+				 * by the last redisplay. When the origin
+				 * changes they are scrolled by the
+				 * difference. Only valid if ORIGIN_SHOWN. */
     int confine;		/* Non-zero means constrain view to keep as
 				 * much of canvas visible as possible. */
 
@@ -153,6 +213,9 @@ typedef struct TkPathCanvas {
 				 * of the previous current item. */
     double closeEnough;		/* The mouse is assumed to be inside an item
 				 * if it is this close to it. */
+    double tolerance;		/* Max distance in pixels between a curve and
+				 * the straight line segments it is flattened
+				 * into. */
     XEvent pickEvent;		/* The event upon which the current choice of
 				 * currentItem is based. Must be saved so that
 				 * if the currentItem is deleted, can pick
@@ -253,9 +316,82 @@ typedef struct TkPathCanvas {
 #ifndef USE_OLD_TAG_SEARCH
     TagSearchExpr *bindTagExprs;/* Linked list of tag expressions used in
 				 * bindings. */
+    Tcl_HashTable exprCache;	/* Compiled tag expressions recently used by
+				 * widget commands, keyed by the expression
+				 * Tk_Uid. */
+    struct TagExprCacheEntry *exprCacheHead;
+				/* Most recently used entry of exprCache. */
+    struct TagExprCacheEntry *exprCacheTail;
+				/* Least recently used entry of exprCache,
+				 * evicted first. */
+#endif
+
+    /*
+     * Information used to share one rendering context among all items
+     * drawn during a single redisplay:
+     */
+
+    Drawable frameDrawable;	/* The drawable being redisplayed into, or
+				 * None when no redisplay is in progress. */
+    TkPathContext frameCtx;	/* Context for frameDrawable, created on
+				 * first use by TkPathCanvasBeginDraw and
+				 * freed at the end of DisplayCanvas. 0
+				 * if not yet created. */
+    PathRect frameClip;		/* The area being redrawn, in drawable
+				 * coordinates. frameCtx is clipped to it. */
+    TkPathBatch batch;		/* Items collected to be painted at once. */
+    Pixmap backBuffer;		/* Window sized pixmap that is kept between
+				 * redisplays and holds the rendered canvas.
+				 * Damaged areas are redrawn into it and
+				 * copied to the window. None if not yet
+				 * allocated. */
+    int backWidth, backHeight;	/* Size of backBuffer; it is reallocated
+				 * when the window size changes. */
+    int renderMode;		/* Value of -rendermode, see below. */
+#ifdef TKPATH_TEST
+    int numCacheRenders;	/* Number of group -cache surfaces rendered
+				 * so far, reported by 'cacherenders'. */
 #endif
+
+    /*
+     * Spatial index of the items, see tkpCanvIndex.c:
+     */
+
+    TkPathItemIndex *itemIndexPtr;
+				/* Grid of the item bounding boxes used to
+				 * find the items overlapping an area. */
+    Tcl_HashTable forcedTable;	/* Items with the FORCE_REDRAW flag set, so
+				 * DisplayCanvas needn't look at all items
+				 * to find them. */
+    Tcl_HashTable tagTable;	/* Maps a tag Tk_Uid to a hash table whose
+				 * keys are the ids of items which have, or
+				 * had, that tag. Used for simple tag
+				 * searches. */
+    Tcl_HashTable pathTable;	/* Parsed paths in use by items, keyed by
+				 * the path string, so that items made from
+				 * equal strings share geometry. */
+    unsigned long styleGeneration;
+				/* Incremented whenever a group's style
+				 * changes, which invalidates the resolved
+				 * styles cached in all items. Never 0. */
 } TkPathCanvas;
 
+/*
+ * State of a search for the items overlapping an area, see
+ * TkPathCanvasAreaSearchFirst:
+ */
+
+typedef struct TkPathAreaSearch {
+    TkPathCanvas *canvasPtr;	/* Canvas being searched. */
+    int linear;			/* 1 means that all items of the canvas are
+				 * visited in display list order. */
+    Tk_PathItem *itemPtr;	/* Current item if linear. */
+    Tk_PathItem **items;	/* Candidate items in stacking order if not
+				 * linear. */
+    int numItems;		/* Number of entries in items. */
+    int index;			/* Index of the next item to return. */
+} TkPathAreaSearch;
+
 /*
  * Flag bits for canvases:
  *
@@ -283,6 +419,9 @@ typedef struct TkPathCanvas {
  * BBOX_NOT_EMPTY -		1 means that the bounding box of the area that
  *				should be redrawn is not empty.
  * CANVAS_DELETED -
+ * ORIGIN_SHOWN -		1 means the window shows the canvas for
+ *				shownXOrigin and shownYOrigin, except for
+ *				the areas still to be redrawn.
  */
 
 #define REDRAW_PENDING		(1 << 0)
@@ -295,6 +434,19 @@ typedef struct TkPathCanvas {
 #define REPICK_IN_PROGRESS	(1 << 7)
 #define BBOX_NOT_EMPTY		(1 << 8)
 #define CANVAS_DELETED		(1 << 9)
+#define ORIGIN_SHOWN		(1 << 10)
+
+/*
+ * Values of the -rendermode option of the canvas:
+ *
+ * PATH_RENDER_NATIVE -		Items are drawn directly into the drawable.
+ * PATH_RENDER_IMAGE -		Path items are rendered into a client side
+ *				image of the redraw area which is then put
+ *				to the drawable, if the platform supports it.
+ */
+
+#define PATH_RENDER_NATIVE	0
+#define PATH_RENDER_IMAGE	1
 
 /*
  * Flag bits for canvas items (redraw_flags):
@@ -321,6 +473,14 @@ typedef struct Tk_PathItemEx  {
     Tcl_Obj *styleObj;	    /* Object with style name. */
     TkPathStyleInst *styleInst;
 			    /* The referenced style instance from styleObj. */
+    Tk_PathStyle resolvedStyle;
+			    /* Style cascaded from the root item, cached by
+			     * TkPathCanvasInheritStyle. */
+    TMatrix resolvedMatrix; /* Concatenated matrix of the item and its
+			     * parents; resolvedStyle.matrixPtr points here. */
+    long resolvedFlags;	    /* Merge flags resolvedStyle was made with. */
+    unsigned long styleGen; /* Canvas style generation resolvedStyle was made
+			     * in, or 0 if it must be remade. */
 
     /*
      *------------------------------------------------------------------
@@ -357,22 +517,56 @@ MODULE_SCOPE Tk_PathStyle   TkPathCanvasInheritStyle(Tk_PathItem *itemPtr,
 				long flags);
 MODULE_SCOPE TMatrix	    TkPathCanvasInheritTMatrix(Tk_PathItem *itemPtr);
 MODULE_SCOPE void	    TkPathCanvasFreeInheritedStyle(Tk_PathStyle *stylePtr);
+MODULE_SCOPE void	    TkPathCanvasStyleChanged(Tk_PathItem *itemPtr);
 MODULE_SCOPE Tcl_HashTable *TkPathCanvasGradientTable(Tk_PathCanvas canvas);
 MODULE_SCOPE Tcl_HashTable *TkPathCanvasStyleTable(Tk_PathCanvas canvas);
 MODULE_SCOPE Tk_PathState   TkPathCanvasState(Tk_PathCanvas canvas);
+MODULE_SCOPE double	    TkPathCanvasTolerance(Tk_PathCanvas canvas);
+MODULE_SCOPE Tcl_HashTable *TkPathCanvasPathTable(Tk_PathCanvas canvas);
 MODULE_SCOPE Tk_PathItem *  TkPathCanvasCurrentItem(Tk_PathCanvas canvas);
+MODULE_SCOPE TkPathContext  TkPathCanvasBeginDraw(Tk_PathCanvas canvas,
+				Drawable drawable);
+MODULE_SCOPE void	    TkPathCanvasEndDraw(Tk_PathCanvas canvas,
+				TkPathContext context);
+MODULE_SCOPE TkPathContext  TkPathCanvasBeginBatch(Tk_PathCanvas canvas,
+				Drawable drawable, Tk_PathStyle *stylePtr,
+				TMatrix *mPtr, PathRect *bboxPtr);
+MODULE_SCOPE void	    TkPathCanvasEndBatch(Tk_PathCanvas canvas,
+				TkPathContext context);
+MODULE_SCOPE void	    TkPathCanvasFlushBatch(Tk_PathCanvas canvas);
 MODULE_SCOPE void	    TkPathCanvasGroupBbox(Tk_PathCanvas canvas,
 				Tk_PathItem *itemPtr,
 				int *x1Ptr, int *y1Ptr, int *x2Ptr, int *y2Ptr);
 MODULE_SCOPE void	    TkPathCanvasUpdateGroupBbox(Tk_PathCanvas canvas,
 				Tk_PathItem *itemPtr);
 MODULE_SCOPE void	    TkPathCanvasSetGroupDirtyBbox(Tk_PathItem *itemPtr);
+MODULE_SCOPE void	    TkPathCanvasSetGroupDirtyCache(Tk_PathItem *itemPtr);
+MODULE_SCOPE int	    TkPathCanvasGroupCached(Tk_PathCanvas canvas,
+				Tk_PathItem *itemPtr);
 MODULE_SCOPE Tk_PathItem *  TkPathCanvasItemIteratorNext(Tk_PathItem *itemPtr);
 MODULE_SCOPE Tk_PathItem *  TkPathCanvasItemIteratorPrev(Tk_PathItem *itemPtr);
 MODULE_SCOPE int	    TkPathCanvasItemExConfigure(Tcl_Interp *interp,
 				Tk_PathCanvas canvas,
 				Tk_PathItemEx *itemExPtr, int mask);
 MODULE_SCOPE void	    TkPathCanvasItemDetach(Tk_PathItem *itemPtr);
+MODULE_SCOPE TkPathItemIndex *TkPathCanvasIndexCreate(void);
+MODULE_SCOPE void	    TkPathCanvasIndexFree(TkPathCanvas *canvasPtr);
+MODULE_SCOPE void	    TkPathCanvasIndexUpdate(TkPathCanvas *canvasPtr,
+				Tk_PathItem *itemPtr);
+MODULE_SCOPE void	    TkPathCanvasIndexRemove(TkPathCanvas *canvasPtr,
+				Tk_PathItem *itemPtr);
+MODULE_SCOPE void	    TkPathCanvasIndexOrderChanged(TkPathCanvas *canvasPtr);
+MODULE_SCOPE void	    TkPathCanvasIndexSortItems(TkPathCanvas *canvasPtr,
+				Tk_PathItem **items, int numItems);
+MODULE_SCOPE Tk_PathItem *  TkPathCanvasAreaSearchFirst(TkPathCanvas *canvasPtr,
+				int x1, int y1, int x2, int y2,
+				TkPathAreaSearch *searchPtr);
+MODULE_SCOPE Tk_PathItem *  TkPathCanvasAreaSearchNext(
+				TkPathAreaSearch *searchPtr);
+MODULE_SCOPE void	    TkPathCanvasAreaSearchDone(
+				TkPathAreaSearch *searchPtr);
+MODULE_SCOPE int	    TkPathCanvasAreaSearchIsLinear(
+				TkPathAreaSearch *searchPtr);
 MODULE_SCOPE void	    GroupItemConfigured(Tk_PathCanvas canvas,
 				Tk_PathItem *itemPtr, int mask);
 MODULE_SCOPE void	    CanvasTranslateGroup(Tk_PathCanvas canvas,
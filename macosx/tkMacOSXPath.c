@@ -579,6 +579,68 @@ TkPathInitSurface(Display *display, int width, int height)
     return (TkPathContext) context;
 }
 
+TkPathContext
+TkPathInitImage(Tk_Window tkwin, Drawable d, PathRect *rectPtr)
+{
+    /* Not supported, the canvas then draws with TkPathInit. */
+    return 0;
+}
+
+void
+TkPathFlushImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    /* Empty. */
+}
+
+int
+TkPathReloadImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    return 1;
+}
+
+int
+TkPathCanDrawSurface(void)
+{
+    return 0;
+}
+
+void
+TkPathDrawSurface(TkPathContext ctx, TkPathContext surface, double x,
+    double y)
+{
+    /* Empty. */
+}
+
+int
+TkPathKeepPath(TkPathContext ctx, int keep)
+{
+    return 0;
+}
+
+void
+TkPathFreeGradientCache(void *cachePtr)
+{
+    /* Empty. */
+}
+
+void *
+TkPathCopyPath(TkPathContext ctx)
+{
+    return NULL;
+}
+
+void
+TkPathAppendPath(TkPathContext ctx, void *pathPtr)
+{
+    /* Empty. */
+}
+
+void
+TkPathFreeCopiedPath(void *pathPtr)
+{
+    /* Empty. */
+}
+
 void
 TkPathPushTMatrix(TkPathContext ctx, TMatrix *mPtr)
 {
@@ -736,7 +798,8 @@ CGInterpolationQuality convertInterpolationToCGInterpolation(int interpolation)
 void
 TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
         double x, double y, double width0, double height0, double fillOpacity,
-        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion)
+        XColor *tintColor, double tintAmount, int interpolation, PathRect *srcRegion,
+        void **customPtr)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
     CGImageRef cgImage;
@@ -940,6 +1003,12 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
     }
 }
 
+void
+TkPathImageFree(void *custom)
+{
+    /* Empty. */
+}
+
 void
 TkPathClosePath(TkPathContext ctx)
 {
@@ -995,7 +1064,9 @@ TkPathTextConfig(Tcl_Interp *interp, Tk_PathTextStyle *textStylePtr, char *utf8,
     range = CFRangeMake(0, length);
     err = CreateATSUIStyle(textStylePtr->fontFamily, textStylePtr->fontSize, isBold(textStylePtr->fontWeight), isItalic(textStylePtr->fontSlant), &atsuStyle);
     if (err != noErr) {
-        Tcl_SetObjResult(interp, Tcl_NewStringObj("font style couldn't be created", -1));
+        if (interp != NULL) {
+            Tcl_SetObjResult(interp, Tcl_NewStringObj("font style couldn't be created", -1));
+        }
         return TCL_ERROR;
     }
     buffer = (UniChar *) ckalloc(length * sizeof(UniChar));
@@ -1003,7 +1074,9 @@ TkPathTextConfig(Tcl_Interp *interp, Tk_PathTextStyle *textStylePtr, char *utf8,
     err = CreateLayoutForString(buffer, length, atsuStyle, &atsuLayout);
     CFRelease(cf);
     if (err != noErr) {
-        Tcl_SetObjResult(interp, Tcl_NewStringObj("text layout couldn't be created", -1));
+        if (interp != NULL) {
+            Tcl_SetObjResult(interp, Tcl_NewStringObj("text layout couldn't be created", -1));
+        }
         ckfree((char *)buffer);
         return TCL_ERROR;
     }
@@ -1090,6 +1163,18 @@ TkPathTextMeasureBbox(Display *display, Tk_PathTextStyle *textStylePtr, char *ut
     double y = 0.0;
     double baseX = 0.0;
 
+    if (recordPtr == NULL) {
+        /* Measure without a ptext, or an empty string. */
+        void *tmp = NULL;
+
+        r.x1 = r.y1 = r.x2 = r.y2 = 0.0;
+        if ((TkPathTextConfig(NULL, textStylePtr, utf8, &tmp) == TCL_OK)
+                && (tmp != NULL)) {
+            r = TkPathTextMeasureBbox(display, textStylePtr, utf8, tmp);
+            TkPathTextFree(textStylePtr, tmp);
+        }
+        return r;
+    }
     for (i = 0; i < recordPtr->nlc; i++) {
         //printf("measure %i: from %d, length %d\n", i, recordPtr->nl[i], recordPtr->nl[i+1] - recordPtr->nl[i] - 1);
         b.upperRight.x = b.upperLeft.x = 0;
@@ -1196,6 +1281,21 @@ TkPathReleaseClipToPath(TkPathContext ctx)
     CGContextRestoreGState(context->c);
 }
 
+void
+TkPathClipToRect(TkPathContext ctx, PathRect *rectPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    CGContextClipToRect(context->c, CGRectMake(rectPtr->x1, rectPtr->y1,
+            rectPtr->x2 - rectPtr->x1, rectPtr->y2 - rectPtr->y1));
+}
+
+void
+TkPathSetTolerance(TkPathContext ctx, double tolerance)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    CGContextSetFlatness(context->c, (CGFloat) tolerance);
+}
+
 void
 TkPathStroke(TkPathContext ctx, Tk_PathStyle *style)
 {
@@ -34,4 +34,11 @@ proc ::tkp_cleanup {} {
     catch {destroy {*}[winfo children .]}
 }
 
+# Builds configured with --enable-testhooks have canvas subcommands that
+# let the tests look inside the canvas.
+::tkp::canvas .testhooks
+tcltest::testConstraint testhooks \
+	[expr {![catch {.testhooks cacherenders}]}]
+destroy .testhooks
+
 tcltest::runAllTests
@@ -3,8 +3,6 @@
  *
  *     This file implements path drawing API's using the Cairo rendering engine.
  *
- *  TODO: implement text drawing using glyphs instead of the "toy" text API.
- *
  * Copyright (c) 2005-2008  Mats Bengtsson
  *
  */
@@ -14,9 +12,12 @@
 #undef USE_PANIC_ON_PHOTO_ALLOC_FAILURE
 #endif
 
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <cairo.h>
 #include <cairo-xlib.h>
 #include <tkUnixInt.h>
+#include <X11/extensions/XShm.h>
 #include "tkIntPath.h"
 
 #define TINT_INT_CALCULATION
@@ -51,6 +52,47 @@ typedef struct PathSurfaceCairoRecord {
     int stride; /* number of bytes between the start of rows in the buffer */
 } PathSurfaceCairoRecord;
 
+/*
+ * Shared memory segments for client side images, one per main window. A
+ * segment is kept from one redisplay to the next and only replaced when a
+ * larger image is needed. Each image gets its own XImage header pointing
+ * into it. It is detached and freed when its main window is destroyed,
+ * while the display is still open. A main window belongs to one thread,
+ * but the list of segments is shared and protected by shmMutex.
+ */
+typedef struct PathShmSegment {
+    Tk_Window mainWin;		/* Main window the segment belongs to, NULL
+				 * once it is destroyed. */
+    Display *display;		/* Display the segment is attached to. */
+    XShmSegmentInfo info;
+    size_t size;		/* Size in bytes, 0 if no segment. */
+    int broken;			/* Non-zero if MIT-SHM failed on display,
+				 * e.g. since it is a remote one. It is not
+				 * tried again. */
+    int inUse;			/* Non-zero while an image is in it. */
+    struct PathShmSegment *nextPtr;
+} PathShmSegment;
+
+static PathShmSegment *shmSegments = NULL;
+TCL_DECLARE_MUTEX(shmMutex)
+
+/*
+ * Client side image that a context made by TkPathInitImage renders into,
+ * and the area of the drawable it stands for. The image is in a shared
+ * memory segment when the MIT-SHM extension can be used.
+ */
+typedef struct PathImageTarget {
+    Display *display;
+    Drawable drawable;
+    GC gc;
+    XImage *ximage;
+    int x, y;			/* Area of drawable covered by ximage. */
+    int width, height;
+    PathShmSegment *shmPtr;	/* Segment holding ximage->data, or NULL if
+				 * it is not shared. */
+    cairo_format_t format;	/* Pixel format of ximage for cairo. */
+} PathImageTarget;
+
 /*
  * This is used as a place holder for platform dependent
  * stuff between each call.
@@ -60,13 +102,19 @@ typedef struct TkPathContext_ {
     cairo_surface_t* surface;
     PathSurfaceCairoRecord* record;     /* NULL except for memory surfaces.
 					 * Skip when cairo 1.2 widely spread. */
+    PathImageTarget *target;	/* NULL except for TkPathInitImage. */
     int             widthCode;  /* Used to depixelize the strokes:
 				 * 0: not integer width
 				 * 1: odd integer width
 				 * 2: even integer width */
+    int		    keepPath;	/* Set by TkPathKeepPath. */
 } TkPathContext_;
 
 static void TkPathPrepareForStroke(TkPathContext ctx, Tk_PathStyle *style);
+static void FreeShmSegment(PathShmSegment *segPtr);
+static void ReleaseShmSegment(PathShmSegment *segPtr);
+static void ShmMainWindowEventProc(ClientData clientData,
+		    XEvent *eventPtr);
 
 static void
 CairoSetFill(TkPathContext ctx, Tk_PathStyle *style)
@@ -104,6 +152,8 @@ TkPathInit(Tk_Window tkwin, Drawable d)
     context->c = c;
     context->surface = surface;
     context->record = NULL;
+    context->target = NULL;
+    context->keepPath = 0;
     context->widthCode = 0;
     return (TkPathContext) context;
 }
@@ -141,9 +191,551 @@ TkPathInitSurface(Display *display, int width, int height)
     context->c = c;
     context->surface = surface;
     context->record = record;
+    context->target = NULL;
+    context->keepPath = 0;
+    return (TkPathContext) context;
+}
+
+static int
+ImageErrorProc(
+    ClientData clientData,
+    XErrorEvent *errEventPtr)
+{
+    *((int *) clientData) = 1;
+    return 0;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetShmSegment --
+ *
+ *	Finds the shared memory segment used for client side images of
+ *	the main window of tkwin and makes sure it holds at least size
+ *	bytes.
+ *
+ * Results:
+ *	The segment, or NULL if MIT-SHM can't be used on the display or the
+ *	segment is already in use. Give it back with ReleaseShmSegment.
+ *
+ * Side effects:
+ *	May detach the old segment and create, attach a new one. If that
+ *	fails the main window never tries again. The first call for a main
+ *	window sets up an event handler that frees the segment when it is
+ *	destroyed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PathShmSegment *
+GetShmSegment(
+    Tk_Window tkwin,
+    size_t size)
+{
+    Display *display = Tk_Display(tkwin);
+    Tk_Window mainWin = tkwin;
+    PathShmSegment *segPtr;
+    Tk_ErrorHandler handler;
+    int failed = 0;
+    int shmid;
+    char *addr;
+
+    while (Tk_Parent(mainWin) != NULL) {
+	mainWin = Tk_Parent(mainWin);
+    }
+    Tcl_MutexLock(&shmMutex);
+    for (segPtr = shmSegments; segPtr != NULL; segPtr = segPtr->nextPtr) {
+	if (segPtr->mainWin == mainWin) {
+	    break;
+	}
+    }
+    if (segPtr == NULL) {
+	segPtr = (PathShmSegment *) ckalloc(sizeof(PathShmSegment));
+	segPtr->mainWin = mainWin;
+	segPtr->display = display;
+	segPtr->size = 0;
+	segPtr->broken = 0;
+	segPtr->inUse = 0;
+	segPtr->nextPtr = shmSegments;
+	shmSegments = segPtr;
+	Tk_CreateEventHandler(mainWin, StructureNotifyMask,
+		ShmMainWindowEventProc, (ClientData) segPtr);
+    }
+    if (segPtr->broken || segPtr->inUse) {
+	Tcl_MutexUnlock(&shmMutex);
+	return NULL;
+    }
+    segPtr->inUse = 1;
+    Tcl_MutexUnlock(&shmMutex);
+
+    if (segPtr->size >= size) {
+	return segPtr;
+    }
+    if (segPtr->size > 0) {
+	/*
+	 * The server must be done with the old segment before it goes.
+	 */
+
+	XShmDetach(display, &segPtr->info);
+	XSync(display, False);
+	shmdt(segPtr->info.shmaddr);
+	segPtr->size = 0;
+    }
+    segPtr->broken = 1;
+    if (!XShmQueryExtension(display)) {
+	goto error;
+    }
+    shmid = shmget(IPC_PRIVATE, size, IPC_CREAT|0600);
+    if (shmid < 0) {
+	goto error;
+    }
+    addr = (char *) shmat(shmid, NULL, 0);
+    if (addr == (char *) -1) {
+	shmctl(shmid, IPC_RMID, NULL);
+	goto error;
+    }
+    segPtr->info.shmid = shmid;
+    segPtr->info.shmaddr = addr;
+    segPtr->info.readOnly = False;
+    handler = Tk_CreateErrorHandler(display, -1, -1, -1, ImageErrorProc,
+	    (ClientData) &failed);
+    XShmAttach(display, &segPtr->info);
+    XSync(display, False);
+    Tk_DeleteErrorHandler(handler);
+
+    /*
+     * Once both sides are attached the segment can be marked for removal,
+     * it then goes away with the process even if we never free it.
+     */
+
+    shmctl(shmid, IPC_RMID, NULL);
+    if (failed) {
+	shmdt(addr);
+	goto error;
+    }
+    segPtr->size = size;
+    segPtr->broken = 0;
+    return segPtr;
+
+  error:
+    ReleaseShmSegment(segPtr);
+    return NULL;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ReleaseShmSegment --
+ *
+ *	Gives back a segment from GetShmSegment once the image in it has
+ *	been put to the drawable.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The segment can be used for the next image.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ReleaseShmSegment(
+    PathShmSegment *segPtr)
+{
+    int orphaned;
+
+    Tcl_MutexLock(&shmMutex);
+    segPtr->inUse = 0;
+    orphaned = (segPtr->mainWin == NULL);
+    Tcl_MutexUnlock(&shmMutex);
+    if (orphaned) {
+	FreeShmSegment(segPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * ShmMainWindowEventProc --
+ *
+ *	Frees the segment of a main window when it is destroyed. If an
+ *	image is still in the segment, ReleaseShmSegment frees it later.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	The segment is unlinked from the list and maybe freed.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+ShmMainWindowEventProc(
+    ClientData clientData,
+    XEvent *eventPtr)
+{
+    PathShmSegment *segPtr = (PathShmSegment *) clientData;
+    PathShmSegment **prevPtrPtr;
+    int inUse;
+
+    if (eventPtr->type != DestroyNotify) {
+	return;
+    }
+    Tcl_MutexLock(&shmMutex);
+    for (prevPtrPtr = &shmSegments; *prevPtrPtr != NULL;
+	    prevPtrPtr = &(*prevPtrPtr)->nextPtr) {
+	if (*prevPtrPtr == segPtr) {
+	    *prevPtrPtr = segPtr->nextPtr;
+	    break;
+	}
+    }
+    segPtr->mainWin = NULL;
+    inUse = segPtr->inUse;
+    Tcl_MutexUnlock(&shmMutex);
+    if (!inUse) {
+	FreeShmSegment(segPtr);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * FreeShmSegment --
+ *
+ *	Detaches a segment that is no longer in the list from the X server
+ *	and this process and frees it.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	One round trip to the X server if the segment was attached.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+FreeShmSegment(
+    PathShmSegment *segPtr)
+{
+    if (segPtr->size > 0) {
+	XShmDetach(segPtr->display, &segPtr->info);
+	XSync(segPtr->display, False);
+	shmdt(segPtr->info.shmaddr);
+    }
+    ckfree((char *) segPtr);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathInitImage --
+ *
+ *	Makes a context that renders into a client side image of the area
+ *	rectPtr of the drawable d instead of sending every primitive to the
+ *	X server. The image starts with the pixels of the drawable and is
+ *	put back by TkPathFlushImage. It uses MIT-SHM if available. The
+ *	coordinates are those of the drawable.
+ *
+ * Results:
+ *	The new context or 0 if the visual has no pixel format that cairo
+ *	can render into directly. Then the caller must use TkPathInit.
+ *
+ * Side effects:
+ *	Reads the pixels of the area from the X server.
+ *
+ *----------------------------------------------------------------------
+ */
+
+TkPathContext
+TkPathInitImage(Tk_Window tkwin, Drawable d, PathRect *rectPtr)
+{
+    Display *display = Tk_Display(tkwin);
+    Visual *visual = Tk_Visual(tkwin);
+    int depth = Tk_Depth(tkwin);
+    TkPathContext_ *context;
+    PathImageTarget *target;
+    XImage *ximage = NULL;
+    Tk_ErrorHandler handler;
+    cairo_format_t format;
+    cairo_surface_t *surface;
+    PathShmSegment *segPtr;
+    int x, y, width, height, failed = 0;
+
+    if ((visual->red_mask != 0xFF0000) || (visual->green_mask != 0xFF00)
+	    || (visual->blue_mask != 0xFF)) {
+	return 0;
+    }
+    if (depth == 32) {
+	format = CAIRO_FORMAT_ARGB32;
+    } else if (depth == 24) {
+	format = CAIRO_FORMAT_RGB24;
+    } else {
+	return 0;
+    }
+    x = (int) floor(rectPtr->x1);
+    y = (int) floor(rectPtr->y1);
+    width = (int) ceil(rectPtr->x2) - x;
+    height = (int) ceil(rectPtr->y2) - y;
+    if ((width <= 0) || (height <= 0)) {
+	return 0;
+    }
+
+    /*
+     * Reading back can fail if d is a window that isn't viewable; just let
+     * the caller draw the usual way then.
+     */
+
+    handler = Tk_CreateErrorHandler(display, -1, -1, -1, ImageErrorProc,
+	    (ClientData) &failed);
+    segPtr = GetShmSegment(tkwin, (size_t) 4*width*height);
+    if (segPtr != NULL) {
+	ximage = XShmCreateImage(display, visual, depth, ZPixmap,
+		segPtr->info.shmaddr, &segPtr->info, width, height);
+	if (ximage != NULL) {
+	    if ((ximage->bytes_per_line*height > (int) segPtr->size)
+		    || !XShmGetImage(display, d, ximage, x, y, AllPlanes)) {
+		ximage->data = NULL;
+		XDestroyImage(ximage);
+		ximage = NULL;
+	    }
+	}
+	if (ximage == NULL) {
+	    ReleaseShmSegment(segPtr);
+	    segPtr = NULL;
+	}
+    }
+    if (ximage == NULL) {
+	failed = 0;
+	ximage = XGetImage(display, d, x, y, width, height, AllPlanes,
+		ZPixmap);
+    }
+    Tk_DeleteErrorHandler(handler);
+    if (ximage == NULL) {
+	return 0;
+    }
+    if (!kEndianess.set) {
+	kEndianess.set = 1;
+    }
+    if (failed || (ximage->bits_per_pixel != 32)
+	    || (ximage->bytes_per_line % 4 != 0)
+	    || (ximage->byte_order
+		!= (kEndianess.little ? LSBFirst : MSBFirst))) {
+	if (segPtr != NULL) {
+	    ximage->data = NULL;
+	    ReleaseShmSegment(segPtr);
+	}
+	XDestroyImage(ximage);
+	return 0;
+    }
+
+    surface = cairo_image_surface_create_for_data(
+	    (unsigned char *) ximage->data, format, width, height,
+	    ximage->bytes_per_line);
+    cairo_surface_set_device_offset(surface, -x, -y);
+    target = (PathImageTarget *) ckalloc(sizeof(PathImageTarget));
+    target->display = display;
+    target->drawable = d;
+    target->gc = XCreateGC(display, d, 0, NULL);
+    target->ximage = ximage;
+    target->x = x;
+    target->y = y;
+    target->width = width;
+    target->height = height;
+    target->shmPtr = segPtr;
+    target->format = format;
+    context = (TkPathContext_ *) ckalloc((unsigned) sizeof(TkPathContext_));
+    context->c = cairo_create(surface);
+    context->surface = surface;
+    context->record = NULL;
+    context->target = target;
+    context->keepPath = 0;
+    context->widthCode = 0;
     return (TkPathContext) context;
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * ClipToImage --
+ *
+ *	Intersects an area of the drawable with the area a context from
+ *	TkPathInitImage covers.
+ *
+ * Results:
+ *	The intersection in drawable pixels, or 0 if it is empty.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+ClipToImage(
+    PathImageTarget *target,
+    PathRect *rectPtr,
+    XRectangle *clipPtr)
+{
+    int x1 = target->x, y1 = target->y;
+    int x2 = target->x + target->width, y2 = target->y + target->height;
+
+    if (rectPtr != NULL) {
+	x1 = MAX(x1, (int) floor(rectPtr->x1));
+	y1 = MAX(y1, (int) floor(rectPtr->y1));
+	x2 = MIN(x2, (int) ceil(rectPtr->x2));
+	y2 = MIN(y2, (int) ceil(rectPtr->y2));
+    }
+    if ((x1 >= x2) || (y1 >= y2)) {
+	return 0;
+    }
+    clipPtr->x = x1;
+    clipPtr->y = y1;
+    clipPtr->width = x2 - x1;
+    clipPtr->height = y2 - y1;
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathFlushImage --
+ *
+ *	Puts the pixels rendered into a context from TkPathInitImage back
+ *	to its drawable, all of them if rectPtr is NULL or else those in
+ *	the area rectPtr of the drawable. Other contexts draw directly and
+ *	are left alone. Rendering may go on after an area was put only
+ *	once TkPathReloadImage read it back.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	One XShmPutImage or XPutImage request.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathFlushImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    PathImageTarget *target = context->target;
+    XRectangle area;
+
+    if ((target == NULL) || !ClipToImage(target, rectPtr, &area)) {
+	return;
+    }
+    cairo_surface_flush(context->surface);
+    if (target->shmPtr != NULL) {
+	XShmPutImage(target->display, target->drawable, target->gc,
+		target->ximage, area.x - target->x, area.y - target->y,
+		area.x, area.y, area.width, area.height, False);
+    } else {
+	XPutImage(target->display, target->drawable, target->gc,
+		target->ximage, area.x - target->x, area.y - target->y,
+		area.x, area.y, area.width, area.height);
+    }
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathReloadImage --
+ *
+ *	Reads the area rectPtr of the drawable back into a context from
+ *	TkPathInitImage after something else drew there, so that only this
+ *	area and not the whole image has to be read again. Other contexts
+ *	are left alone.
+ *
+ * Results:
+ *	1 if done, 0 if the pixels could not be read. The image then still
+ *	holds what it had before.
+ *
+ * Side effects:
+ *	One XGetImage round trip; the server is then also done with any
+ *	XShmPutImage of the segment sent before.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkPathReloadImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    PathImageTarget *target = context->target;
+    XImage *ximage;
+    XRectangle area;
+    Tk_ErrorHandler handler;
+    int failed = 0;
+    int i;
+
+    if ((target == NULL) || !ClipToImage(target, rectPtr, &area)) {
+	return 1;
+    }
+    handler = Tk_CreateErrorHandler(target->display, -1, -1, -1,
+	    ImageErrorProc, (ClientData) &failed);
+    ximage = XGetImage(target->display, target->drawable, area.x, area.y,
+	    area.width, area.height, AllPlanes, ZPixmap);
+    Tk_DeleteErrorHandler(handler);
+    if (ximage == NULL) {
+	return 0;
+    }
+    if (failed || (ximage->bits_per_pixel != 32)
+	    || (ximage->byte_order != target->ximage->byte_order)) {
+	XDestroyImage(ximage);
+	return 0;
+    }
+    cairo_surface_flush(context->surface);
+    for (i = 0; i < area.height; i++) {
+	memcpy(target->ximage->data
+		+ (area.y - target->y + i) * target->ximage->bytes_per_line
+		+ 4 * (area.x - target->x),
+		ximage->data + i * ximage->bytes_per_line,
+		(size_t) 4 * area.width);
+    }
+    cairo_surface_mark_dirty(context->surface);
+    XDestroyImage(ximage);
+    return 1;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathDrawSurface --
+ *
+ *	Composites the pixels of a context from TkPathInitSurface into
+ *	another context with its top left corner at x, y.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Drawing.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkPathCanDrawSurface(void)
+{
+    return 1;
+}
+
+void
+TkPathDrawSurface(TkPathContext ctx, TkPathContext surface, double x,
+    double y)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    TkPathContext_ *source = (TkPathContext_ *) surface;
+
+    cairo_surface_flush(source->surface);
+    cairo_set_source_surface(context->c, source->surface, x, y);
+    cairo_paint(context->c);
+}
+
 void
 TkPathPushTMatrix(TkPathContext ctx, TMatrix *m)
 {
@@ -170,13 +762,77 @@ TkPathRestoreState(TkPathContext ctx)
     cairo_restore(context->c);
 }
 
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathKeepPath --
+ *
+ *	While keep is set TkPathBeginPath adds to the current path instead
+ *	of discarding it, so that several paths can be painted at once.
+ *	The path is kept in device space by cairo and is not affected by
+ *	TkPathSaveState, TkPathRestoreState or the matrix.
+ *
+ * Results:
+ *	1 since this is supported.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+int
+TkPathKeepPath(TkPathContext ctx, int keep)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+    context->keepPath = keep;
+    return 1;
+}
+
+/*
+ * The copy is in user space, so it must be appended with the same CTM
+ * as it was copied with.
+ */
+
+void *
+TkPathCopyPath(TkPathContext ctx)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    cairo_path_t *path = cairo_copy_path(context->c);
+
+    if (path->status != CAIRO_STATUS_SUCCESS) {
+	cairo_path_destroy(path);
+	return NULL;
+    }
+    return (void *) path;
+}
+
+void
+TkPathAppendPath(TkPathContext ctx, void *pathPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+    cairo_append_path(context->c, (cairo_path_t *) pathPtr);
+}
+
+void
+TkPathFreeCopiedPath(void *pathPtr)
+{
+    cairo_path_destroy((cairo_path_t *) pathPtr);
+}
+
 void
 TkPathBeginPath(TkPathContext ctx, Tk_PathStyle *style)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
     int nint;
     double width;
-    cairo_new_path(context->c);
+    if (context->keepPath) {
+	cairo_new_sub_path(context->c);
+    } else {
+	cairo_new_path(context->c);
+    }
     if (style->strokeColor == NULL) {
 	context->widthCode = 0;
     } else {
@@ -307,15 +963,52 @@ convertInterpolationToCairoFilter(int interpolation)
     }
 }
 
-void
-TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
-    double x, double y, double width0, double height0, double fillOpacity,
-    XColor *tintColor, double tintAmount, int interpolation,
-    PathRect *srcRegion)
-{
-    TkPathContext_ *context = (TkPathContext_ *) ctx;
-    Tk_PhotoImageBlock block;
+/*
+ * A rectangle of photo pixels.
+ */
+typedef struct PathImageRect {
+    int x1, y1, x2, y2;
+} PathImageRect;
+
+/*
+ * The converted photo kept between draws of a pimage item, see TkPathImage.
+ * The key is what the conversion depends on besides the photo's pixels,
+ * which are watched by the item's image changed proc.
+ */
+typedef struct PathImageCache {
     cairo_surface_t *surface;
+    unsigned char *data;	/* Pixels of surface. */
+    PathImageRect rect;		/* Part of the photo that surface holds. */
+    Tk_PhotoHandle photo;
+    int width, height;
+    int tinted;			/* Nonzero if tint values below apply. */
+    unsigned short tintRed, tintGreen, tintBlue;
+    double tintAmount;
+} PathImageCache;
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PhotoToSurface --
+ *
+ *	Converts the pixels of a photo block to a cairo image surface in
+ *	premultiplied native endian ARGB, tinting them if requested.
+ *
+ * Results:
+ *	The surface or NULL if the pixel format isn't supported. The pixel
+ *	buffer is returned in dataPtr and must be ckfree'd after the
+ *	surface is destroyed.
+ *
+ * Side effects:
+ *	Memory allocated.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static cairo_surface_t *
+PhotoToSurface(Tk_PhotoImageBlock *blockPtr, XColor *tintColor,
+    double tintAmount, unsigned char **dataPtr)
+{
     cairo_format_t format;
     unsigned char *data = NULL;
     unsigned char *ptr = NULL;
@@ -325,36 +1018,12 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
     int pitch;
     int iwidth, iheight;
     int i, j;
-    double width, height;
-    cairo_filter_t filter;
 
-    /* Return value? */
-    Tk_PhotoGetImage(photo, &block);
-    iwidth = block.width;
-    iheight = block.height;
-    pitch = block.pitch;
-    width = (width0 == 0.0) ? (double) iwidth : width0;
-    height = (height0 == 0.0) ? (double) iheight : height0;
-
-    /*
-     * @format: the format of pixels in the buffer
-     * @width: the width of the image to be stored in the buffer
-     * @height: the eight of the image to be stored in the buffer
-     * @stride: the number of bytes between the start of rows
-     *   in the buffer. Having this be specified separate from @width
-     *   allows for padding at the end of rows, or for writing
-     *   to a subportion of a larger image.
-     */
+    iwidth = blockPtr->width;
+    iheight = blockPtr->height;
+    pitch = blockPtr->pitch;
 
-    /*
-     * cairo_format_t
-     * @CAIRO_FORMAT_ARGB32: each pixel is a 32-bit quantity, with
-     *   alpha in the upper 8 bits, then red, then green, then blue.
-     *   The 32-bit quantities are stored native-endian. Pre-multiplied
-     *   alpha is used. (That is, 50% transparent red is 0x80800000,
-     *   not 0x80ff0000.)
-     */
-    if (block.pixelSize == 4) {
+    if (blockPtr->pixelSize == 4) {
 	format = CAIRO_FORMAT_ARGB32;
 
 	/*
@@ -365,10 +1034,10 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 	 * We need to copy pixel data from the source using the photo offsets
 	 * to cairos ARGB format which is in *native* endian order; Switch!
 	 */
-	srcR = block.offset[0];
-	srcG = block.offset[1];
-	srcB = block.offset[2];
-	srcA = block.offset[3];
+	srcR = blockPtr->offset[0];
+	srcG = blockPtr->offset[1];
+	srcB = blockPtr->offset[2];
+	srcA = blockPtr->offset[3];
 	dstR = 1;
 	dstG = 2;
 	dstB = 3;
@@ -396,7 +1065,7 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 	    tintB = Blue255FromXColorPtr(tintColor);
 
 	    for (i = 0; i < iheight; i++) {
-		srcPtr = block.pixelPtr + i*pitch;
+		srcPtr = blockPtr->pixelPtr + i*pitch;
 		dstPtr = ptr + i*pitch;
 		for (j = 0; j < iwidth; j++) {
 		    /* extract */
@@ -442,7 +1111,7 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 	    tintB = BlueDoubleFromXColorPtr(tintColor);
 
 	    for (i = 0; i < iheight; i++) {
-		srcPtr = block.pixelPtr + i*pitch;
+		srcPtr = blockPtr->pixelPtr + i*pitch;
 		dstPtr = ptr + i*pitch;
 		for (j = 0; j < iwidth; j++) {
 		    /* extract */
@@ -479,9 +1148,14 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 		}
 	    }
 #endif
+	} else if ((dstB == 0) && (srcR == 0) && (srcG == 1) && (srcB == 2)
+		&& (srcA == 3)) {
+	    /* The usual photo layout to little endian cairo. */
+	    PathCopyBitsToPremultipliedAlphaBGRA(blockPtr->pixelPtr, ptr,
+		    iwidth, iheight, pitch);
 	} else {
 	    for (i = 0; i < iheight; i++) {
-		srcPtr = block.pixelPtr + i*pitch;
+		srcPtr = blockPtr->pixelPtr + i*pitch;
 		dstPtr = ptr + i*pitch;
 		for (j = 0; j < iwidth; j++) {
 		    unsigned int alpha = *(srcPtr+srcA);
@@ -501,38 +1175,241 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 		}
 	    }
 	}
-    } else if (block.pixelSize == 3) {
+    } else if (blockPtr->pixelSize == 3) {
 	/* Could do something about this? */
 	fprintf(stderr,
 	    "TkPathImage: unaccepted pixel format: 1 pixel is 3 bytes\n");
-	return;
+	return NULL;
     } else {
 	fprintf(stderr,
 	    "TkPathImage: unaccepted pixel format: 1 pixel is %d bytes\n",
-	    block.pixelSize);
-	return;
+	    blockPtr->pixelSize);
+	return NULL;
     }
-    surface = cairo_image_surface_create_for_data(ptr, format,
+    *dataPtr = data;
+    return cairo_image_surface_create_for_data(ptr, format,
 	    (int) iwidth, (int) iheight, pitch); /* stride */
+}
 
-    filter = convertInterpolationToCairoFilter(interpolation);
-    if (width == (double)iwidth && height == (double)iheight && !srcRegion) {
-	cairo_set_source_surface(context->c, surface, x, y);
-	cairo_pattern_set_filter(cairo_get_source(context->c), filter);
-	cairo_paint_with_alpha(context->c, fillOpacity);
-    } else if (srcRegion) {
-	/* crop x0, y0 positions: */
-	int xcrop = srcRegion->x1;
-	int ycrop = srcRegion->y1;
-	double xscale, yscale, xoffs, yoffs;
-	cairo_matrix_t matrix;
-	cairo_pattern_t *pattern;
+static int
+ImageCacheMatches(PathImageCache *cachePtr, Tk_PhotoHandle photo,
+    Tk_PhotoImageBlock *blockPtr, XColor *tintColor, double tintAmount)
+{
+    int tinted = (tintColor && tintAmount > 0.0);
+
+    if ((cachePtr->photo != photo) || (cachePtr->width != blockPtr->width)
+	    || (cachePtr->height != blockPtr->height)
+	    || (cachePtr->tinted != tinted)) {
+	return 0;
+    }
+    return !tinted || ((cachePtr->tintRed == tintColor->red)
+	    && (cachePtr->tintGreen == tintColor->green)
+	    && (cachePtr->tintBlue == tintColor->blue)
+	    && (cachePtr->tintAmount == tintAmount));
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * VisibleImageRect --
+ *
+ *	Finds the photo pixels that may show through the current clip when
+ *	pixel (originX, originY) of the photo is drawn at user point (x, y)
+ *	with scaleX by scaleY photo pixels per user unit. A margin is added
+ *	for the filter, and the result is limited to boundsPtr.
+ *
+ * Results:
+ *	0 if no pixel is visible, else 1 and the pixels in rectPtr.
+ *
+ * Side effects:
+ *	None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static int
+VisibleImageRect(cairo_t *c, double x, double y, double originX,
+    double originY, double scaleX, double scaleY, PathImageRect *boundsPtr,
+    PathImageRect *rectPtr)
+{
+    double ux1, uy1, ux2, uy2;
+    double dx, dy, userPerDevice;
+    int margin;
+
+    *rectPtr = *boundsPtr;
+    if (!(scaleX > 0.0) || !(scaleY > 0.0)) {
+	return (rectPtr->x1 < rectPtr->x2) && (rectPtr->y1 < rectPtr->y2);
+    }
+    cairo_clip_extents(c, &ux1, &uy1, &ux2, &uy2);
 
+    /*
+     * A filter reads a pixel or two around each device pixel.
+     */
+    dx = 1.0, dy = 0.0;
+    cairo_device_to_user_distance(c, &dx, &dy);
+    userPerDevice = hypot(dx, dy);
+    dx = 0.0, dy = 1.0;
+    cairo_device_to_user_distance(c, &dx, &dy);
+    userPerDevice = MAX(userPerDevice, hypot(dx, dy));
+    margin = 2 + (int) ceil(2.0*userPerDevice*MAX(scaleX, scaleY));
+
+    rectPtr->x1 = MAX(rectPtr->x1,
+	    (int) floor(originX + (ux1 - x)*scaleX) - margin);
+    rectPtr->y1 = MAX(rectPtr->y1,
+	    (int) floor(originY + (uy1 - y)*scaleY) - margin);
+    rectPtr->x2 = MIN(rectPtr->x2,
+	    (int) ceil(originX + (ux2 - x)*scaleX) + margin);
+    rectPtr->y2 = MIN(rectPtr->y2,
+	    (int) ceil(originY + (uy2 - y)*scaleY) + margin);
+    return (rectPtr->x1 < rectPtr->x2) && (rectPtr->y1 < rectPtr->y2);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * TkPathImage --
+ *
+ *	Draws a photo. Only the part of the photo inside srcRegion that
+ *	may show through the current clip is converted. If customPtr is
+ *	not NULL the converted part is kept there and reused as long as
+ *	the photo and tint are the same and no other part is needed.
+ *	The caller must release it with TkPathImageFree when the photo's
+ *	pixels change.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	May allocate memory for the cache in customPtr.
+ *
+ *----------------------------------------------------------------------
+ */
+
+void
+TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
+    double x, double y, double width0, double height0, double fillOpacity,
+    XColor *tintColor, double tintAmount, int interpolation,
+    PathRect *srcRegion, void **customPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    Tk_PhotoImageBlock block, part;
+    cairo_surface_t *surface;
+    unsigned char *data = NULL;
+    PathImageCache *cachePtr = NULL;
+    PathImageRect bounds, rect;
+    int iwidth, iheight;
+    int xcrop = 0, ycrop = 0;
+    double width, height;
+    double xscale, yscale;
+    cairo_filter_t filter;
+
+    /* Return value? */
+    Tk_PhotoGetImage(photo, &block);
+    iwidth = block.width;
+    iheight = block.height;
+    width = (width0 == 0.0) ? (double) iwidth : width0;
+    height = (height0 == 0.0) ? (double) iheight : height0;
+
+    /*
+     * Find the photo pixels needed. A margin around srcRegion keeps
+     * the filtering at its edges as it was with the whole photo.
+     */
+    bounds.x1 = bounds.y1 = 0;
+    bounds.x2 = iwidth;
+    bounds.y2 = iheight;
+    if (srcRegion) {
+	/* crop x0, y0 positions: */
+	xcrop = srcRegion->x1;
+	ycrop = srcRegion->y1;
 	width = (width0 == 0.0) ? srcRegion->x2 - srcRegion->x1 : width0;
 	height = (height0 == 0.0) ? srcRegion->y2 - srcRegion->y1 : height0;
 	/* scale image: */
 	xscale = width / (srcRegion->x2 - srcRegion->x1);
 	yscale = height / (srcRegion->y2 - srcRegion->y1);
+	bounds.x1 = MAX(bounds.x1, (int) floor(srcRegion->x1) - 2);
+	bounds.y1 = MAX(bounds.y1, (int) floor(srcRegion->y1) - 2);
+	bounds.x2 = MIN(bounds.x2, (int) ceil(srcRegion->x2) + 2);
+	bounds.y2 = MIN(bounds.y2, (int) ceil(srcRegion->y2) + 2);
+    } else {
+	xscale = width / iwidth;
+	yscale = height / iheight;
+    }
+    if (!VisibleImageRect(context->c, x, y, xcrop, ycrop, 1.0/xscale,
+	    1.0/yscale, &bounds, &rect)) {
+	return;
+    }
+
+    if (customPtr != NULL) {
+	cachePtr = (PathImageCache *) *customPtr;
+	if ((cachePtr != NULL) && ImageCacheMatches(cachePtr, photo,
+		&block, tintColor, tintAmount)) {
+	    if ((rect.x1 < cachePtr->rect.x1) || (rect.y1 < cachePtr->rect.y1)
+		    || (rect.x2 > cachePtr->rect.x2)
+		    || (rect.y2 > cachePtr->rect.y2)) {
+		/*
+		 * Grow the cache to hold both parts so that scrolling
+		 * around converts each pixel only once.
+		 */
+		rect.x1 = MIN(rect.x1, cachePtr->rect.x1);
+		rect.y1 = MIN(rect.y1, cachePtr->rect.y1);
+		rect.x2 = MAX(rect.x2, cachePtr->rect.x2);
+		rect.y2 = MAX(rect.y2, cachePtr->rect.y2);
+		TkPathImageFree(cachePtr);
+		*customPtr = cachePtr = NULL;
+	    }
+	} else if (cachePtr != NULL) {
+	    TkPathImageFree(cachePtr);
+	    *customPtr = cachePtr = NULL;
+	}
+    }
+    if (cachePtr != NULL) {
+	surface = cachePtr->surface;
+	rect = cachePtr->rect;
+    } else {
+	/*
+	 * The part keeps the photo's pitch, also for the converted pixels.
+	 */
+	part = block;
+	part.pixelPtr += rect.y1*block.pitch + rect.x1*block.pixelSize;
+	part.width = rect.x2 - rect.x1;
+	part.height = rect.y2 - rect.y1;
+	surface = PhotoToSurface(&part, tintColor, tintAmount, &data);
+	if (surface == NULL) {
+	    return;
+	}
+	if (customPtr != NULL) {
+	    cachePtr = (PathImageCache *) ckalloc(sizeof(PathImageCache));
+	    cachePtr->surface = surface;
+	    cachePtr->data = data;
+	    cachePtr->rect = rect;
+	    cachePtr->photo = photo;
+	    cachePtr->width = iwidth;
+	    cachePtr->height = iheight;
+	    cachePtr->tinted = (tintColor && tintAmount > 0.0);
+	    if (cachePtr->tinted) {
+		cachePtr->tintRed = tintColor->red;
+		cachePtr->tintGreen = tintColor->green;
+		cachePtr->tintBlue = tintColor->blue;
+		cachePtr->tintAmount = tintAmount;
+	    }
+	    *customPtr = cachePtr;
+	}
+    }
+
+    /*
+     * The surface starts at photo pixel (rect.x1, rect.y1).
+     */
+    filter = convertInterpolationToCairoFilter(interpolation);
+    if (width == (double)iwidth && height == (double)iheight && !srcRegion) {
+	cairo_set_source_surface(context->c, surface, x + rect.x1,
+		y + rect.y1);
+	cairo_pattern_set_filter(cairo_get_source(context->c), filter);
+	cairo_paint_with_alpha(context->c, fillOpacity);
+    } else if (srcRegion) {
+	double xoffs, yoffs;
+	cairo_matrix_t matrix;
+	cairo_pattern_t *pattern;
+
 	xoffs = xcrop*xscale;
 	yoffs = ycrop*yscale;
 
@@ -542,6 +1419,8 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 	cairo_translate(context->c, (x-xoffs), (y-yoffs));
 
 	cairo_matrix_init_scale(&matrix, 1.0/xscale, 1.0/yscale);
+	matrix.x0 = -rect.x1;
+	matrix.y0 = -rect.y1;
 	cairo_pattern_set_matrix(pattern, &matrix);
 
 	cairo_set_source(context->c, pattern);
@@ -555,14 +1434,26 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
 	cairo_save(context->c);
 	cairo_translate(context->c, x, y);
 	cairo_scale(context->c, width/iwidth, height/iheight);
-	cairo_set_source_surface(context->c, surface, 0, 0);
+	cairo_set_source_surface(context->c, surface, rect.x1, rect.y1);
 	cairo_pattern_set_filter(cairo_get_source(context->c), filter);
 	cairo_paint_with_alpha(context->c, fillOpacity);
 	cairo_restore(context->c);
     }
-    cairo_surface_destroy(surface);
-    if (data) {
-	ckfree((char *)data);
+    if (cachePtr == NULL) {
+	cairo_surface_destroy(surface);
+	ckfree((char *) data);
+    }
+}
+
+void
+TkPathImageFree(void *custom)
+{
+    PathImageCache *cachePtr = (PathImageCache *) custom;
+
+    if (cachePtr != NULL) {
+	cairo_surface_destroy(cachePtr->surface);
+	ckfree((char *) cachePtr->data);
+	ckfree((char *) cachePtr);
     }
 }
 
@@ -573,12 +1464,52 @@ TkPathClosePath(TkPathContext ctx)
     cairo_close_path(context->c);
 }
 
-int
-TkPathTextConfig(Tcl_Interp *interp, Tk_PathTextStyle *textStylePtr,
-		 char *utf8, void **customPtr)
-{
-    return TCL_OK;
-}
+/*
+ * Text is drawn from glyphs: each ptext keeps a layout of its string as its
+ * custom record. Measuring needs no surface: it uses a scaled font of the
+ * style with an untransformed matrix, which is shared between all texts
+ * with the same style. These fonts are looked up by
+ * "family|size|weight|slant" and freed when the last layout using them is
+ * freed. The table is protected by fontMutex since layouts may be freed
+ * from any interpreter thread.
+ *
+ * The metrics are also kept in metricsTable, keyed by the font key and the
+ * string, so that texts with the same string and style are measured only
+ * once. That table is emptied when it reaches PATH_MAX_METRICS entries.
+ *
+ * Drawing uses the scaled font that cairo picks for the context, which
+ * depends on its current matrix and on the font options of its surface,
+ * so that advances and hinting are right for a scaled or rotated text.
+ * The glyphs are made for that font when the text is first drawn and kept
+ * in the layout until it is drawn with another one.
+ */
+
+#define PATH_MAX_METRICS 4096
+
+typedef struct PathCairoFont {
+    cairo_font_face_t *face;
+    cairo_scaled_font_t *scaledFont;
+    cairo_font_extents_t extents;
+    int refCount;		/* Number of layouts using the font. */
+    Tcl_HashEntry *hPtr;	/* Entry in fontTable. */
+} PathCairoFont;
+
+typedef struct PathTextLayout {
+    PathCairoFont *fontPtr;	/* Font the text is measured with. */
+    PathRect bbox;		/* Same as TkPathTextMeasureBbox. */
+    cairo_scaled_font_t *glyphFont;
+				/* Font the glyphs are made with, or NULL
+				 * if there are none yet. */
+    cairo_glyph_t *glyphs;	/* Glyphs of all lines, relative to the
+				 * origin of the text. */
+    int numGlyphs;
+} PathTextLayout;
+
+static Tcl_HashTable fontTable;
+static int fontTableInit = 0;
+static Tcl_HashTable metricsTable;
+static int metricsTableInit = 0;
+TCL_DECLARE_MUTEX(fontMutex)
 
 static cairo_font_slant_t
 convertTkFontSlant2CairoFontSlant(enum FontSlant slant)
@@ -639,36 +1570,326 @@ linebreak(char *str, char **nextp)
     return ret;
 }
 
+/*
+ * The family is prefixed with its length so that no family can make the
+ * key of another font, or of a string in metricsTable.
+ */
+
 static void
-multiline_show_text(TkPathContext ctx, double x, double y, double dy,
-		    char *utf8)
+MakeFontKey(Tk_PathTextStyle *textStylePtr, Tcl_DString *dsPtr)
 {
-    TkPathContext_ *context = (TkPathContext_ *) ctx;
-    char *token, *savep;
-    char *str = ckstrdup(utf8);
+    char buf[TCL_DOUBLE_SPACE + 3 * TCL_INTEGER_SPACE];
+
+    Tcl_DStringInit(dsPtr);
+    sprintf(buf, "%d:", (int) strlen(textStylePtr->fontFamily));
+    Tcl_DStringAppend(dsPtr, buf, -1);
+    Tcl_DStringAppend(dsPtr, textStylePtr->fontFamily, -1);
+    sprintf(buf, "|%.17g|%d|%d", textStylePtr->fontSize,
+	    (int) textStylePtr->fontWeight, (int) textStylePtr->fontSlant);
+    Tcl_DStringAppend(dsPtr, buf, -1);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetTextMetrics, SetTextMetrics --
+ *
+ *	Look up and store the bbox of a string in metricsTable.
+ *
+ * Results:
+ *	GetTextMetrics returns 1 and fills in *rPtr if the string was
+ *	measured before with the same style, else 0.
+ *
+ * Side effects:
+ *	SetTextMetrics may empty the table before adding the entry.
+ *
+ *----------------------------------------------------------------------
+ */
 
-    for (token = linebreak(str, &savep); token;
-	 token = linebreak(NULL, &savep), y += dy) {
-	cairo_move_to(context->c, x, y);
-	cairo_show_text(context->c, token);
+static int
+GetTextMetrics(Tk_PathTextStyle *textStylePtr, const char *utf8,
+    PathRect *rPtr)
+{
+    Tcl_HashEntry *hPtr = NULL;
+    Tcl_DString ds;
+
+    MakeFontKey(textStylePtr, &ds);
+    Tcl_DStringAppend(&ds, "|", 1);
+    Tcl_DStringAppend(&ds, utf8, -1);
+    Tcl_MutexLock(&fontMutex);
+    if (metricsTableInit) {
+	hPtr = Tcl_FindHashEntry(&metricsTable, Tcl_DStringValue(&ds));
+	if (hPtr != NULL) {
+	    *rPtr = *((PathRect *) Tcl_GetHashValue(hPtr));
+	}
     }
-    ckfree(str);
+    Tcl_MutexUnlock(&fontMutex);
+    Tcl_DStringFree(&ds);
+    return (hPtr != NULL);
 }
 
 static void
-multiline_text_path(TkPathContext ctx, double x, double y, double dy,
-		    char *utf8)
+SetTextMetrics(Tk_PathTextStyle *textStylePtr, const char *utf8,
+    PathRect *rPtr)
 {
-    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    Tcl_HashEntry *hPtr;
+    Tcl_HashSearch search;
+    Tcl_DString ds;
+    int isNew;
+
+    MakeFontKey(textStylePtr, &ds);
+    Tcl_DStringAppend(&ds, "|", 1);
+    Tcl_DStringAppend(&ds, utf8, -1);
+    Tcl_MutexLock(&fontMutex);
+    if (!metricsTableInit) {
+	Tcl_InitHashTable(&metricsTable, TCL_STRING_KEYS);
+	metricsTableInit = 1;
+    } else if (metricsTable.numEntries >= PATH_MAX_METRICS) {
+	for (hPtr = Tcl_FirstHashEntry(&metricsTable, &search); hPtr != NULL;
+		hPtr = Tcl_NextHashEntry(&search)) {
+	    ckfree((char *) Tcl_GetHashValue(hPtr));
+	}
+	Tcl_DeleteHashTable(&metricsTable);
+	Tcl_InitHashTable(&metricsTable, TCL_STRING_KEYS);
+    }
+    hPtr = Tcl_CreateHashEntry(&metricsTable, Tcl_DStringValue(&ds), &isNew);
+    if (isNew) {
+	Tcl_SetHashValue(hPtr, ckalloc(sizeof(PathRect)));
+    }
+    *((PathRect *) Tcl_GetHashValue(hPtr)) = *rPtr;
+    Tcl_MutexUnlock(&fontMutex);
+    Tcl_DStringFree(&ds);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * GetCairoFont --
+ *
+ *	Finds the shared scaled font for a text style, creating it if
+ *	needed. The font is the same that cairo_select_font_face and
+ *	cairo_set_font_size would give on an untransformed context.
+ *
+ * Results:
+ *	The font with its reference count incremented, or NULL if cairo
+ *	failed to create it. Release it with ReleaseCairoFont.
+ *
+ * Side effects:
+ *	May add an entry to fontTable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PathCairoFont *
+GetCairoFont(Tk_PathTextStyle *textStylePtr)
+{
+    PathCairoFont *fontPtr = NULL;
+    Tcl_HashEntry *hPtr;
+    Tcl_DString ds;
+    int isNew;
+
+    MakeFontKey(textStylePtr, &ds);
+    Tcl_MutexLock(&fontMutex);
+    if (!fontTableInit) {
+	Tcl_InitHashTable(&fontTable, TCL_STRING_KEYS);
+	fontTableInit = 1;
+    }
+    hPtr = Tcl_CreateHashEntry(&fontTable, Tcl_DStringValue(&ds), &isNew);
+    if (!isNew) {
+	fontPtr = (PathCairoFont *) Tcl_GetHashValue(hPtr);
+	fontPtr->refCount++;
+    } else {
+	cairo_font_face_t *face;
+	cairo_font_options_t *options;
+	cairo_scaled_font_t *scaledFont;
+	cairo_matrix_t fontMatrix, ctm;
+
+	face = cairo_toy_font_face_create(textStylePtr->fontFamily,
+		convertTkFontSlant2CairoFontSlant(textStylePtr->fontSlant),
+		convertTkFontWeight2CairoFontWeight(textStylePtr->fontWeight));
+	cairo_matrix_init_scale(&fontMatrix, textStylePtr->fontSize,
+		textStylePtr->fontSize);
+	cairo_matrix_init_identity(&ctm);
+	options = cairo_font_options_create();
+	scaledFont = cairo_scaled_font_create(face, &fontMatrix, &ctm, options);
+	cairo_font_options_destroy(options);
+
+	if (cairo_scaled_font_status(scaledFont) != CAIRO_STATUS_SUCCESS) {
+	    cairo_scaled_font_destroy(scaledFont);
+	    cairo_font_face_destroy(face);
+	    Tcl_DeleteHashEntry(hPtr);
+	} else {
+	    fontPtr = (PathCairoFont *) ckalloc(sizeof(PathCairoFont));
+	    fontPtr->face = face;
+	    fontPtr->scaledFont = scaledFont;
+	    cairo_scaled_font_extents(scaledFont, &fontPtr->extents);
+	    fontPtr->refCount = 1;
+	    fontPtr->hPtr = hPtr;
+	    Tcl_SetHashValue(hPtr, fontPtr);
+	}
+    }
+    Tcl_MutexUnlock(&fontMutex);
+    Tcl_DStringFree(&ds);
+    return fontPtr;
+}
+
+static void
+ReleaseCairoFont(PathCairoFont *fontPtr)
+{
+    Tcl_MutexLock(&fontMutex);
+    if (--fontPtr->refCount <= 0) {
+	Tcl_DeleteHashEntry(fontPtr->hPtr);
+	cairo_scaled_font_destroy(fontPtr->scaledFont);
+	cairo_font_face_destroy(fontPtr->face);
+	ckfree((char *) fontPtr);
+    }
+    Tcl_MutexUnlock(&fontMutex);
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MakeLayoutGlyphs --
+ *
+ *	Converts a string into the glyphs to draw it with the scaled font
+ *	scaledFont, one line per line of the string. The lines are spaced
+ *	as measured, and empty lines are skipped the same way as the toy
+ *	text API did. If measure is set the
+ *	width of the widest line is put in the bbox of the layout.
+ *
+ * Results:
+ *	None.
+ *
+ * Side effects:
+ *	Replaces the glyphs of the layout.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+MakeLayoutGlyphs(PathTextLayout *layoutPtr, cairo_scaled_font_t *scaledFont,
+    const char *utf8, int measure, int *numLinesPtr)
+{
+    cairo_glyph_t *glyphs;
+    cairo_text_extents_t extents;
+    double lineHeight, x;
+    int lc, numGlyphs, size = 0;
     char *token, *savep;
-    char *str = ckstrdup(utf8);
+    char *str;
+
+    if (layoutPtr->glyphFont != NULL) {
+	cairo_scaled_font_destroy(layoutPtr->glyphFont);
+    }
+    if (layoutPtr->glyphs != NULL) {
+	ckfree((char *) layoutPtr->glyphs);
+    }
+    layoutPtr->glyphFont = cairo_scaled_font_reference(scaledFont);
+    layoutPtr->glyphs = NULL;
+    layoutPtr->numGlyphs = 0;
+    lineHeight = layoutPtr->fontPtr->extents.ascent
+	    + layoutPtr->fontPtr->extents.descent;
 
-    for (token = linebreak(str, &savep); token;
-	 token = linebreak(NULL, &savep), y += dy) {
-	cairo_move_to(context->c, x, y);
-	cairo_text_path(context->c, token);
+    str = ckstrdup(utf8);
+    for (lc = 0, token = linebreak(str, &savep); token;
+	 lc++, token = linebreak(NULL, &savep)) {
+	glyphs = NULL;
+	numGlyphs = 0;
+	if (cairo_scaled_font_text_to_glyphs(scaledFont,
+		0.0, lc * lineHeight, token, -1, &glyphs, &numGlyphs,
+		NULL, NULL, NULL) != CAIRO_STATUS_SUCCESS) {
+	    continue;
+	}
+	if (numGlyphs > 0) {
+	    if (measure) {
+		cairo_scaled_font_glyph_extents(scaledFont,
+			glyphs, numGlyphs, &extents);
+		x = extents.x_bearing + extents.width;
+		if (x > layoutPtr->bbox.x2) {
+		    layoutPtr->bbox.x2 = x;
+		}
+	    }
+	    if (layoutPtr->numGlyphs + numGlyphs > size) {
+		size = 2 * (layoutPtr->numGlyphs + numGlyphs);
+		layoutPtr->glyphs = (cairo_glyph_t *) ckrealloc(
+			(char *) layoutPtr->glyphs,
+			size * sizeof(cairo_glyph_t));
+	    }
+	    memcpy(layoutPtr->glyphs + layoutPtr->numGlyphs, glyphs,
+		    numGlyphs * sizeof(cairo_glyph_t));
+	    layoutPtr->numGlyphs += numGlyphs;
+	}
+	cairo_glyph_free(glyphs);
     }
     ckfree(str);
+    *numLinesPtr = lc;
+}
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * MakeTextLayout --
+ *
+ *	Makes the layout of a string and measures it, unless the metrics
+ *	of the string are cached. The glyphs are only made when measuring.
+ *
+ * Results:
+ *	A new layout or NULL if the font can't be created. Free it with
+ *	FreeTextLayout.
+ *
+ * Side effects:
+ *	Memory allocated. The metrics are added to metricsTable.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static PathTextLayout *
+MakeTextLayout(Tk_PathTextStyle *textStylePtr, const char *utf8)
+{
+    PathCairoFont *fontPtr;
+    PathTextLayout *layoutPtr;
+    int numLines;
+
+    fontPtr = GetCairoFont(textStylePtr);
+    if (fontPtr == NULL) {
+	return NULL;
+    }
+    layoutPtr = (PathTextLayout *) ckalloc(sizeof(PathTextLayout));
+    layoutPtr->fontPtr = fontPtr;
+    layoutPtr->glyphFont = NULL;
+    layoutPtr->glyphs = NULL;
+    layoutPtr->numGlyphs = 0;
+    if (!GetTextMetrics(textStylePtr, utf8, &layoutPtr->bbox)) {
+	layoutPtr->bbox.x2 = 0.0;
+	MakeLayoutGlyphs(layoutPtr, fontPtr->scaledFont, utf8, 1, &numLines);
+	layoutPtr->bbox.x1 = 0.0;
+	layoutPtr->bbox.y1 = -fontPtr->extents.ascent;
+	layoutPtr->bbox.y2 = numLines
+		* (fontPtr->extents.ascent + fontPtr->extents.descent)
+		- fontPtr->extents.ascent;
+	SetTextMetrics(textStylePtr, utf8, &layoutPtr->bbox);
+    }
+    return layoutPtr;
+}
+
+static void
+FreeTextLayout(PathTextLayout *layoutPtr)
+{
+    ReleaseCairoFont(layoutPtr->fontPtr);
+    if (layoutPtr->glyphFont != NULL) {
+	cairo_scaled_font_destroy(layoutPtr->glyphFont);
+    }
+    if (layoutPtr->glyphs != NULL) {
+	ckfree((char *) layoutPtr->glyphs);
+    }
+    ckfree((char *) layoutPtr);
+}
+
+int
+TkPathTextConfig(Tcl_Interp *interp, Tk_PathTextStyle *textStylePtr,
+		 char *utf8, void **customPtr)
+{
+    *customPtr = (void *) MakeTextLayout(textStylePtr, utf8);
+    return TCL_OK;
 }
 
 void
@@ -677,19 +1898,40 @@ TkPathTextDraw(TkPathContext ctx, Tk_PathStyle *style,
     double x, double y, int fillOverStroke, char *utf8, void *custom)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
-    cairo_font_extents_t fontExtents;
+    PathTextLayout *layoutPtr = (PathTextLayout *) custom;
+    cairo_scaled_font_t *scaledFont;
     int hasStroke = (style->strokeColor != NULL);
     int hasFill = (GetColorFromPathColor(style->fill) != NULL);
+    int numLines;
 
-    cairo_select_font_face(context->c, textStylePtr->fontFamily,
-	    convertTkFontSlant2CairoFontSlant(textStylePtr->fontSlant),
-	    convertTkFontWeight2CairoFontWeight(textStylePtr->fontWeight));
+    if (layoutPtr == NULL) {
+	layoutPtr = MakeTextLayout(textStylePtr, utf8);
+	if (layoutPtr == NULL) {
+	    return;
+	}
+    }
+    cairo_save(context->c);
+    cairo_translate(context->c, x, y);
+    cairo_set_font_face(context->c, layoutPtr->fontPtr->face);
     cairo_set_font_size(context->c, textStylePtr->fontSize);
-    cairo_font_extents(context->c, &fontExtents);
+    scaledFont = cairo_get_scaled_font(context->c);
+    if (scaledFont != layoutPtr->glyphFont) {
+	MakeLayoutGlyphs(layoutPtr, scaledFont, utf8, 0, &numLines);
+    }
+    if (hasStroke) {
+	cairo_glyph_path(context->c, layoutPtr->glyphs, layoutPtr->numGlyphs);
+    } else if (hasFill) {
+	CairoSetFill(ctx, style);
+	cairo_show_glyphs(context->c, layoutPtr->glyphs, layoutPtr->numGlyphs);
+    }
+    cairo_restore(context->c);
+
+    /*
+     * The glyph path was added in the text's own coordinates but is
+     * kept in device space, so the stroke is done as for other paths.
+     */
 
     if (hasStroke && hasFill) {
-	multiline_text_path(ctx, x, y,
-		fontExtents.ascent + fontExtents.descent, utf8);
 	if (fillOverStroke) {
 	    TkPathPrepareForStroke(ctx, style);
 	    cairo_stroke_preserve(context->c);
@@ -698,66 +1940,39 @@ TkPathTextDraw(TkPathContext ctx, Tk_PathStyle *style,
 	} else {
 	    TkPathFillAndStroke(ctx, style);
 	}
-    } else if (hasFill) {
-	CairoSetFill(ctx, style);
-	multiline_show_text(ctx, x, y,
-		fontExtents.ascent + fontExtents.descent, utf8);
     } else if (hasStroke) {
-	multiline_text_path(ctx, x, y,
-		fontExtents.ascent + fontExtents.descent, utf8);
 	TkPathStroke(ctx, style);
     }
+    if (layoutPtr != (PathTextLayout *) custom) {
+	FreeTextLayout(layoutPtr);
+    }
 }
 
 void
 TkPathTextFree(Tk_PathTextStyle *textStylePtr, void *custom)
 {
-    /* Empty. */
+    if (custom != NULL) {
+	FreeTextLayout((PathTextLayout *) custom);
+    }
 }
 
 PathRect
 TkPathTextMeasureBbox(Display *display, Tk_PathTextStyle *textStylePtr,
     char *utf8, void *custom)
 {
-    cairo_t *c;
-    cairo_surface_t *surface;
-    cairo_text_extents_t extents;
-    cairo_font_extents_t fontExtents;
-    PathRect r;
-    int lc;
-    char *token, *savep;
-    double x;
-    char *str = ckstrdup(utf8);
-
-    /*
-     * @@@ Not very happy about this but it seems that there is no way to
-     *     measure text without having a surface (drawable) in cairo.
-     */
-    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 10, 10);
-    c = cairo_create(surface);
-    cairo_select_font_face(c, textStylePtr->fontFamily,
-	    convertTkFontSlant2CairoFontSlant(textStylePtr->fontSlant),
-	    convertTkFontWeight2CairoFontWeight(textStylePtr->fontWeight));
-    cairo_set_font_size(c, textStylePtr->fontSize);
+    PathTextLayout *layoutPtr;
+    PathRect r = {0.0, 0.0, 0.0, 0.0};
 
-    cairo_font_extents(c, &fontExtents);
-
-    r.x2 = 0.0;
-    for (lc = 0, token = linebreak(str, &savep); token;
-	 lc++, token = linebreak(NULL, &savep)) {
-	cairo_text_extents(c, token, &extents);
-	x = extents.x_bearing + extents.width;
-	if (x > r.x2)
-	    r.x2 = x;
+    if (custom != NULL) {
+	return ((PathTextLayout *) custom)->bbox;
+    }
+    if (!GetTextMetrics(textStylePtr, utf8, &r)) {
+	layoutPtr = MakeTextLayout(textStylePtr, utf8);
+	if (layoutPtr != NULL) {
+	    r = layoutPtr->bbox;
+	    FreeTextLayout(layoutPtr);
+	}
     }
-    r.y1 = -fontExtents.ascent;
-    r.x1 = 0.0;
-    r.y2 = lc * (fontExtents.ascent + fontExtents.descent) - fontExtents.ascent;
-
-    cairo_destroy(c);
-    cairo_surface_destroy(surface);
-    ckfree(str);
-
     return r;
 }
 
@@ -866,6 +2081,26 @@ TkPathReleaseClipToPath(TkPathContext ctx)
     /* cairo_reset_clip(context->c); */
 }
 
+void
+TkPathClipToRect(TkPathContext ctx, PathRect *rectPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+    /* Note: cairo_clip consumes the current path */
+    cairo_new_path(context->c);
+    cairo_rectangle(context->c, rectPtr->x1, rectPtr->y1,
+	    rectPtr->x2 - rectPtr->x1, rectPtr->y2 - rectPtr->y1);
+    cairo_clip(context->c);
+}
+
+void
+TkPathSetTolerance(TkPathContext ctx, double tolerance)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+
+    cairo_set_tolerance(context->c, tolerance);
+}
+
 static void
 TkPathPrepareForStroke(TkPathContext ctx, Tk_PathStyle *style)
 {
@@ -958,6 +2193,17 @@ TkPathFree(TkPathContext ctx)
 	ckfree((char *) context->record->data);
 	ckfree((char *) context->record);
     }
+    if (context->target) {
+	PathImageTarget *target = context->target;
+
+	XFreeGC(target->display, target->gc);
+	if (target->shmPtr != NULL) {
+	    target->ximage->data = NULL;
+	    ReleaseShmSegment(target->shmPtr);
+	}
+	XDestroyImage(target->ximage);
+	ckfree((char *) target);
+    }
     ckfree((char *) context);
 }
 
@@ -1009,47 +2255,59 @@ GetCairoExtend(int method)
     return extend;
 }
 
-void TkPathPaintLinearGradient(TkPathContext ctx, PathRect *bbox,
-    LinearGradientFill *fillPtr, int fillRule, double fillOpacity,
-    TMatrix *mPtr)
-{
-    TkPathContext_ *context = (TkPathContext_ *) ctx;
-    int i;
-    int nstops;
-    PathRect *tPtr;            /* The transition line. */
-    GradientStop *stop;
-    GradientStopArray *stopArrPtr;
-    cairo_pattern_t *pattern;
+/*
+ * The pattern of a gradient is compiled once and kept in the cachePtr of
+ * its fill record until TkPathGradientChanged frees it. It is the same
+ * for all items using the gradient: for -units bbox the bbox is applied
+ * through the CTM, not the pattern. The stop opacities have the fill
+ * opacity multiplied in, so one pattern is kept for each of the last
+ * PATH_GRADIENT_CACHE_SIZE fill opacities the gradient was painted with.
+ * Items that share a gradient but differ in -fillopacity then don't
+ * compile it again on every redisplay.
+ */
 
-    stopArrPtr = fillPtr->stopArrPtr;
-    tPtr = fillPtr->transitionPtr;
-    nstops = stopArrPtr->nstops;
+#define PATH_GRADIENT_CACHE_SIZE 4
 
-    /*
-     * The current path is consumed by filling.
-     * Need therfore to save the current context and restore after.
-     */
-    cairo_save(context->c);
+typedef struct PathGradientCache {
+    cairo_pattern_t *patterns[PATH_GRADIENT_CACHE_SIZE];
+				/* NULL for unused slots. */
+    double fillOpacity[PATH_GRADIENT_CACHE_SIZE];
+    int next;			/* Slot to replace when all are used. */
+} PathGradientCache;
 
-    pattern = cairo_pattern_create_linear(tPtr->x1, tPtr->y1,
-		    tPtr->x2, tPtr->y2);
+static cairo_pattern_t *
+FindGradientPattern(void *cachePtr, double fillOpacity)
+{
+    PathGradientCache *gcPtr = (PathGradientCache *) cachePtr;
+    int i;
 
-    /*
-     * We need to do like this since this is how SVG defines gradient drawing
-     * in case the transition vector is in relative coordinates.
-     */
-    if (fillPtr->units == kPathGradientUnitsBoundingBox) {
-	cairo_translate(context->c, bbox->x1, bbox->y1);
-	cairo_scale(context->c, bbox->x2 - bbox->x1, bbox->y2 - bbox->y1);
+    if (gcPtr != NULL) {
+	for (i = 0; i < PATH_GRADIENT_CACHE_SIZE; i++) {
+	    if ((gcPtr->patterns[i] != NULL)
+		    && (gcPtr->fillOpacity[i] == fillOpacity)) {
+		return gcPtr->patterns[i];
+	    }
+	}
     }
+    return NULL;
+}
+
+static cairo_pattern_t *
+CacheGradientPattern(void **cachePtrPtr, cairo_pattern_t *pattern,
+    GradientStopArray *stopArrPtr, int method, double fillOpacity,
+    TMatrix *mPtr)
+{
+    PathGradientCache *cachePtr = (PathGradientCache *) *cachePtrPtr;
+    GradientStop *stop;
+    int i, slot;
+
     if (mPtr) {
 	cairo_matrix_t matrix;
 	cairo_matrix_init(&matrix, mPtr->a, mPtr->b, mPtr->c, mPtr->d,
 		mPtr->tx, mPtr->ty);
 	cairo_pattern_set_matrix(pattern, &matrix);
     }
-
-    for (i = 0; i < nstops; i++) {
+    for (i = 0; i < stopArrPtr->nstops; i++) {
 	stop = stopArrPtr->stops[i];
 	cairo_pattern_add_color_stop_rgba(pattern, stop->offset,
 		RedDoubleFromXColorPtr(stop->color),
@@ -1057,73 +2315,104 @@ void TkPathPaintLinearGradient(TkPathContext ctx, PathRect *bbox,
 		BlueDoubleFromXColorPtr(stop->color),
 		stop->opacity * fillOpacity);
     }
-    cairo_set_source(context->c, pattern);
-    cairo_set_fill_rule(context->c,
-	    (fillRule == WindingRule) ? CAIRO_FILL_RULE_WINDING :
-		CAIRO_FILL_RULE_EVEN_ODD);
-    cairo_pattern_set_extend(pattern, GetCairoExtend(fillPtr->method));
-    cairo_fill(context->c);
+    cairo_pattern_set_extend(pattern, GetCairoExtend(method));
 
-    cairo_pattern_destroy(pattern);
-    cairo_restore(context->c);
+    if (cachePtr == NULL) {
+	cachePtr = (PathGradientCache *) ckalloc(sizeof(PathGradientCache));
+	for (i = 0; i < PATH_GRADIENT_CACHE_SIZE; i++) {
+	    cachePtr->patterns[i] = NULL;
+	}
+	cachePtr->next = 0;
+	*cachePtrPtr = (void *) cachePtr;
+    }
+    slot = cachePtr->next;
+    cachePtr->next = (slot + 1) % PATH_GRADIENT_CACHE_SIZE;
+    if (cachePtr->patterns[slot] != NULL) {
+	cairo_pattern_destroy(cachePtr->patterns[slot]);
+    }
+    cachePtr->patterns[slot] = pattern;
+    cachePtr->fillOpacity[slot] = fillOpacity;
+    return pattern;
 }
 
-void
-TkPathPaintRadialGradient(TkPathContext ctx, PathRect *bbox,
-    RadialGradientFill *fillPtr, int fillRule, double fillOpacity,
-    TMatrix *mPtr)
+static void
+FillWithGradient(TkPathContext ctx, PathRect *bbox, int units,
+    cairo_pattern_t *pattern, int fillRule)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
-    int i;
-    int nstops;
-    GradientStop *stop;
-    cairo_pattern_t *pattern;
-    GradientStopArray *stopArrPtr;
-    RadialTransition *tPtr;
-
-    stopArrPtr = fillPtr->stopArrPtr;
-    nstops = stopArrPtr->nstops;
-    tPtr = fillPtr->radialPtr;
 
     /*
      * The current path is consumed by filling.
      * Need therfore to save the current context and restore after.
      */
     cairo_save(context->c);
-    pattern = cairo_pattern_create_radial(
-	    tPtr->focalX, tPtr->focalY, 0.0,
-	    tPtr->centerX, tPtr->centerY, tPtr->radius);
 
-    if (fillPtr->units == kPathGradientUnitsBoundingBox) {
+    /*
+     * We need to do like this since this is how SVG defines gradient drawing
+     * in case the transition vector is in relative coordinates.
+     */
+    if (units == kPathGradientUnitsBoundingBox) {
 	cairo_translate(context->c, bbox->x1, bbox->y1);
 	cairo_scale(context->c, bbox->x2 - bbox->x1, bbox->y2 - bbox->y1);
     }
-    if (mPtr) {
-	cairo_matrix_t matrix;
-	cairo_matrix_init(&matrix, mPtr->a, mPtr->b, mPtr->c, mPtr->d,
-		mPtr->tx, mPtr->ty);
-	cairo_pattern_set_matrix(pattern, &matrix);
-    }
-
-    for (i = 0; i < nstops; i++) {
-	stop = stopArrPtr->stops[i];
-	cairo_pattern_add_color_stop_rgba(pattern, stop->offset,
-		RedDoubleFromXColorPtr(stop->color),
-		GreenDoubleFromXColorPtr(stop->color),
-		BlueDoubleFromXColorPtr(stop->color),
-		stop->opacity * fillOpacity);
-    }
     cairo_set_source(context->c, pattern);
     cairo_set_fill_rule(context->c,
 	    (fillRule == WindingRule) ? CAIRO_FILL_RULE_WINDING :
 		CAIRO_FILL_RULE_EVEN_ODD);
-    cairo_pattern_set_extend(pattern, GetCairoExtend(fillPtr->method));
     cairo_fill(context->c);
-
-    cairo_pattern_destroy(pattern);
     cairo_restore(context->c);
 }
 
+void TkPathPaintLinearGradient(TkPathContext ctx, PathRect *bbox,
+    LinearGradientFill *fillPtr, int fillRule, double fillOpacity,
+    TMatrix *mPtr)
+{
+    PathRect *tPtr = fillPtr->transitionPtr;	/* The transition line. */
+    cairo_pattern_t *pattern;
+
+    pattern = FindGradientPattern(fillPtr->cachePtr, fillOpacity);
+    if (pattern == NULL) {
+	pattern = CacheGradientPattern(&fillPtr->cachePtr,
+		cairo_pattern_create_linear(tPtr->x1, tPtr->y1,
+			tPtr->x2, tPtr->y2),
+		fillPtr->stopArrPtr, fillPtr->method, fillOpacity, mPtr);
+    }
+    FillWithGradient(ctx, bbox, fillPtr->units, pattern, fillRule);
+}
+
+void
+TkPathPaintRadialGradient(TkPathContext ctx, PathRect *bbox,
+    RadialGradientFill *fillPtr, int fillRule, double fillOpacity,
+    TMatrix *mPtr)
+{
+    RadialTransition *tPtr = fillPtr->radialPtr;
+    cairo_pattern_t *pattern;
+
+    pattern = FindGradientPattern(fillPtr->cachePtr, fillOpacity);
+    if (pattern == NULL) {
+	pattern = CacheGradientPattern(&fillPtr->cachePtr,
+		cairo_pattern_create_radial(
+			tPtr->focalX, tPtr->focalY, 0.0,
+			tPtr->centerX, tPtr->centerY, tPtr->radius),
+		fillPtr->stopArrPtr, fillPtr->method, fillOpacity, mPtr);
+    }
+    FillWithGradient(ctx, bbox, fillPtr->units, pattern, fillRule);
+}
+
+void
+TkPathFreeGradientCache(void *cachePtr)
+{
+    PathGradientCache *gcPtr = (PathGradientCache *) cachePtr;
+    int i;
+
+    for (i = 0; i < PATH_GRADIENT_CACHE_SIZE; i++) {
+	if (gcPtr->patterns[i] != NULL) {
+	    cairo_pattern_destroy(gcPtr->patterns[i]);
+	}
+    }
+    ckfree((char *) cachePtr);
+}
+
 /*
  * Local Variables:
  * mode: c
@@ -82,6 +82,7 @@ class PathC {
     void CurveTo(float x1, float y1, float x2, float y2, float x, float y);
     void AddRectangle(float x, float y, float width, float height);
     void AddEllipse(float cx, float cy, float rx, float ry);
+    void ClipToRect(float x, float y, float width, float height);
     void DrawImage(Tk_PhotoHandle photo, float x, float y, float width,
                    float height, double fillOpacity,
                    XColor *tintColor, double tintAmount, int interpolation,
@@ -249,9 +250,19 @@ PathC::RestoreState()
     mGraphics->EndContainer(mContainerStack[mCointainerTop]);
 }
 
+inline void
+PathC::ClipToRect(float x, float y, float width, float height)
+{
+    RectF rect(x, y, width, height);
+    mGraphics->SetClip(rect, CombineModeIntersect);
+}
+
 inline void
 PathC::BeginPath(Tk_PathStyle *style)
 {
+    if (mPath) {
+        delete mPath;
+    }
     mPath = new GraphicsPath((style->fillRule == WindingRule) ?
                              FillModeWinding : FillModeAlternate);
 }
@@ -1041,6 +1052,68 @@ TkPathInitSurface(Display *display, int width, int height)
     return (TkPathContext) context;
 }
 
+TkPathContext
+TkPathInitImage(Tk_Window tkwin, Drawable d, PathRect *rectPtr)
+{
+    /* Not supported, the canvas then draws with TkPathInit. */
+    return 0;
+}
+
+void
+TkPathFlushImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    /* Empty. */
+}
+
+int
+TkPathReloadImage(TkPathContext ctx, PathRect *rectPtr)
+{
+    return 1;
+}
+
+int
+TkPathCanDrawSurface(void)
+{
+    return 0;
+}
+
+void
+TkPathDrawSurface(TkPathContext ctx, TkPathContext surface, double x,
+    double y)
+{
+    /* Empty. */
+}
+
+int
+TkPathKeepPath(TkPathContext ctx, int keep)
+{
+    return 0;
+}
+
+void
+TkPathFreeGradientCache(void *cachePtr)
+{
+    /* Empty. */
+}
+
+void *
+TkPathCopyPath(TkPathContext ctx)
+{
+    return NULL;
+}
+
+void
+TkPathAppendPath(TkPathContext ctx, void *pathPtr)
+{
+    /* Empty. */
+}
+
+void
+TkPathFreeCopiedPath(void *pathPtr)
+{
+    /* Empty. */
+}
+
 void
 TkPathPushTMatrix(TkPathContext ctx, TMatrix *m)
 {
@@ -1151,7 +1224,7 @@ void
 TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
             double x, double y, double width, double height,
             double fillOpacity, XColor *tintColor, double tintAmount,
-            int interpolation, PathRect *srcRegion)
+            int interpolation, PathRect *srcRegion, void **customPtr)
 {
     TkPathContext_ *context = (TkPathContext_ *) ctx;
     context->c->DrawImage(photo, (float) x, (float) y,
@@ -1160,6 +1233,12 @@ TkPathImage(TkPathContext ctx, Tk_Image image, Tk_PhotoHandle photo,
                           interpolation, srcRegion);
 }
 
+void
+TkPathImageFree(void *custom)
+{
+    /* Empty. */
+}
+
 void
 TkPathClosePath(TkPathContext ctx)
 {
@@ -1372,6 +1451,21 @@ TkPathReleaseClipToPath(TkPathContext ctx)
     /* empty */
 }
 
+void
+TkPathClipToRect(TkPathContext ctx, PathRect *rectPtr)
+{
+    TkPathContext_ *context = (TkPathContext_ *) ctx;
+    context->c->ClipToRect((float) rectPtr->x1, (float) rectPtr->y1,
+            (float) (rectPtr->x2 - rectPtr->x1),
+            (float) (rectPtr->y2 - rectPtr->y1));
+}
+
+void
+TkPathSetTolerance(TkPathContext ctx, double tolerance)
+{
+    /* empty; GDI+ has no flatness setting for drawing */
+}
+
 void
 TkPathStroke(TkPathContext ctx, Tk_PathStyle *style)
 {